@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Completion latency models for null_blk: per operation distributions or
+ * replayed traces, queue depth dependent service time and periodic stalls
+ * mimicking the garbage collection of flash devices.
+ */
+#include <linux/random.h>
+#include <linux/math64.h>
+#include <linux/vmalloc.h>
+#include "null_blk.h"
+
+/* Longest latency accepted for a distribution parameter or a trace entry */
+#define NULLB_LAT_MAX_NSEC	(60ULL * NSEC_PER_SEC)
+
+/* Maximum number of entries of a latency trace, over all operations */
+#define NULLB_LAT_TRACE_MAX	(1U << 20)
+
+static const char * const null_lat_type_names[] = {
+	[NULLB_LAT_NONE]	= "none",
+	[NULLB_LAT_FIXED]	= "fixed",
+	[NULLB_LAT_UNIFORM]	= "uniform",
+	[NULLB_LAT_NORMAL]	= "normal",
+};
+
+static const char null_lat_op_names[NULLB_LAT_NR] = {
+	[NULLB_LAT_READ]	= 'R',
+	[NULLB_LAT_WRITE]	= 'W',
+	[NULLB_LAT_OTHER]	= 'O',
+};
+
+static int null_lat_class(enum req_opf op)
+{
+	switch (op) {
+	case REQ_OP_READ:
+		return NULLB_LAT_READ;
+	case REQ_OP_WRITE:
+	case REQ_OP_WRITE_ZEROES:
+	case REQ_OP_ZONE_APPEND:
+		return NULLB_LAT_WRITE;
+	default:
+		return NULLB_LAT_OTHER;
+	}
+}
+
+int null_lat_dist_parse(struct nullb_lat_dist *dist, const char *page)
+{
+	struct nullb_lat_dist new = { };
+	char name[16];
+	int i, n;
+
+	n = sscanf(page, "%15s %llu %llu", name, &new.p1, &new.p2);
+	if (n < 1)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(null_lat_type_names); i++)
+		if (!strcmp(name, null_lat_type_names[i]))
+			break;
+
+	switch (i) {
+	case NULLB_LAT_NONE:
+		if (n != 1)
+			return -EINVAL;
+		break;
+	case NULLB_LAT_FIXED:
+		if (n != 2)
+			return -EINVAL;
+		break;
+	case NULLB_LAT_UNIFORM:
+		if (n != 3 || new.p1 > new.p2)
+			return -EINVAL;
+		break;
+	case NULLB_LAT_NORMAL:
+		if (n != 3)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (new.p1 > NULLB_LAT_MAX_NSEC || new.p2 > NULLB_LAT_MAX_NSEC)
+		return -ERANGE;
+
+	new.type = i;
+	*dist = new;
+	return 0;
+}
+
+ssize_t null_lat_dist_show(const struct nullb_lat_dist *dist, char *page)
+{
+	const char *name = null_lat_type_names[dist->type];
+
+	switch (dist->type) {
+	case NULLB_LAT_FIXED:
+		return snprintf(page, PAGE_SIZE, "%s %llu\n", name, dist->p1);
+	case NULLB_LAT_UNIFORM:
+	case NULLB_LAT_NORMAL:
+		return snprintf(page, PAGE_SIZE, "%s %llu %llu\n", name,
+				dist->p1, dist->p2);
+	default:
+		return snprintf(page, PAGE_SIZE, "%s\n", name);
+	}
+}
+
+static u64 null_lat_dist_sample(const struct nullb_lat_dist *dist, u64 dflt)
+{
+	s64 z = 0, lat;
+	int i;
+
+	switch (dist->type) {
+	case NULLB_LAT_FIXED:
+		return dist->p1;
+	case NULLB_LAT_UNIFORM:
+		return dist->p1 + mul_u64_u32_shr(dist->p2 - dist->p1 + 1,
+						  prandom_u32(), 32);
+	case NULLB_LAT_NORMAL:
+		/*
+		 * The sum of 12 uniform variables in [0, 1) minus 6 is a good
+		 * enough approximation of the standard normal distribution,
+		 * computed here with 16 fractional bits.
+		 */
+		for (i = 0; i < 12; i++)
+			z += prandom_u32() >> 16;
+		z -= 6 << 16;
+		lat = (s64)dist->p1 + div_s64((s64)dist->p2 * z, 1 << 16);
+		return lat > 0 ? lat : 0;
+	default:
+		return dflt;
+	}
+}
+
+/*
+ * Nothing is serviced while a stall is in progress, and each stall which
+ * starts while a command is being serviced delays it by the stall duration.
+ */
+static u64 null_lat_gc_delay(struct nullb_device *dev, u64 lat)
+{
+	u64 period = (u64)dev->gc_period_msec * NSEC_PER_MSEC;
+	u64 stall = (u64)dev->gc_stall_usec * NSEC_PER_USEC;
+	u64 now, start, end, rem;
+
+	if (!period || !stall)
+		return lat;
+
+	now = ktime_to_ns(ktime_sub(ktime_get(), dev->lat_epoch));
+
+	div64_u64_rem(now, period, &rem);
+	start = rem < stall ? now + stall - rem : now;
+
+	end = start + lat;
+	end += (div64_u64(end, period) - div64_u64(start, period)) * stall;
+	div64_u64_rem(end, period, &rem);
+	if (rem < stall)
+		end += stall - rem;
+
+	return end - now;
+}
+
+/**
+ * null_lat_cmd_nsec - compute the completion time of a command
+ * @dev: the device
+ * @op: operation of the command
+ *
+ * Must be paired with null_lat_cmd_done() when the command completes, the
+ * number of commands in between gives the queue depth seen by new commands.
+ */
+u64 null_lat_cmd_nsec(struct nullb_device *dev, enum req_opf op)
+{
+	int class = null_lat_class(op);
+	struct nullb_lat_trace *trace = &dev->lat_trace[class];
+	unsigned int queued = atomic_inc_return(&dev->lat_inflight) - 1;
+	u64 lat;
+
+	if (trace->nr)
+		lat = trace->nsec[(unsigned int)atomic_fetch_inc(&trace->pos) %
+				  trace->nr];
+	else
+		lat = null_lat_dist_sample(&dev->lat_dist[class],
+					   dev->completion_nsec);
+
+	lat += (u64)queued * dev->qd_latency_nsec;
+
+	return null_lat_gc_delay(dev, lat);
+}
+
+void null_lat_cmd_done(struct nullb_device *dev)
+{
+	atomic_dec(&dev->lat_inflight);
+}
+
+bool null_lat_configured(struct nullb_device *dev)
+{
+	int i;
+
+	for (i = 0; i < NULLB_LAT_NR; i++)
+		if (dev->lat_dist[i].type != NULLB_LAT_NONE ||
+		    dev->lat_trace[i].nr)
+			return true;
+
+	return dev->qd_latency_nsec ||
+	       (dev->gc_period_msec && dev->gc_stall_usec);
+}
+
+void null_lat_start(struct nullb_device *dev)
+{
+	int i;
+
+	atomic_set(&dev->lat_inflight, 0);
+	for (i = 0; i < NULLB_LAT_NR; i++)
+		atomic_set(&dev->lat_trace[i].pos, 0);
+	dev->lat_epoch = ktime_get();
+}
+
+static void null_lat_traces_free(struct nullb_lat_trace *traces)
+{
+	int i;
+
+	for (i = 0; i < NULLB_LAT_NR; i++) {
+		kvfree(traces[i].nsec);
+		traces[i].nsec = NULL;
+		traces[i].nr = 0;
+	}
+}
+
+void null_lat_trace_free(struct nullb_device *dev)
+{
+	null_lat_traces_free(dev->lat_trace);
+}
+
+/*
+ * An entry is made of the blktrace RWBS field of a request followed by its
+ * completion time in ns. Discards and flushes without data go to the other
+ * class, along with anything which is neither a read nor a write.
+ */
+static int null_lat_trace_parse_entry(char *line, int *class, u64 *nsec)
+{
+	char *rwbs = strsep(&line, " \t");
+	int ret;
+
+	if (!line)
+		return -EINVAL;
+
+	ret = kstrtoull(skip_spaces(line), 10, nsec);
+	if (ret)
+		return ret;
+	if (*nsec > NULLB_LAT_MAX_NSEC)
+		return -ERANGE;
+
+	if (strchr(rwbs, 'D'))
+		*class = NULLB_LAT_OTHER;
+	else if (strchr(rwbs, 'W'))
+		*class = NULLB_LAT_WRITE;
+	else if (strchr(rwbs, 'R'))
+		*class = NULLB_LAT_READ;
+	else
+		*class = NULLB_LAT_OTHER;
+
+	return 0;
+}
+
+/**
+ * null_lat_trace_load - replace the latency traces of a device
+ * @dev: the device
+ * @buf: trace text, one "<rwbs> <nsec>" entry per line
+ * @count: size of @buf
+ *
+ * Empty lines and lines starting with '#' are ignored, so loading a trace
+ * without any entry drops the current traces.
+ */
+ssize_t null_lat_trace_load(struct nullb_device *dev, const void *buf,
+			    size_t count)
+{
+	struct nullb_lat_trace traces[NULLB_LAT_NR] = { };
+	unsigned int nr[NULLB_LAT_NR] = { }, total = 0;
+	char *text, *p, *line;
+	int pass, class, i, ret = 0;
+	u64 nsec;
+
+	text = kvmalloc(count + 1, GFP_KERNEL);
+	if (!text)
+		return -ENOMEM;
+
+	/* Count the entries of each class first, then store them */
+	for (pass = 0; pass < 2; pass++) {
+		memcpy(text, buf, count);
+		text[count] = '\0';
+		p = text;
+
+		while ((line = strsep(&p, "\n"))) {
+			line = strim(line);
+			if (!*line || *line == '#')
+				continue;
+
+			ret = null_lat_trace_parse_entry(line, &class, &nsec);
+			if (ret)
+				goto out;
+
+			if (pass) {
+				traces[class].nsec[traces[class].nr++] = nsec;
+			} else if (++total > NULLB_LAT_TRACE_MAX) {
+				ret = -E2BIG;
+				goto out;
+			} else {
+				nr[class]++;
+			}
+		}
+
+		if (pass)
+			break;
+
+		for (i = 0; i < NULLB_LAT_NR; i++) {
+			if (!nr[i])
+				continue;
+			traces[i].nsec = kvmalloc_array(nr[i], sizeof(u64),
+							GFP_KERNEL);
+			if (!traces[i].nsec) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+	}
+
+	null_lat_trace_free(dev);
+	for (i = 0; i < NULLB_LAT_NR; i++) {
+		dev->lat_trace[i].nsec = traces[i].nsec;
+		dev->lat_trace[i].nr = traces[i].nr;
+		atomic_set(&dev->lat_trace[i].pos, 0);
+	}
+out:
+	if (ret)
+		null_lat_traces_free(traces);
+	kvfree(text);
+	return ret ? ret : count;
+}
+
+/*
+ * Print the traces back in the format they are loaded with, or return the
+ * size needed to do so if @buf is NULL.
+ */
+ssize_t null_lat_trace_dump(struct nullb_device *dev, void *buf, size_t size)
+{
+	char entry[24];
+	size_t len = 0;
+	unsigned int j;
+	int i, n;
+
+	for (i = 0; i < NULLB_LAT_NR; i++) {
+		for (j = 0; j < dev->lat_trace[i].nr; j++) {
+			n = snprintf(entry, sizeof(entry), "%c %llu\n",
+				     null_lat_op_names[i],
+				     dev->lat_trace[i].nsec[j]);
+			if (buf) {
+				if (len + n > size)
+					return len;
+				memcpy(buf + len, entry, n);
+			}
+			len += n;
+		}
+	}
+
+	return len;
+}
@@ -38,12 +38,14 @@ static inline u64 mb_per_tick(int mbps)
  * UP:		Device is currently on and visible in userspace.
  * THROTTLED:	Device is being throttled.
  * CACHE:	Device is using a write-back cache.
+ * LATENCY:	Completion times follow the device latency model.
  */
 enum nullb_device_flags {
 	NULLB_DEV_FL_CONFIGURED	= 0,
 	NULLB_DEV_FL_UP		= 1,
 	NULLB_DEV_FL_THROTTLED	= 2,
 	NULLB_DEV_FL_CACHE	= 3,
+	NULLB_DEV_FL_LATENCY	= 4,
 };
 
 #define MAP_SZ		((PAGE_SIZE >> SECTOR_SHIFT) + 2)
@@ -366,6 +368,39 @@ NULLB_DEVICE_ATTR(zone_capacity, ulong, NULL);
 NULLB_DEVICE_ATTR(zone_nr_conv, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_open, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_active, uint, NULL);
+NULLB_DEVICE_ATTR(qd_latency_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(gc_period_msec, ulong, NULL);
+NULLB_DEVICE_ATTR(gc_stall_usec, ulong, NULL);
+
+/*
+ * Completion time distribution of an operation class: "none" to use
+ * completion_nsec, "fixed <ns>", "uniform <min ns> <max ns>" or
+ * "normal <mean ns> <stddev ns>".
+ */
+#define NULLB_DEVICE_LAT_ATTR(NAME, CLASS)				\
+static ssize_t								\
+nullb_device_##NAME##_latency_show(struct config_item *item, char *page)\
+{									\
+	return null_lat_dist_show(&to_nullb_device(item)->lat_dist[CLASS],\
+				  page);				\
+}									\
+static ssize_t								\
+nullb_device_##NAME##_latency_store(struct config_item *item,		\
+				    const char *page, size_t count)	\
+{									\
+	struct nullb_device *dev = to_nullb_device(item);		\
+	int ret;							\
+									\
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))		\
+		return -EBUSY;						\
+	ret = null_lat_dist_parse(&dev->lat_dist[CLASS], page);		\
+	return ret < 0 ? ret : count;					\
+}									\
+CONFIGFS_ATTR(nullb_device_, NAME##_latency);
+
+NULLB_DEVICE_LAT_ATTR(read, NULLB_LAT_READ);
+NULLB_DEVICE_LAT_ATTR(write, NULLB_LAT_WRITE);
+NULLB_DEVICE_LAT_ATTR(other, NULLB_LAT_OTHER);
 
 static ssize_t nullb_device_power_show(struct config_item *item, char *page)
 {
@@ -461,6 +496,39 @@ static ssize_t nullb_device_badblocks_store(struct config_item *item,
 }
 CONFIGFS_ATTR(nullb_device_, badblocks);
 
+/*
+ * Latency trace replayed instead of the distributions, see
+ * null_lat_trace_load() for the format.
+ */
+static ssize_t nullb_device_latency_trace_read(struct config_item *item,
+					       void *buf, size_t size)
+{
+	ssize_t ret;
+
+	mutex_lock(&lock);
+	ret = null_lat_trace_dump(to_nullb_device(item), buf, size);
+	mutex_unlock(&lock);
+
+	return ret;
+}
+
+static ssize_t nullb_device_latency_trace_write(struct config_item *item,
+						const void *buf, size_t size)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	ssize_t ret;
+
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))
+		return -EBUSY;
+
+	mutex_lock(&lock);
+	ret = null_lat_trace_load(dev, buf, size);
+	mutex_unlock(&lock);
+
+	return ret;
+}
+CONFIGFS_BIN_ATTR(nullb_device_, latency_trace, NULL, SZ_16M);
+
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
@@ -486,6 +554,17 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_zone_nr_conv,
 	&nullb_device_attr_zone_max_open,
 	&nullb_device_attr_zone_max_active,
+	&nullb_device_attr_read_latency,
+	&nullb_device_attr_write_latency,
+	&nullb_device_attr_other_latency,
+	&nullb_device_attr_qd_latency_nsec,
+	&nullb_device_attr_gc_period_msec,
+	&nullb_device_attr_gc_stall_usec,
+	NULL,
+};
+
+static struct configfs_bin_attribute *nullb_device_bin_attrs[] = {
+	&nullb_device_attr_latency_trace,
 	NULL,
 };
 
@@ -504,6 +583,7 @@ static struct configfs_item_operations nullb_device_ops = {
 static const struct config_item_type nullb_device_type = {
 	.ct_item_ops	= &nullb_device_ops,
 	.ct_attrs	= nullb_device_attrs,
+	.ct_bin_attrs	= nullb_device_bin_attrs,
 	.ct_owner	= THIS_MODULE,
 };
 
@@ -539,7 +619,8 @@ nullb_group_drop_item(struct config_group *group, struct config_item *item)
 static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
-			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv,zone_max_open,zone_max_active,blocksize,max_sectors\n");
+			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv,zone_max_open,zone_max_active,blocksize,max_sectors,"
+			"read_latency,write_latency,other_latency,qd_latency_nsec,gc_period_msec,gc_stall_usec,latency_trace\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -614,6 +695,7 @@ static void null_free_dev(struct nullb_device *dev)
 		return;
 
 	null_free_zoned_dev(dev);
+	null_lat_trace_free(dev);
 	badblocks_exit(&dev->badblocks);
 	kfree(dev);
 }
@@ -709,14 +791,28 @@ static void end_cmd(struct nullb_cmd *cmd)
 
 static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 {
-	end_cmd(container_of(timer, struct nullb_cmd, timer));
+	struct nullb_cmd *cmd = container_of(timer, struct nullb_cmd, timer);
+	struct nullb_device *dev = cmd->nq->dev;
+
+	if (test_bit(NULLB_DEV_FL_LATENCY, &dev->flags))
+		null_lat_cmd_done(dev);
+
+	end_cmd(cmd);
 
 	return HRTIMER_NORESTART;
 }
 
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	struct nullb_device *dev = cmd->nq->dev;
+	ktime_t kt = dev->completion_nsec;
+
+	if (test_bit(NULLB_DEV_FL_LATENCY, &dev->flags)) {
+		enum req_opf op = dev->queue_mode == NULL_Q_BIO ?
+				  bio_op(cmd->bio) : req_op(cmd->rq);
+
+		kt = null_lat_cmd_nsec(dev, op);
+	}
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
@@ -1762,6 +1858,18 @@ static int null_validate_conf(struct nullb_device *dev)
 		return -EINVAL;
 	}
 
+	/* Latency models set the completion time of the per command timer */
+	if (null_lat_configured(dev) && dev->irqmode != NULL_IRQ_TIMER) {
+		pr_err("latency models require irqmode=%d\n", NULL_IRQ_TIMER);
+		return -EINVAL;
+	}
+
+	if (dev->gc_period_msec && dev->gc_stall_usec &&
+	    dev->gc_stall_usec >= dev->gc_period_msec * 1000) {
+		pr_err("gc_stall_usec must be shorter than gc_period_msec\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -1852,6 +1960,13 @@ static int null_add_dev(struct nullb_device *dev)
 		nullb_setup_bwtimer(nullb);
 	}
 
+	if (null_lat_configured(dev)) {
+		null_lat_start(dev);
+		set_bit(NULLB_DEV_FL_LATENCY, &dev->flags);
+	} else {
+		clear_bit(NULLB_DEV_FL_LATENCY, &dev->flags);
+	}
+
 	if (dev->cache_size > 0) {
 		set_bit(NULLB_DEV_FL_CACHE, &nullb->dev->flags);
 		blk_queue_write_cache(nullb->q, true, true);
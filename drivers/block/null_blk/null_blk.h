@@ -54,6 +54,35 @@ struct nullb_zone {
 	unsigned int capacity;
 };
 
+/* Operation classes with their own latency model */
+enum {
+	NULLB_LAT_READ,
+	NULLB_LAT_WRITE,
+	NULLB_LAT_OTHER,
+	NULLB_LAT_NR,
+};
+
+enum nullb_lat_type {
+	NULLB_LAT_NONE,
+	NULLB_LAT_FIXED,
+	NULLB_LAT_UNIFORM,
+	NULLB_LAT_NORMAL,
+};
+
+/* Completion time distribution of an operation class, in ns */
+struct nullb_lat_dist {
+	enum nullb_lat_type type;
+	u64 p1; /* fixed value, uniform minimum or normal mean */
+	u64 p2; /* uniform maximum or normal standard deviation */
+};
+
+/* Recorded completion times, replayed in order and then over again */
+struct nullb_lat_trace {
+	u64 *nsec;
+	unsigned int nr;
+	atomic_t pos;
+};
+
 struct nullb_device {
 	struct nullb *nullb;
 	struct config_item item;
@@ -73,8 +102,16 @@ struct nullb_device {
 	bool need_zone_res_mgmt;
 	spinlock_t zone_res_lock;
 
+	struct nullb_lat_dist lat_dist[NULLB_LAT_NR];
+	struct nullb_lat_trace lat_trace[NULLB_LAT_NR];
+	atomic_t lat_inflight; /* commands waiting for their completion */
+	ktime_t lat_epoch; /* time origin of the GC stall periods */
+
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	unsigned long qd_latency_nsec; /* time in ns added per queued request */
+	unsigned long gc_period_msec; /* period of simulated GC stalls in ms */
+	unsigned long gc_stall_usec; /* duration of simulated GC stalls in us */
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
@@ -123,6 +160,17 @@ blk_status_t null_process_cmd(struct nullb_cmd *cmd,
 			      enum req_opf op, sector_t sector,
 			      unsigned int nr_sectors);
 
+int null_lat_dist_parse(struct nullb_lat_dist *dist, const char *page);
+ssize_t null_lat_dist_show(const struct nullb_lat_dist *dist, char *page);
+ssize_t null_lat_trace_load(struct nullb_device *dev, const void *buf,
+			    size_t count);
+ssize_t null_lat_trace_dump(struct nullb_device *dev, void *buf, size_t size);
+void null_lat_trace_free(struct nullb_device *dev);
+bool null_lat_configured(struct nullb_device *dev);
+void null_lat_start(struct nullb_device *dev);
+u64 null_lat_cmd_nsec(struct nullb_device *dev, enum req_opf op);
+void null_lat_cmd_done(struct nullb_device *dev);
+
 #ifdef CONFIG_BLK_DEV_ZONED
 int null_init_zoned_dev(struct nullb_device *dev, struct request_queue *q);
 int null_register_zoned_dev(struct nullb *nullb);
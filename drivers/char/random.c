@@ -761,18 +761,15 @@ static int credit_entropy_bits_safe(struct entropy_store *r, int nbits)
 
 static DECLARE_WAIT_QUEUE_HEAD(crng_init_wait);
 
-#ifdef CONFIG_NUMA
 /*
- * Hack to deal with crazy userspace progams when they are all trying
- * to access /dev/urandom in parallel.  The programs are almost
- * certainly doing something terribly wrong, but we'll work around
- * their brain damage.
+ * Once the primary CRNG is initialized, each CPU gets its own CRNG, seeded
+ * and periodically reseeded from the primary one, so that readers on
+ * different CPUs don't contend on a single lock.
  */
-static struct crng_state **crng_node_pool __read_mostly;
-#endif
+static struct crng_state __percpu *crng_cpu_pool __read_mostly;
 
 static void invalidate_batched_entropy(void);
-static void numa_crng_init(void);
+static void percpu_crng_init(void);
 
 static bool trust_cpu __ro_after_init = IS_ENABLED(CONFIG_RANDOM_TRUST_CPU);
 static int __init parse_trust_cpu(char *arg)
@@ -817,7 +814,7 @@ static bool __init crng_init_try_arch_early(struct crng_state *crng)
 	return arch_init;
 }
 
-static void __maybe_unused crng_initialize_secondary(struct crng_state *crng)
+static void crng_initialize_secondary(struct crng_state *crng)
 {
 	memcpy(&crng->state[0], "expand 32-byte k", 16);
 	_get_random_bytes(&crng->state[4], sizeof(__u32) * 12);
@@ -831,45 +828,43 @@ static void __init crng_initialize_primary(struct crng_state *crng)
 	_extract_entropy(&input_pool, &crng->state[4], sizeof(__u32) * 12, 0);
 	if (crng_init_try_arch_early(crng) && trust_cpu) {
 		invalidate_batched_entropy();
-		numa_crng_init();
+		percpu_crng_init();
 		crng_init = 2;
 		pr_notice("crng done (trusting CPU's manufacturer)\n");
 	}
 	crng->init_time = jiffies - CRNG_RESEED_INTERVAL - 1;
 }
 
-#ifdef CONFIG_NUMA
-static void do_numa_crng_init(struct work_struct *work)
+static void do_percpu_crng_init(struct work_struct *work)
 {
-	int i;
+	int cpu;
 	struct crng_state *crng;
-	struct crng_state **pool;
+	struct crng_state __percpu *pool;
 
-	pool = kcalloc(nr_node_ids, sizeof(*pool), GFP_KERNEL|__GFP_NOFAIL);
-	for_each_online_node(i) {
-		crng = kmalloc_node(sizeof(struct crng_state),
-				    GFP_KERNEL | __GFP_NOFAIL, i);
+	/* Without a pool, everything keeps on using the primary CRNG */
+	pool = alloc_percpu(struct crng_state);
+	if (!pool)
+		return;
+	for_each_possible_cpu(cpu) {
+		crng = per_cpu_ptr(pool, cpu);
 		spin_lock_init(&crng->lock);
 		crng_initialize_secondary(crng);
-		pool[i] = crng;
 	}
 	mb();
-	if (cmpxchg(&crng_node_pool, NULL, pool)) {
-		for_each_node(i)
-			kfree(pool[i]);
-		kfree(pool);
+	if (cmpxchg(&crng_cpu_pool, NULL, pool)) {
+		for_each_possible_cpu(cpu)
+			memzero_explicit(per_cpu_ptr(pool, cpu),
+					 sizeof(struct crng_state));
+		free_percpu(pool);
 	}
 }
 
-static DECLARE_WORK(numa_crng_init_work, do_numa_crng_init);
+static DECLARE_WORK(percpu_crng_init_work, do_percpu_crng_init);
 
-static void numa_crng_init(void)
+static void percpu_crng_init(void)
 {
-	schedule_work(&numa_crng_init_work);
+	schedule_work(&percpu_crng_init_work);
 }
-#else
-static void numa_crng_init(void) {}
-#endif
 
 /*
  * crng_fast_load() can be called by code in the interrupt service
@@ -976,7 +971,7 @@ static void crng_reseed(struct crng_state *crng, struct entropy_store *r)
 	spin_unlock_irqrestore(&crng->lock, flags);
 	if (crng == &primary_crng && crng_init < 2) {
 		invalidate_batched_entropy();
-		numa_crng_init();
+		percpu_crng_init();
 		crng_init = 2;
 		process_random_ready_list();
 		wake_up_interruptible(&crng_init_wait);
@@ -1013,17 +1008,24 @@ static void _extract_crng(struct crng_state *crng,
 	spin_unlock_irqrestore(&crng->lock, flags);
 }
 
-static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+/*
+ * A task may migrate once its CRNG is selected, using the CRNG of another CPU
+ * is fine since each one is protected by its own lock. Callers extracting a
+ * block and then protecting it against backtracking select the CRNG once, so
+ * that both act on the same one.
+ */
+static struct crng_state *select_crng(void)
 {
-	struct crng_state *crng = NULL;
+	struct crng_state __percpu *pool = READ_ONCE(crng_cpu_pool);
 
-#ifdef CONFIG_NUMA
-	if (crng_node_pool)
-		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
-#endif
-		crng = &primary_crng;
-	_extract_crng(crng, out);
+	if (pool)
+		return raw_cpu_ptr(pool);
+	return &primary_crng;
+}
+
+static void extract_crng(__u8 out[CHACHA_BLOCK_SIZE])
+{
+	_extract_crng(select_crng(), out);
 }
 
 /*
@@ -1039,7 +1041,7 @@ static void _crng_backtrack_protect(struct crng_state *crng,
 
 	used = round_up(used, sizeof(__u32));
 	if (used + CHACHA_KEY_SIZE > CHACHA_BLOCK_SIZE) {
-		extract_crng(tmp);
+		_extract_crng(crng, tmp);
 		used = 0;
 	}
 	spin_lock_irqsave(&crng->lock, flags);
@@ -1050,25 +1052,53 @@ static void _crng_backtrack_protect(struct crng_state *crng,
 	spin_unlock_irqrestore(&crng->lock, flags);
 }
 
-static void crng_backtrack_protect(__u8 tmp[CHACHA_BLOCK_SIZE], int used)
+/*
+ * Set up a private ChaCha20 state keyed from a single CRNG output block, the
+ * other half of which replaces the CRNG key right away.  The caller can then
+ * generate as much output as it needs without touching the CRNG, and the
+ * output can't be recovered from the CRNG state.  The state must be wiped
+ * once done with.
+ */
+static void crng_fork_state(__u32 state[CHACHA_STATE_WORDS])
 {
-	struct crng_state *crng = NULL;
+	struct crng_state *crng = select_crng();
+	__u8 tmp[CHACHA_BLOCK_SIZE] __aligned(4);
 
-#ifdef CONFIG_NUMA
-	if (crng_node_pool)
-		crng = crng_node_pool[numa_node_id()];
-	if (crng == NULL)
-#endif
-		crng = &primary_crng;
-	_crng_backtrack_protect(crng, tmp, used);
+	_extract_crng(crng, tmp);
+	_crng_backtrack_protect(crng, tmp, CHACHA_KEY_SIZE);
+	memcpy(&state[0], "expand 32-byte k", 16);
+	memcpy(&state[4], tmp, CHACHA_KEY_SIZE);
+	memset(&state[12], 0, 4 * sizeof(__u32));
+	memzero_explicit(tmp, sizeof(tmp));
 }
 
 static ssize_t extract_crng_user(void __user *buf, size_t nbytes)
 {
-	ssize_t ret = 0, i = CHACHA_BLOCK_SIZE;
+	ssize_t ret = 0, i;
+	__u32 state[CHACHA_STATE_WORDS];
 	__u8 tmp[CHACHA_BLOCK_SIZE] __aligned(4);
 	int large_request = (nbytes > 256);
 
+	if (!nbytes)
+		return 0;
+
+	/* Small requests fit in a single block, no need to fork the CRNG */
+	if (nbytes <= CHACHA_BLOCK_SIZE - CHACHA_KEY_SIZE) {
+		struct crng_state *crng = select_crng();
+
+		_extract_crng(crng, tmp);
+		i = nbytes;
+		if (copy_to_user(buf, tmp, i))
+			ret = -EFAULT;
+		else
+			ret = i;
+		_crng_backtrack_protect(crng, tmp, i);
+		memzero_explicit(tmp, sizeof(tmp));
+		return ret;
+	}
+
+	crng_fork_state(state);
+
 	while (nbytes) {
 		if (large_request && need_resched()) {
 			if (signal_pending(current)) {
@@ -1079,7 +1109,9 @@ static ssize_t extract_crng_user(void __user *buf, size_t nbytes)
 			schedule();
 		}
 
-		extract_crng(tmp);
+		chacha20_block(state, tmp);
+		if (state[12] == 0)
+			state[13]++;
 		i = min_t(int, nbytes, CHACHA_BLOCK_SIZE);
 		if (copy_to_user(buf, tmp, i)) {
 			ret = -EFAULT;
@@ -1090,9 +1122,9 @@ static ssize_t extract_crng_user(void __user *buf, size_t nbytes)
 		buf += i;
 		ret += i;
 	}
-	crng_backtrack_protect(tmp, i);
 
 	/* Wipe data just written to memory */
+	memzero_explicit(state, sizeof(state));
 	memzero_explicit(tmp, sizeof(tmp));
 
 	return ret;
@@ -1548,22 +1580,23 @@ static void _warn_unseeded_randomness(const char *func_name, void *caller,
  */
 static void _get_random_bytes(void *buf, int nbytes)
 {
+	struct crng_state *crng = select_crng();
 	__u8 tmp[CHACHA_BLOCK_SIZE] __aligned(4);
 
 	trace_get_random_bytes(nbytes, _RET_IP_);
 
 	while (nbytes >= CHACHA_BLOCK_SIZE) {
-		extract_crng(buf);
+		_extract_crng(crng, buf);
 		buf += CHACHA_BLOCK_SIZE;
 		nbytes -= CHACHA_BLOCK_SIZE;
 	}
 
 	if (nbytes > 0) {
-		extract_crng(tmp);
+		_extract_crng(crng, tmp);
 		memcpy(buf, tmp, nbytes);
-		crng_backtrack_protect(tmp, nbytes);
+		_crng_backtrack_protect(crng, tmp, nbytes);
 	} else
-		crng_backtrack_protect(tmp, CHACHA_BLOCK_SIZE);
+		_crng_backtrack_protect(crng, tmp, CHACHA_BLOCK_SIZE);
 	memzero_explicit(tmp, sizeof(tmp));
 }
 
@@ -442,7 +442,8 @@ static int cs2000_clk_register(struct cs2000_priv *priv)
 
 	init.name		= name;
 	init.ops		= &cs2000_ops;
-	init.flags		= CLK_SET_RATE_GATE;
+	/* PLL relocks over I2C must not hold up unrelated clocks */
+	init.flags		= CLK_SET_RATE_GATE | CLK_LOCK_DOMAIN;
 	init.parent_names	= parent_names;
 	init.num_parents	= ARRAY_SIZE(parent_names);
 
@@ -11,6 +11,7 @@
 #include <linux/clk/clk-conf.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/rwsem.h>
 #include <linux/spinlock.h>
 #include <linux/err.h>
 #include <linux/list.h>
@@ -25,14 +26,20 @@
 #include "clk.h"
 
 static DEFINE_SPINLOCK(enable_lock);
-static DEFINE_MUTEX(prepare_lock);
+static DECLARE_RWSEM(prepare_lock);
+static DEFINE_MUTEX(nested_prepare_lock);
+static DEFINE_SPINLOCK(clk_domain_busy_lock);
 
 static struct task_struct *prepare_owner;
+static struct task_struct *nested_prepare_owner;
 static struct task_struct *enable_owner;
 
 static int prepare_refcnt;
+static int nested_prepare_refcnt;
 static int enable_refcnt;
 
+static LIST_HEAD(clk_domain_busy_list);
+
 static HLIST_HEAD(clk_root_list);
 static HLIST_HEAD(clk_orphan_list);
 static LIST_HEAD(clk_notifier_list);
@@ -45,6 +52,26 @@ static struct hlist_head *all_lists[] = {
 
 /***    private data structures    ***/
 
+/**
+ * struct clk_lock_domain - lock of a clock subtree
+ * @lock: serializes the operations on the clocks of the domain
+ * @key: lockdep class of @lock, domains may nest in any order
+ * @root: clock whose CLK_LOCK_DOMAIN flag created the domain
+ * @owner: task holding @lock
+ * @refcnt: number of times @owner took @lock
+ * @put_read: whether @owner took prepare_lock for reading along with @lock
+ * @busy_node: entry in clk_domain_busy_list while @lock is held
+ */
+struct clk_lock_domain {
+	struct mutex		lock;
+	struct lock_class_key	key;
+	struct clk_core		*root;
+	struct task_struct	*owner;
+	int			refcnt;
+	bool			put_read;
+	struct list_head	busy_node;
+};
+
 struct clk_parent_map {
 	const struct clk_hw	*hw;
 	struct clk_core		*core;
@@ -69,6 +96,8 @@ struct clk_core {
 	unsigned long		new_rate;
 	struct clk_core		*new_parent;
 	struct clk_core		*new_child;
+	struct clk_lock_domain	*domain;
+	struct clk_lock_domain	*own_domain;
 	unsigned long		flags;
 	bool			orphan;
 	bool			rpm_enabled;
@@ -130,14 +159,93 @@ static void clk_pm_runtime_put(struct clk_core *core)
 }
 
 /***           locking             ***/
+
+/*
+ * The clock tree is protected by prepare_lock. Holding it for writing, through
+ * clk_prepare_lock(), gives exclusive access to all clocks.
+ *
+ * Clocks registered with CLK_LOCK_DOMAIN start a lock domain which covers them
+ * and all their descendants. Preparing, unpreparing and changing the rate of a
+ * clock of a domain only takes prepare_lock for reading along with the lock of
+ * the domain, see clk_core_lock(), so that such operations don't wait for the
+ * ones in other domains. The topology can't change while prepare_lock is held
+ * for reading, except for reparenting a clock within its domain.
+ *
+ * The clocks outside of lock domains, e.g. the parents of the domain roots, are
+ * still accessed under clk_prepare_lock(). When called with the lock of a
+ * domain held, it takes nested_prepare_lock instead, as prepare_lock is
+ * already held for reading. That doesn't exclude the holders of other domains,
+ * so operations which would then modify clocks of a domain the task doesn't
+ * hold, or move clocks between domains, fail with -EDEADLK, see
+ * clk_core_locked().
+ */
+static void clk_lock_wait_trace(const char *name, u64 start)
+{
+	if (start)
+		trace_clk_lock_wait(name, ktime_get_ns() - start);
+}
+
+static u64 clk_lock_wait_start(void)
+{
+	return trace_clk_lock_wait_enabled() ? ktime_get_ns() : 0;
+}
+
+/* Whether the current task holds the lock of a domain */
+static bool clk_domain_held(void)
+{
+	struct clk_lock_domain *domain;
+	bool held = false;
+
+	/*
+	 * A task holding a domain added it to the list itself, so it sees the
+	 * list as non-empty. This keeps clk_domain_busy_lock off the common
+	 * path, where no domain is held or none is registered at all.
+	 */
+	if (list_empty(&clk_domain_busy_list))
+		return false;
+
+	spin_lock(&clk_domain_busy_lock);
+	list_for_each_entry(domain, &clk_domain_busy_list, busy_node) {
+		if (domain->owner == current) {
+			held = true;
+			break;
+		}
+	}
+	spin_unlock(&clk_domain_busy_lock);
+
+	return held;
+}
+
 static void clk_prepare_lock(void)
 {
-	if (!mutex_trylock(&prepare_lock)) {
-		if (prepare_owner == current) {
-			prepare_refcnt++;
-			return;
+	u64 start;
+
+	if (prepare_owner == current) {
+		prepare_refcnt++;
+		return;
+	}
+
+	if (nested_prepare_owner == current) {
+		nested_prepare_refcnt++;
+		return;
+	}
+
+	if (clk_domain_held()) {
+		if (!mutex_trylock(&nested_prepare_lock)) {
+			start = clk_lock_wait_start();
+			mutex_lock(&nested_prepare_lock);
+			clk_lock_wait_trace("prepare_nested", start);
 		}
-		mutex_lock(&prepare_lock);
+		WARN_ON_ONCE(nested_prepare_owner != NULL);
+		nested_prepare_owner = current;
+		nested_prepare_refcnt = 1;
+		return;
+	}
+
+	if (!down_write_trylock(&prepare_lock)) {
+		start = clk_lock_wait_start();
+		down_write(&prepare_lock);
+		clk_lock_wait_trace("prepare", start);
 	}
 	WARN_ON_ONCE(prepare_owner != NULL);
 	WARN_ON_ONCE(prepare_refcnt != 0);
@@ -147,19 +255,236 @@ static void clk_prepare_lock(void)
 
 static void clk_prepare_unlock(void)
 {
+	if (nested_prepare_owner == current) {
+		WARN_ON_ONCE(nested_prepare_refcnt == 0);
+		if (--nested_prepare_refcnt)
+			return;
+		nested_prepare_owner = NULL;
+		mutex_unlock(&nested_prepare_lock);
+		return;
+	}
+
 	WARN_ON_ONCE(prepare_owner != current);
 	WARN_ON_ONCE(prepare_refcnt == 0);
 
 	if (--prepare_refcnt)
 		return;
 	prepare_owner = NULL;
-	mutex_unlock(&prepare_lock);
+	up_write(&prepare_lock);
+}
+
+/* Whether the current task only holds the lock of a domain */
+static bool clk_domain_locked_only(void)
+{
+	return prepare_owner != current && nested_prepare_owner != current;
+}
+
+/**
+ * clk_core_lock - lock a clock for preparing it or changing its rate
+ * @core: the clock
+ *
+ * Take the lock of the domain of @core, or clk_prepare_lock() if @core doesn't
+ * belong to any domain or if the current task already holds it.
+ *
+ * Return: the domain locked, NULL if clk_prepare_lock() was taken.
+ */
+static struct clk_lock_domain *clk_core_lock(struct clk_core *core)
+{
+	struct clk_lock_domain *domain;
+	bool held;
+	u64 start;
+
+	if (!READ_ONCE(core->domain) || !clk_domain_locked_only()) {
+		clk_prepare_lock();
+		return NULL;
+	}
+
+	/* The lock of a domain nests inside prepare_lock held for reading */
+	held = clk_domain_held();
+	if (!held && !down_read_trylock(&prepare_lock)) {
+		start = clk_lock_wait_start();
+		down_read(&prepare_lock);
+		clk_lock_wait_trace("prepare_read", start);
+	}
+
+	/* Domains only change with prepare_lock held for writing */
+	domain = core->domain;
+	if (!domain) {
+		if (!held)
+			up_read(&prepare_lock);
+		clk_prepare_lock();
+		return NULL;
+	}
+
+	if (domain->owner == current) {
+		domain->refcnt++;
+		return domain;
+	}
+
+	if (!mutex_trylock(&domain->lock)) {
+		start = clk_lock_wait_start();
+		mutex_lock(&domain->lock);
+		clk_lock_wait_trace(domain->root->name, start);
+	}
+	domain->owner = current;
+	domain->refcnt = 1;
+	domain->put_read = !held;
+
+	spin_lock(&clk_domain_busy_lock);
+	list_add(&domain->busy_node, &clk_domain_busy_list);
+	spin_unlock(&clk_domain_busy_lock);
+
+	return domain;
+}
+
+static void clk_core_unlock(struct clk_lock_domain *domain)
+{
+	bool put_read;
+
+	if (!domain) {
+		clk_prepare_unlock();
+		return;
+	}
+
+	WARN_ON_ONCE(domain->owner != current);
+	WARN_ON_ONCE(domain->refcnt == 0);
+
+	if (--domain->refcnt)
+		return;
+
+	spin_lock(&clk_domain_busy_lock);
+	list_del(&domain->busy_node);
+	spin_unlock(&clk_domain_busy_lock);
+
+	put_read = domain->put_read;
+	domain->owner = NULL;
+	mutex_unlock(&domain->lock);
+	if (put_read)
+		up_read(&prepare_lock);
+}
+
+/*
+ * Whether the current task may modify @core. Without prepare_lock held for
+ * writing, the clock must be outside of any domain or in one the task holds:
+ * nested_prepare_lock doesn't exclude the holders of other domains.
+ */
+static bool clk_core_locked(struct clk_core *core)
+{
+	struct clk_lock_domain *domain = core->domain;
+
+	return prepare_owner == current || !domain || domain->owner == current;
+}
+
+/* Same for @core and all its descendants, which a rate change walks */
+static bool clk_core_subtree_locked(struct clk_core *core)
+{
+	struct clk_core *child;
+
+	if (!clk_core_locked(core))
+		return false;
+
+	/* The descendants of a clock in a domain are all in that domain */
+	if (prepare_owner == current || core->domain)
+		return true;
+
+	hlist_for_each_entry(child, &core->children, child_node)
+		if (!clk_core_subtree_locked(child))
+			return false;
+
+	return true;
+}
+
+/*
+ * Whether the current task may reparent @core to @parent: a clock only moves
+ * to another domain with prepare_lock held for writing.
+ */
+static bool clk_core_reparent_locked(struct clk_core *core,
+				     struct clk_core *parent)
+{
+	struct clk_lock_domain *domain = core->own_domain;
+
+	if (prepare_owner == current)
+		return true;
+
+	if (parent && parent->domain)
+		domain = parent->domain;
+
+	return domain == core->domain && (!parent || clk_core_locked(parent));
+}
+
+/*
+ * Walking up from the root of a domain to its parent leaves the domain, the
+ * parent can only be accessed under clk_prepare_lock().
+ */
+static bool clk_core_lock_parent(struct clk_core *core)
+{
+	if (!core->domain || !core->parent || core->parent->domain)
+		return false;
+
+	clk_prepare_lock();
+	return true;
+}
+
+static void clk_core_unlock_parent(bool locked)
+{
+	if (locked)
+		clk_prepare_unlock();
+}
+
+static struct clk_lock_domain *clk_lock_domain_alloc(struct clk_core *core)
+{
+	struct clk_lock_domain *domain;
+
+	domain = kzalloc(sizeof(*domain), GFP_KERNEL);
+	if (!domain)
+		return NULL;
+
+	lockdep_register_key(&domain->key);
+	mutex_init(&domain->lock);
+	lockdep_set_class(&domain->lock, &domain->key);
+	domain->root = core;
+
+	return domain;
+}
+
+static void clk_lock_domain_free(struct clk_lock_domain *domain)
+{
+	if (!domain)
+		return;
+
+	mutex_destroy(&domain->lock);
+	lockdep_unregister_key(&domain->key);
+	kfree(domain);
+}
+
+/*
+ * A clock belongs to the domain of its parent if any, or to its own domain if
+ * registered with CLK_LOCK_DOMAIN.
+ */
+static void clk_core_update_domain(struct clk_core *core)
+{
+	struct clk_lock_domain *domain = core->own_domain;
+	struct clk_core *child;
+
+	if (core->parent && core->parent->domain)
+		domain = core->parent->domain;
+
+	if (core->domain == domain)
+		return;
+
+	/* Clocks can only move between domains under clk_prepare_lock() */
+	WARN_ON_ONCE(prepare_owner != current);
+
+	core->domain = domain;
+	hlist_for_each_entry(child, &core->children, child_node)
+		clk_core_update_domain(child);
 }
 
 static unsigned long clk_enable_lock(void)
 	__acquires(enable_lock)
 {
 	unsigned long flags;
+	u64 start;
 
 	/*
 	 * On UP systems, spin_trylock_irqsave() always returns true, even if
@@ -175,7 +500,9 @@ static unsigned long clk_enable_lock(void)
 				local_save_flags(flags);
 			return flags;
 		}
+		start = clk_lock_wait_start();
 		spin_lock_irqsave(&enable_lock, flags);
+		clk_lock_wait_trace("enable", start);
 	}
 	WARN_ON_ONCE(enable_owner != NULL);
 	WARN_ON_ONCE(enable_refcnt != 0);
@@ -668,6 +995,8 @@ EXPORT_SYMBOL_GPL(__clk_mux_determine_rate_closest);
 
 static void clk_core_rate_unprotect(struct clk_core *core)
 {
+	bool locked;
+
 	lockdep_assert_held(&prepare_lock);
 
 	if (!core)
@@ -680,7 +1009,9 @@ static void clk_core_rate_unprotect(struct clk_core *core)
 	if (--core->protect_count > 0)
 		return;
 
+	locked = clk_core_lock_parent(core);
 	clk_core_rate_unprotect(core->parent);
+	clk_core_unlock_parent(locked);
 }
 
 static int clk_core_rate_nuke_protect(struct clk_core *core)
@@ -743,13 +1074,18 @@ EXPORT_SYMBOL_GPL(clk_rate_exclusive_put);
 
 static void clk_core_rate_protect(struct clk_core *core)
 {
+	bool locked;
+
 	lockdep_assert_held(&prepare_lock);
 
 	if (!core)
 		return;
 
-	if (core->protect_count == 0)
+	if (core->protect_count == 0) {
+		locked = clk_core_lock_parent(core);
 		clk_core_rate_protect(core->parent);
+		clk_core_unlock_parent(locked);
+	}
 
 	core->protect_count++;
 }
@@ -802,6 +1138,8 @@ EXPORT_SYMBOL_GPL(clk_rate_exclusive_get);
 
 static void clk_core_unprepare(struct clk_core *core)
 {
+	bool locked;
+
 	lockdep_assert_held(&prepare_lock);
 
 	if (!core)
@@ -831,14 +1169,22 @@ static void clk_core_unprepare(struct clk_core *core)
 	clk_pm_runtime_put(core);
 
 	trace_clk_unprepare_complete(core);
+
+	locked = clk_core_lock_parent(core);
 	clk_core_unprepare(core->parent);
+	clk_core_unlock_parent(locked);
 }
 
 static void clk_core_unprepare_lock(struct clk_core *core)
 {
-	clk_prepare_lock();
+	struct clk_lock_domain *domain;
+
+	if (!core)
+		return;
+
+	domain = clk_core_lock(core);
 	clk_core_unprepare(core);
-	clk_prepare_unlock();
+	clk_core_unlock(domain);
 }
 
 /**
@@ -863,6 +1209,7 @@ EXPORT_SYMBOL_GPL(clk_unprepare);
 
 static int clk_core_prepare(struct clk_core *core)
 {
+	bool locked;
 	int ret = 0;
 
 	lockdep_assert_held(&prepare_lock);
@@ -875,7 +1222,9 @@ static int clk_core_prepare(struct clk_core *core)
 		if (ret)
 			return ret;
 
+		locked = clk_core_lock_parent(core);
 		ret = clk_core_prepare(core->parent);
+		clk_core_unlock_parent(locked);
 		if (ret)
 			goto runtime_put;
 
@@ -904,7 +1253,9 @@ static int clk_core_prepare(struct clk_core *core)
 
 	return 0;
 unprepare:
+	locked = clk_core_lock_parent(core);
 	clk_core_unprepare(core->parent);
+	clk_core_unlock_parent(locked);
 runtime_put:
 	clk_pm_runtime_put(core);
 	return ret;
@@ -912,11 +1263,15 @@ static int clk_core_prepare(struct clk_core *core)
 
 static int clk_core_prepare_lock(struct clk_core *core)
 {
+	struct clk_lock_domain *domain;
 	int ret;
 
-	clk_prepare_lock();
+	if (!core)
+		return 0;
+
+	domain = clk_core_lock(core);
 	ret = clk_core_prepare(core);
-	clk_prepare_unlock();
+	clk_core_unlock(domain);
 
 	return ret;
 }
@@ -1532,7 +1887,8 @@ static void __clk_recalc_accuracies(struct clk_core *core)
 
 static long clk_core_get_accuracy_recalc(struct clk_core *core)
 {
-	if (core && (core->flags & CLK_GET_ACCURACY_NOCACHE))
+	if (core && (core->flags & CLK_GET_ACCURACY_NOCACHE) &&
+	    clk_core_subtree_locked(core))
 		__clk_recalc_accuracies(core);
 
 	return clk_core_get_accuracy_no_lock(core);
@@ -1614,7 +1970,8 @@ static void __clk_recalc_rates(struct clk_core *core, unsigned long msg)
 
 static unsigned long clk_core_get_rate_recalc(struct clk_core *core)
 {
-	if (core && (core->flags & CLK_GET_RATE_NOCACHE))
+	if (core && (core->flags & CLK_GET_RATE_NOCACHE) &&
+	    clk_core_subtree_locked(core))
 		__clk_recalc_rates(core, 0);
 
 	return clk_core_get_rate_nolock(core);
@@ -1741,6 +2098,7 @@ static void clk_reparent(struct clk_core *core, struct clk_core *new_parent)
 	}
 
 	core->parent = new_parent;
+	clk_core_update_domain(core);
 }
 
 static struct clk_core *__clk_set_parent_before(struct clk_core *core,
@@ -1904,9 +2262,22 @@ static void clk_calc_subtree(struct clk_core *core, unsigned long new_rate,
 	}
 }
 
+/*
+ * With only the lock of its domain held, a rate change can't touch clocks
+ * outside of the domain.
+ */
+static bool clk_core_rate_leaves_domain(struct clk_core *core,
+					struct clk_core *parent)
+{
+	return parent && parent->domain != core->domain &&
+	       clk_domain_locked_only();
+}
+
 /*
  * calculate the new rates returning the topmost clock that has to be
- * changed.
+ * changed, ERR_PTR(-EXDEV) if that requires clk_prepare_lock(), or
+ * ERR_PTR(-EDEADLK) if it reaches clocks of a domain the current task, which
+ * already holds another domain, doesn't hold.
  */
 static struct clk_core *clk_calc_new_rates(struct clk_core *core,
 					   unsigned long rate)
@@ -1924,6 +2295,9 @@ static struct clk_core *clk_calc_new_rates(struct clk_core *core,
 	if (IS_ERR_OR_NULL(core))
 		return NULL;
 
+	if (!clk_core_subtree_locked(core))
+		return ERR_PTR(-EDEADLK);
+
 	/* save parent rate, if it exists */
 	parent = old_parent = core->parent;
 	if (parent)
@@ -1957,11 +2331,23 @@ static struct clk_core *clk_calc_new_rates(struct clk_core *core,
 		return NULL;
 	} else {
 		/* pass-through clock with adjustable parent */
+		if (clk_core_rate_leaves_domain(core, parent))
+			return ERR_PTR(-EXDEV);
 		top = clk_calc_new_rates(parent, rate);
+		if (IS_ERR(top))
+			return top;
 		new_rate = parent->new_rate;
 		goto out;
 	}
 
+	if (parent != old_parent &&
+	    (clk_core_rate_leaves_domain(core, parent) ||
+	     clk_core_rate_leaves_domain(core, old_parent)))
+		return ERR_PTR(-EXDEV);
+
+	if (parent != old_parent && !clk_core_reparent_locked(core, parent))
+		return ERR_PTR(-EDEADLK);
+
 	/* some clocks must be gated to change parent */
 	if (parent != old_parent &&
 	    (core->flags & CLK_SET_PARENT_GATE) && core->prepare_count) {
@@ -1981,8 +2367,13 @@ static struct clk_core *clk_calc_new_rates(struct clk_core *core,
 	}
 
 	if ((core->flags & CLK_SET_RATE_PARENT) && parent &&
-	    best_parent_rate != parent->rate)
+	    best_parent_rate != parent->rate) {
+		if (clk_core_rate_leaves_domain(core, parent))
+			return ERR_PTR(-EXDEV);
 		top = clk_calc_new_rates(parent, best_parent_rate);
+		if (IS_ERR(top))
+			return top;
+	}
 
 out:
 	clk_calc_subtree(core, new_rate, parent, p_index);
@@ -2179,6 +2570,8 @@ static int clk_core_set_rate_nolock(struct clk_core *core,
 
 	/* calculate new rates and get the topmost changed clock */
 	top = clk_calc_new_rates(core, req_rate);
+	if (IS_ERR(top))
+		return PTR_ERR(top);
 	if (!top)
 		return -EINVAL;
 
@@ -2229,14 +2622,15 @@ static int clk_core_set_rate_nolock(struct clk_core *core,
  */
 int clk_set_rate(struct clk *clk, unsigned long rate)
 {
+	struct clk_lock_domain *domain;
 	int ret;
 
 	if (!clk)
 		return 0;
 
 	/* prevent racing with updates to the clock topology */
-	clk_prepare_lock();
-
+	domain = clk_core_lock(clk->core);
+retry:
 	if (clk->exclusive_count)
 		clk_core_rate_unprotect(clk->core);
 
@@ -2245,7 +2639,21 @@ int clk_set_rate(struct clk *clk, unsigned long rate)
 	if (clk->exclusive_count)
 		clk_core_rate_protect(clk->core);
 
-	clk_prepare_unlock();
+	/*
+	 * The change reaches outside of the domain, nothing was done yet. A
+	 * task holding the lock of a domain already, e.g. when called from
+	 * clk_ops, can't take prepare_lock for writing.
+	 */
+	if (ret == -EXDEV && domain) {
+		clk_core_unlock(domain);
+		if (clk_domain_held())
+			return -EDEADLK;
+		clk_prepare_lock();
+		domain = NULL;
+		goto retry;
+	}
+
+	clk_core_unlock(domain);
 
 	return ret;
 }
@@ -2504,6 +2912,10 @@ static int clk_core_set_parent_nolock(struct clk_core *core,
 	if (core->parent == parent)
 		return 0;
 
+	if (!clk_core_subtree_locked(core) ||
+	    !clk_core_reparent_locked(core, parent))
+		return -EDEADLK;
+
 	/* verify ops for multi-parent clks */
 	if (core->num_parents > 1 && !core->ops->set_parent)
 		return -EPERM;
@@ -2610,6 +3022,9 @@ static int clk_core_set_phase_nolock(struct clk_core *core, int degrees)
 	if (!core)
 		return 0;
 
+	if (!clk_core_locked(core))
+		return -EDEADLK;
+
 	if (clk_core_rate_is_protected(core))
 		return -EBUSY;
 
@@ -2771,6 +3186,9 @@ static int clk_core_set_duty_cycle_nolock(struct clk_core *core,
 
 	lockdep_assert_held(&prepare_lock);
 
+	if (!clk_core_locked(core))
+		return -EDEADLK;
+
 	if (clk_core_rate_is_protected(core))
 		return -EBUSY;
 
@@ -3118,6 +3536,7 @@ static const struct {
 	ENTRY(CLK_IS_CRITICAL),
 	ENTRY(CLK_OPS_PARENT_ENABLE),
 	ENTRY(CLK_DUTY_CYCLE_PARENT),
+	ENTRY(CLK_LOCK_DOMAIN),
 #undef ENTRY
 };
 
@@ -3488,6 +3907,7 @@ static int __clk_core_init(struct clk_core *core)
 		hlist_add_head(&core->child_node, &clk_orphan_list);
 		core->orphan = true;
 	}
+	clk_core_update_domain(core);
 
 	/*
 	 * Set clk's accuracy.  The preferred method is to use
@@ -3837,6 +4257,14 @@ __clk_register(struct device *dev, struct device_node *np, struct clk_hw *hw)
 	core->max_rate = ULONG_MAX;
 	hw->core = core;
 
+	if (core->flags & CLK_LOCK_DOMAIN) {
+		core->own_domain = clk_lock_domain_alloc(core);
+		if (!core->own_domain) {
+			ret = -ENOMEM;
+			goto fail_ops;
+		}
+	}
+
 	ret = clk_core_populate_parent_map(core, init);
 	if (ret)
 		goto fail_parents;
@@ -3869,6 +4297,7 @@ __clk_register(struct device *dev, struct device_node *np, struct clk_hw *hw)
 fail_create_clk:
 	clk_core_free_parent_map(core);
 fail_parents:
+	clk_lock_domain_free(core->own_domain);
 fail_ops:
 	kfree_const(core->name);
 fail_name:
@@ -3960,6 +4389,7 @@ static void __clk_release(struct kref *ref)
 	lockdep_assert_held(&prepare_lock);
 
 	clk_core_free_parent_map(core);
+	clk_lock_domain_free(core->own_domain);
 	kfree_const(core->name);
 	kfree(core);
 }
@@ -4073,6 +4503,7 @@ void clk_unregister(struct clk *clk)
 	clk_core_evict_parent_cache(clk->core);
 
 	hlist_del_init(&clk->core->child_node);
+	clk->core->domain = NULL;
 
 	if (clk->core->prepare_count)
 		pr_warn("%s: unregistering prepared clock: %s\n",
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Dummy cpufreq driver, which pretends to switch the CPUs between a few
+ * frequencies without touching the hardware. It allows exercising the
+ * governors, and comparing their fast switch and deferred paths, on machines
+ * without a cpufreq driver such as virtual machines.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+
+static bool fast_switch = true;
+module_param(fast_switch, bool, 0444);
+MODULE_PARM_DESC(fast_switch, "Allow switching frequency from the scheduler (default: true)");
+
+static bool shared;
+module_param(shared, bool, 0444);
+MODULE_PARM_DESC(shared, "Put all the CPUs in a single policy (default: false)");
+
+static unsigned int transition_us = 50;
+module_param(transition_us, uint, 0444);
+MODULE_PARM_DESC(transition_us, "Time taken by a frequency switch from the governor thread, in us (default: 50)");
+
+static struct cpufreq_frequency_table dummy_freq_table[] = {
+	{ .frequency = 400000 },
+	{ .frequency = 800000 },
+	{ .frequency = 1200000 },
+	{ .frequency = 1600000 },
+	{ .frequency = 2000000 },
+	{ .frequency = CPUFREQ_TABLE_END },
+};
+
+static DEFINE_PER_CPU(unsigned int, dummy_cur_freq);
+
+static void dummy_cpufreq_set(struct cpufreq_policy *policy, unsigned int freq)
+{
+	unsigned int cpu;
+
+	for_each_cpu(cpu, policy->cpus)
+		WRITE_ONCE(per_cpu(dummy_cur_freq, cpu), freq);
+}
+
+static int dummy_cpufreq_target_index(struct cpufreq_policy *policy,
+				      unsigned int index)
+{
+	fsleep(transition_us);
+	dummy_cpufreq_set(policy, dummy_freq_table[index].frequency);
+
+	return 0;
+}
+
+static unsigned int dummy_cpufreq_fast_switch(struct cpufreq_policy *policy,
+					      unsigned int target_freq)
+{
+	int index = cpufreq_table_find_index_dl(policy, target_freq);
+
+	dummy_cpufreq_set(policy, dummy_freq_table[index].frequency);
+
+	return dummy_freq_table[index].frequency;
+}
+
+static unsigned int dummy_cpufreq_get(unsigned int cpu)
+{
+	return READ_ONCE(per_cpu(dummy_cur_freq, cpu));
+}
+
+static int dummy_cpufreq_init(struct cpufreq_policy *policy)
+{
+	if (shared)
+		cpumask_copy(policy->cpus, cpu_possible_mask);
+
+	policy->freq_table = dummy_freq_table;
+	policy->cpuinfo.transition_latency = (transition_us ?: 1) * NSEC_PER_USEC;
+	policy->fast_switch_possible = fast_switch;
+	policy->dvfs_possible_from_any_cpu = true;
+
+	/* Start at the highest frequency, as firmware usually leaves them */
+	dummy_cpufreq_set(policy,
+			  dummy_freq_table[ARRAY_SIZE(dummy_freq_table) - 2].frequency);
+
+	return 0;
+}
+
+static struct cpufreq_driver dummy_cpufreq_driver = {
+	.name		= "cpufreq-dummy",
+	.flags		= CPUFREQ_NEED_INITIAL_FREQ_CHECK,
+	.verify		= cpufreq_generic_frequency_table_verify,
+	.target_index	= dummy_cpufreq_target_index,
+	.fast_switch	= dummy_cpufreq_fast_switch,
+	.get		= dummy_cpufreq_get,
+	.init		= dummy_cpufreq_init,
+	.attr		= cpufreq_generic_attr,
+};
+
+static int __init dummy_cpufreq_module_init(void)
+{
+	return cpufreq_register_driver(&dummy_cpufreq_driver);
+}
+module_init(dummy_cpufreq_module_init);
+
+static void __exit dummy_cpufreq_module_exit(void)
+{
+	cpufreq_unregister_driver(&dummy_cpufreq_driver);
+}
+module_exit(dummy_cpufreq_module_exit);
+
+MODULE_DESCRIPTION("Dummy cpufreq driver for testing the governors");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the input report processing of the HID core
+ */
+#include <kunit/test.h>
+#include <linux/hid.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+
+/*
+ * Mouse with 3 buttons, two byte aligned 16 bit absolute axes and an
+ * unaligned signed 12 bit relative wheel.
+ */
+static const u8 hid_test_rdesc[] = {
+	0x05, 0x01,		/* Usage Page (Generic Desktop) */
+	0x09, 0x02,		/* Usage (Mouse) */
+	0xa1, 0x01,		/* Collection (Application) */
+	0x85, 0x01,		/*   Report ID (1) */
+	0x05, 0x09,		/*   Usage Page (Button) */
+	0x19, 0x01,		/*   Usage Minimum (1) */
+	0x29, 0x03,		/*   Usage Maximum (3) */
+	0x15, 0x00,		/*   Logical Minimum (0) */
+	0x25, 0x01,		/*   Logical Maximum (1) */
+	0x95, 0x03,		/*   Report Count (3) */
+	0x75, 0x01,		/*   Report Size (1) */
+	0x81, 0x02,		/*   Input (Data,Var,Abs) */
+	0x95, 0x01,		/*   Report Count (1) */
+	0x75, 0x05,		/*   Report Size (5) */
+	0x81, 0x01,		/*   Input (Const) */
+	0x05, 0x01,		/*   Usage Page (Generic Desktop) */
+	0x09, 0x30,		/*   Usage (X) */
+	0x09, 0x31,		/*   Usage (Y) */
+	0x16, 0x01, 0x80,	/*   Logical Minimum (-32767) */
+	0x26, 0xff, 0x7f,	/*   Logical Maximum (32767) */
+	0x75, 0x10,		/*   Report Size (16) */
+	0x95, 0x02,		/*   Report Count (2) */
+	0x81, 0x02,		/*   Input (Data,Var,Abs) */
+	0x09, 0x38,		/*   Usage (Wheel) */
+	0x16, 0x01, 0xf8,	/*   Logical Minimum (-2047) */
+	0x26, 0xff, 0x07,	/*   Logical Maximum (2047) */
+	0x75, 0x0c,		/*   Report Size (12) */
+	0x95, 0x01,		/*   Report Count (1) */
+	0x81, 0x06,		/*   Input (Data,Var,Rel) */
+	0x75, 0x04,		/*   Report Size (4) */
+	0x81, 0x01,		/*   Input (Const) */
+	0xc0,			/* End Collection */
+};
+
+/* buttons 1 and 3, X = -1000, Y = 1234, wheel = -5 */
+static const u8 hid_test_report1[] = {
+	0x01, 0x05, 0x18, 0xfc, 0xd2, 0x04, 0xfb, 0x0f,
+};
+
+/* button 2, X = 1, Y = -2, wheel = 2047 */
+static const u8 hid_test_report2[] = {
+	0x01, 0x02, 0x01, 0x00, 0xfe, 0xff, 0xff, 0x07,
+};
+
+#define HID_TEST_BENCH_LOOPS	100000
+
+static struct hid_driver hid_test_driver = {
+	.name = "hid-core-test",
+};
+
+struct hid_test_ctx {
+	struct hid_device *hdev;
+	struct hid_report *report;
+	u8 *buf;
+};
+
+static int hid_test_init(struct kunit *test)
+{
+	struct hid_test_ctx *ctx;
+	struct hid_device *hdev;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx);
+
+	ctx->buf = kunit_kzalloc(test, HID_MAX_BUFFER_SIZE, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->buf);
+
+	hdev = hid_allocate_device();
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, hdev);
+	ctx->hdev = hdev;
+	test->priv = ctx;
+
+	hdev->driver = &hid_test_driver;
+	hdev->dev_rdesc = kmemdup(hid_test_rdesc, sizeof(hid_test_rdesc),
+				  GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, hdev->dev_rdesc);
+	hdev->dev_rsize = sizeof(hid_test_rdesc);
+
+	KUNIT_ASSERT_EQ(test, hid_open_report(hdev), 0);
+
+	ctx->report = hdev->report_enum[HID_INPUT_REPORT].report_id_hash[1];
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->report);
+	KUNIT_ASSERT_EQ(test, ctx->report->maxfield, 3U);
+
+	return 0;
+}
+
+static void hid_test_exit(struct kunit *test)
+{
+	struct hid_test_ctx *ctx = test->priv;
+
+	if (ctx && ctx->hdev)
+		hid_destroy_device(ctx->hdev);
+}
+
+static void hid_test_feed(struct hid_test_ctx *ctx, const u8 *data,
+			  size_t size)
+{
+	memcpy(ctx->buf, data, size);
+	hid_report_raw_event(ctx->hdev, HID_INPUT_REPORT, ctx->buf, size, 1);
+}
+
+static void hid_test_expect_report1(struct kunit *test, struct hid_report *r)
+{
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[0], 1);
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[1], 0);
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[2], 1);
+	KUNIT_EXPECT_EQ(test, r->field[1]->value[0], -1000);
+	KUNIT_EXPECT_EQ(test, r->field[1]->value[1], 1234);
+	KUNIT_EXPECT_EQ(test, r->field[2]->value[0], -5);
+}
+
+static void hid_test_expect_report2(struct kunit *test, struct hid_report *r)
+{
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[0], 0);
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[1], 1);
+	KUNIT_EXPECT_EQ(test, r->field[0]->value[2], 0);
+	KUNIT_EXPECT_EQ(test, r->field[1]->value[0], 1);
+	KUNIT_EXPECT_EQ(test, r->field[1]->value[1], -2);
+	KUNIT_EXPECT_EQ(test, r->field[2]->value[0], 2047);
+}
+
+/* Reports are decoded the same with and without the precompiled plan */
+static void hid_test_plan_extract(struct kunit *test)
+{
+	struct hid_test_ctx *ctx = test->priv;
+	struct hid_report *report = ctx->report;
+	struct hid_report_plan *plan = report->plan;
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, plan);
+
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	hid_test_expect_report1(test, report);
+	hid_test_feed(ctx, hid_test_report2, sizeof(hid_test_report2));
+	hid_test_expect_report2(test, report);
+
+	report->plan = NULL;
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	hid_test_expect_report1(test, report);
+	hid_test_feed(ctx, hid_test_report2, sizeof(hid_test_report2));
+	hid_test_expect_report2(test, report);
+	report->plan = plan;
+}
+
+/* Repeated and partially changed reports still update every field */
+static void hid_test_plan_unchanged(struct kunit *test)
+{
+	struct hid_test_ctx *ctx = test->priv;
+	struct hid_report *report = ctx->report;
+	u8 data[sizeof(hid_test_report1)];
+
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	hid_test_expect_report1(test, report);
+
+	/* only move Y */
+	memcpy(data, hid_test_report1, sizeof(data));
+	data[4] = 0x00;
+	data[5] = 0x01;
+	hid_test_feed(ctx, data, sizeof(data));
+	KUNIT_EXPECT_EQ(test, report->field[0]->value[0], 1);
+	KUNIT_EXPECT_EQ(test, report->field[1]->value[0], -1000);
+	KUNIT_EXPECT_EQ(test, report->field[1]->value[1], 256);
+	KUNIT_EXPECT_EQ(test, report->field[2]->value[0], -5);
+
+	/* short reports are zero padded */
+	hid_test_feed(ctx, data, 2);
+	KUNIT_EXPECT_EQ(test, report->field[0]->value[0], 1);
+	KUNIT_EXPECT_EQ(test, report->field[1]->value[0], 0);
+	KUNIT_EXPECT_EQ(test, report->field[1]->value[1], 0);
+	KUNIT_EXPECT_EQ(test, report->field[2]->value[0], 0);
+}
+
+/* Fields changed by the driver after the plan was compiled */
+static void hid_test_plan_field_changed(struct kunit *test)
+{
+	struct hid_test_ctx *ctx = test->priv;
+	struct hid_report *report = ctx->report;
+	struct hid_field *axes = report->field[1];
+	struct hid_field *wheel = report->field[2];
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, report->plan);
+
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	hid_test_expect_report1(test, report);
+
+	/* unchanged absolute values are skipped... */
+	axes->value[0] = 0;
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	KUNIT_EXPECT_EQ(test, axes->value[0], 0);
+
+	/* ...but not once the driver made them relative */
+	axes->flags |= HID_MAIN_ITEM_RELATIVE;
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	KUNIT_EXPECT_EQ(test, axes->value[0], -1000);
+	KUNIT_EXPECT_EQ(test, axes->value[1], 1234);
+
+	/* a wheel fixed up to be unsigned is no longer sign extended */
+	wheel->logical_minimum = 0;
+	wheel->logical_maximum = 4095;
+	hid_test_feed(ctx, hid_test_report1, sizeof(hid_test_report1));
+	KUNIT_EXPECT_EQ(test, wheel->value[0], 4091);
+	hid_test_feed(ctx, hid_test_report2, sizeof(hid_test_report2));
+	KUNIT_EXPECT_EQ(test, wheel->value[0], 2047);
+	KUNIT_EXPECT_EQ(test, axes->value[1], -2);
+}
+
+static u64 hid_test_bench_run(struct hid_test_ctx *ctx)
+{
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	for (i = 0; i < HID_TEST_BENCH_LOOPS; i++) {
+		if (i & 1)
+			hid_test_feed(ctx, hid_test_report2,
+				      sizeof(hid_test_report2));
+		else
+			hid_test_feed(ctx, hid_test_report1,
+				      sizeof(hid_test_report1));
+	}
+
+	return ktime_get_ns() - start;
+}
+
+/* Not a pass/fail test: report the per report cost of both paths */
+static void hid_test_plan_bench(struct kunit *test)
+{
+	struct hid_test_ctx *ctx = test->priv;
+	struct hid_report *report = ctx->report;
+	struct hid_report_plan *plan = report->plan;
+	u64 generic, compiled;
+
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, plan);
+
+	report->plan = NULL;
+	generic = hid_test_bench_run(ctx);
+	report->plan = plan;
+	compiled = hid_test_bench_run(ctx);
+
+	kunit_info(test, "generic: %llu ns/report, compiled: %llu ns/report\n",
+		   div_u64(generic, HID_TEST_BENCH_LOOPS),
+		   div_u64(compiled, HID_TEST_BENCH_LOOPS));
+}
+
+static struct kunit_case hid_core_test_cases[] = {
+	KUNIT_CASE(hid_test_plan_extract),
+	KUNIT_CASE(hid_test_plan_unchanged),
+	KUNIT_CASE(hid_test_plan_field_changed),
+	KUNIT_CASE(hid_test_plan_bench),
+	{}
+};
+
+static struct kunit_suite hid_core_test_suite = {
+	.name = "hid-core",
+	.init = hid_test_init,
+	.exit = hid_test_exit,
+	.test_cases = hid_core_test_cases,
+};
+
+kunit_test_suite(hid_core_test_suite);
+
+MODULE_LICENSE("GPL");
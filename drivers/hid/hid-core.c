@@ -658,6 +658,7 @@ static void hid_free_report(struct hid_report *report)
 
 	for (n = 0; n < report->maxfield; n++)
 		kfree(report->field[n]);
+	kfree(report->plan);
 	kfree(report);
 }
 
@@ -1175,6 +1176,8 @@ void hid_setup_resolution_multiplier(struct hid_device *hid)
 }
 EXPORT_SYMBOL_GPL(hid_setup_resolution_multiplier);
 
+static void hid_compile_reports(struct hid_device *device);
+
 /**
  * hid_open_report - open a driver-specific device report
  *
@@ -1280,6 +1283,8 @@ int hid_open_report(struct hid_device *device)
 			 */
 			hid_setup_resolution_multiplier(device);
 
+			hid_compile_reports(device);
+
 			kfree(parser->collection_stack);
 			vfree(parser);
 			device->status |= HID_STAT_PARSED;
@@ -1522,39 +1527,28 @@ static void hid_process_event(struct hid_device *hid, struct hid_field *field,
 }
 
 /*
- * Analyse a received field, and fetch the data from it. The field
- * content is stored for next report processing (we do differential
- * reporting to the layer).
+ * Process the freshly fetched values of a field. The field content is
+ * stored for next report processing (we do differential reporting to
+ * the layer).
  */
 
-static void hid_input_field(struct hid_device *hid, struct hid_field *field,
-			    __u8 *data, int interrupt)
+static void hid_input_field_values(struct hid_device *hid,
+				   struct hid_field *field, __s32 *value,
+				   int interrupt)
 {
 	unsigned n;
 	unsigned count = field->report_count;
-	unsigned offset = field->report_offset;
-	unsigned size = field->report_size;
 	__s32 min = field->logical_minimum;
 	__s32 max = field->logical_maximum;
-	__s32 *value;
 
-	value = kmalloc_array(count, sizeof(__s32), GFP_ATOMIC);
-	if (!value)
-		return;
-
-	for (n = 0; n < count; n++) {
-
-		value[n] = min < 0 ?
-			snto32(hid_field_extract(hid, data, offset + n * size,
-			       size), size) :
-			hid_field_extract(hid, data, offset + n * size, size);
-
-		/* Ignore report if ErrorRollOver */
-		if (!(field->flags & HID_MAIN_ITEM_VARIABLE) &&
-		    value[n] >= min && value[n] <= max &&
-		    value[n] - min < field->maxusage &&
-		    field->usage[value[n] - min].hid == HID_UP_KEYBOARD + 1)
-			goto exit;
+	/* Ignore report if ErrorRollOver */
+	if (!(field->flags & HID_MAIN_ITEM_VARIABLE)) {
+		for (n = 0; n < count; n++) {
+			if (value[n] >= min && value[n] <= max &&
+			    value[n] - min < field->maxusage &&
+			    field->usage[value[n] - min].hid == HID_UP_KEYBOARD + 1)
+				return;
+		}
 	}
 
 	for (n = 0; n < count; n++) {
@@ -1578,7 +1572,33 @@ static void hid_input_field(struct hid_device *hid, struct hid_field *field,
 	}
 
 	memcpy(field->value, value, count * sizeof(__s32));
-exit:
+}
+
+/*
+ * Analyse a received field, and fetch the data from it.
+ */
+
+static void hid_input_field(struct hid_device *hid, struct hid_field *field,
+			    __u8 *data, int interrupt)
+{
+	unsigned n;
+	unsigned count = field->report_count;
+	unsigned offset = field->report_offset;
+	unsigned size = field->report_size;
+	__s32 min = field->logical_minimum;
+	__s32 *value;
+
+	value = kmalloc_array(count, sizeof(__s32), GFP_ATOMIC);
+	if (!value)
+		return;
+
+	for (n = 0; n < count; n++)
+		value[n] = min < 0 ?
+			snto32(hid_field_extract(hid, data, offset + n * size,
+			       size), size) :
+			hid_field_extract(hid, data, offset + n * size, size);
+
+	hid_input_field_values(hid, field, value, interrupt);
 	kfree(value);
 }
 
@@ -1615,6 +1635,175 @@ static size_t hid_compute_report_size(struct hid_report *report)
 	return 0;
 }
 
+/*
+ * Precompiled extraction plans.
+ *
+ * Walking report->field[] and decoding every value bit by bit is what
+ * dominates the cost of high rate reports (pens, gaming mice, touch
+ * panels). At parse time, each input report gets a plan listing where
+ * each of its fields lives in the report data and how to decode it, so
+ * that hid_report_raw_event() only has to run through a flat table, with
+ * byte aligned 8/16/32 bit values read directly and no allocation.
+ *
+ * The plan also keeps the data of the previous report, so that fields
+ * whose bytes did not change can be skipped when that is known to not
+ * generate any event (see hid_plan_may_skip_variable()).
+ *
+ * Only the layout of the fields is compiled in. Drivers adjust the flags
+ * and the logical range of fields from their report_fixup, input_mapping
+ * and input_configured hooks, or later, so how the values are decoded is
+ * read from the field for each report.
+ */
+
+struct hid_field_extractor {
+	struct hid_field *field;
+	unsigned int offset;		/* bit offset of the first value */
+	unsigned int size;		/* bits per value */
+	unsigned int count;		/* number of values */
+	unsigned int first_byte;	/* bytes of the report covering */
+	unsigned int nbytes;		/*   all the values of the field */
+};
+
+struct hid_report_plan {
+	unsigned int nr_fields;
+	unsigned int rsize;		/* bytes of report data saved in last */
+	bool last_valid;
+	u8 *last;			/* data of the previous report */
+	__s32 *values;			/* scratch space for the largest field */
+	struct hid_field_extractor fields[];
+};
+
+static void hid_compile_report(struct hid_report *report)
+{
+	struct hid_report_plan *plan;
+	unsigned int rsize = hid_compute_report_size(report);
+	unsigned int max_count = 0;
+	unsigned int n;
+	size_t len;
+
+	if (!report->maxfield || rsize > HID_MAX_BUFFER_SIZE - 1)
+		return;
+
+	for (n = 0; n < report->maxfield; n++) {
+		struct hid_field *field = report->field[n];
+
+		/* leave the unusual ones to the generic path */
+		if (field->report_size > 32 || !field->report_count)
+			return;
+		max_count = max(max_count, field->report_count);
+	}
+
+	len = struct_size(plan, fields, report->maxfield);
+	plan = kzalloc(len + max_count * sizeof(__s32) + rsize, GFP_KERNEL);
+	if (!plan)
+		return;
+
+	plan->nr_fields = report->maxfield;
+	plan->rsize = rsize;
+	plan->values = (__s32 *)((u8 *)plan + len);
+	plan->last = (u8 *)(plan->values + max_count);
+
+	for (n = 0; n < report->maxfield; n++) {
+		struct hid_field *field = report->field[n];
+		struct hid_field_extractor *ext = &plan->fields[n];
+		unsigned int bits = field->report_size * field->report_count;
+
+		ext->field = field;
+		ext->offset = field->report_offset;
+		ext->size = field->report_size;
+		ext->count = field->report_count;
+		ext->first_byte = ext->offset / 8;
+		ext->nbytes = DIV_ROUND_UP(ext->offset + bits, 8) - ext->first_byte;
+	}
+
+	report->plan = plan;
+}
+
+static void hid_compile_reports(struct hid_device *device)
+{
+	struct hid_report_enum *report_enum;
+	struct hid_report *report;
+
+	report_enum = device->report_enum + HID_INPUT_REPORT;
+	list_for_each_entry(report, &report_enum->report_list, list)
+		hid_compile_report(report);
+}
+
+static inline u32 hid_plan_extract(const u8 *data, unsigned int offset,
+				   unsigned int size)
+{
+	if (!(offset & 7)) {
+		switch (size) {
+		case 8:
+			return data[offset >> 3];
+		case 16:
+			return get_unaligned_le16(data + (offset >> 3));
+		case 32:
+			return get_unaligned_le32(data + (offset >> 3));
+		}
+	}
+
+	return __extract((u8 *)data, offset, size);
+}
+
+/*
+ * An absolute variable value that did not change is ignored by hid-input
+ * anyway, but drivers' event hooks, hiddev and the debug interface want to
+ * see every one of them.
+ */
+static bool hid_plan_may_skip_variable(struct hid_device *hid)
+{
+	return !(hid->driver && hid->driver->event) &&
+	       !(hid->claimed & HID_CLAIMED_HIDDEV) &&
+	       list_empty(&hid->debug_list);
+}
+
+/* Unchanged absolute variable values generate no event */
+static inline bool hid_plan_field_skippable(const struct hid_field *field)
+{
+	return (field->flags & HID_MAIN_ITEM_VARIABLE) &&
+	       !(field->flags & (HID_MAIN_ITEM_RELATIVE |
+				 HID_MAIN_ITEM_BUFFERED_BYTE));
+}
+
+static void hid_input_report_plan(struct hid_device *hid,
+				  struct hid_report_plan *plan, u8 *data,
+				  int interrupt)
+{
+	bool skip_variable = plan->last_valid && hid_plan_may_skip_variable(hid);
+	unsigned int i, n;
+
+	for (i = 0; i < plan->nr_fields; i++) {
+		const struct hid_field_extractor *ext = &plan->fields[i];
+		struct hid_field *field = ext->field;
+		unsigned int offset = ext->offset;
+		bool is_signed;
+
+		/*
+		 * Unchanged array fields never generate events, as they are
+		 * reported differentially against the previous values.
+		 */
+		if (plan->last_valid &&
+		    !memcmp(data + ext->first_byte, plan->last + ext->first_byte,
+			    ext->nbytes) &&
+		    (!(field->flags & HID_MAIN_ITEM_VARIABLE) ||
+		     (skip_variable && hid_plan_field_skippable(field))))
+			continue;
+
+		is_signed = field->logical_minimum < 0;
+		for (n = 0; n < ext->count; n++, offset += ext->size) {
+			u32 raw = hid_plan_extract(data, offset, ext->size);
+
+			plan->values[n] = is_signed ? snto32(raw, ext->size) : raw;
+		}
+
+		hid_input_field_values(hid, field, plan->values, interrupt);
+	}
+
+	memcpy(plan->last, data, plan->rsize);
+	plan->last_valid = true;
+}
+
 /*
  * Create a report. 'data' has to be allocated using
  * hid_alloc_report_buf() so that it has proper size.
@@ -1779,8 +1968,13 @@ int hid_report_raw_event(struct hid_device *hid, int type, u8 *data, u32 size,
 	}
 
 	if (hid->claimed != HID_CLAIMED_HIDRAW && report->maxfield) {
-		for (a = 0; a < report->maxfield; a++)
-			hid_input_field(hid, report->field[a], cdata, interrupt);
+		if (report->plan)
+			hid_input_report_plan(hid, report->plan, cdata,
+					      interrupt);
+		else
+			for (a = 0; a < report->maxfield; a++)
+				hid_input_field(hid, report->field[a], cdata,
+						interrupt);
 		hdrv = hid->driver;
 		if (hdrv && hdrv->report)
 			hdrv->report(hid, report);
@@ -21,6 +21,7 @@
 #include <linux/sched.h>
 #include <linux/spinlock.h>
 #include <linux/uhid.h>
+#include <linux/uio.h>
 #include <linux/wait.h>
 
 #define UHID_NAME	"uhid"
@@ -76,9 +77,18 @@ static void uhid_queue(struct uhid_device *uhid, struct uhid_event *ev)
 	newhead = (uhid->head + 1) % UHID_BUFSIZE;
 
 	if (newhead != uhid->tail) {
+		bool was_empty = uhid->head == uhid->tail;
+
 		uhid->outq[uhid->head] = ev;
 		uhid->head = newhead;
-		wake_up_interruptible(&uhid->waitq);
+
+		/*
+		 * Readers only ever sleep on an empty queue and drain it
+		 * before sleeping again, so only wake them up when it stops
+		 * being empty instead of once per queued event.
+		 */
+		if (was_empty)
+			wake_up_interruptible(&uhid->waitq);
 	} else {
 		hid_warn(uhid->hid, "Output queue is full\n");
 		kfree(ev);
@@ -697,27 +707,86 @@ static ssize_t uhid_char_read(struct file *file, char __user *buffer,
 	return ret ? ret : len;
 }
 
-static ssize_t uhid_char_write(struct file *file, const char __user *buffer,
-				size_t count, loff_t *ppos)
+/*
+ * Vectored reads return one event per iovec, so user-space can fetch all
+ * pending events with a single readv(). Only the wait for the first event
+ * may block, the others are returned if already queued.
+ */
+static ssize_t uhid_char_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
+	struct file *file = iocb->ki_filp;
 	struct uhid_device *uhid = file->private_data;
+	unsigned long flags;
+	ssize_t total = 0;
+	size_t seg, len;
 	int ret;
-	size_t len;
 
-	/* we need at least the "type" member of uhid_event */
-	if (count < sizeof(__u32))
+	/* they need at least the "type" member of uhid_event */
+	if (iov_iter_single_seg_count(to) < sizeof(__u32))
 		return -EINVAL;
 
+try_again:
+	if ((file->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+		if (uhid->head == uhid->tail)
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(uhid->waitq,
+						uhid->head != uhid->tail);
+		if (ret)
+			return ret;
+	}
+
 	ret = mutex_lock_interruptible(&uhid->devlock);
 	if (ret)
 		return ret;
 
+	if (uhid->head == uhid->tail) {
+		mutex_unlock(&uhid->devlock);
+		goto try_again;
+	}
+
+	while (uhid->head != uhid->tail) {
+		seg = iov_iter_single_seg_count(to);
+		if (seg < sizeof(__u32))
+			break;
+
+		len = min(seg, sizeof(**uhid->outq));
+		if (copy_to_iter(uhid->outq[uhid->tail], len, to) != len) {
+			ret = -EFAULT;
+			break;
+		}
+		iov_iter_advance(to, seg - len);
+		total += len;
+
+		kfree(uhid->outq[uhid->tail]);
+		uhid->outq[uhid->tail] = NULL;
+
+		spin_lock_irqsave(&uhid->qlock, flags);
+		uhid->tail = (uhid->tail + 1) % UHID_BUFSIZE;
+		spin_unlock_irqrestore(&uhid->qlock, flags);
+	}
+
+	mutex_unlock(&uhid->devlock);
+	return total ? total : ret;
+}
+
+/* Handle one event written by user-space; called with devlock held */
+static int uhid_write_event(struct file *file, struct uhid_device *uhid,
+			    const char __user *buffer, size_t count)
+{
+	int ret;
+	size_t len;
+
+	/* we need at least the "type" member of uhid_event */
+	if (count < sizeof(__u32))
+		return -EINVAL;
+
 	memset(&uhid->input_buf, 0, sizeof(uhid->input_buf));
 	len = min(count, sizeof(uhid->input_buf));
 
 	ret = uhid_event_from_user(buffer, len, &uhid->input_buf);
 	if (ret)
-		goto unlock;
+		return ret;
 
 	switch (uhid->input_buf.type) {
 	case UHID_CREATE:
@@ -729,8 +798,7 @@ static ssize_t uhid_char_write(struct file *file, const char __user *buffer,
 		if (file->f_cred != current_cred() || uaccess_kernel()) {
 			pr_err_once("UHID_CREATE from different security context by process %d (%s), this is not allowed.\n",
 				    task_tgid_vnr(current), current->comm);
-			ret = -EACCES;
-			goto unlock;
+			return -EACCES;
 		}
 		ret = uhid_dev_create(uhid, &uhid->input_buf);
 		break;
@@ -756,13 +824,65 @@ static ssize_t uhid_char_write(struct file *file, const char __user *buffer,
 		ret = -EOPNOTSUPP;
 	}
 
-unlock:
+	return ret;
+}
+
+static ssize_t uhid_char_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *ppos)
+{
+	struct uhid_device *uhid = file->private_data;
+	int ret;
+
+	ret = mutex_lock_interruptible(&uhid->devlock);
+	if (ret)
+		return ret;
+
+	ret = uhid_write_event(file, uhid, buffer, count);
+
 	mutex_unlock(&uhid->devlock);
 
 	/* return "count" not "len" to not confuse the caller */
 	return ret ? ret : count;
 }
 
+/*
+ * Vectored writes carry one event per iovec, e.g. a GET_REPORT reply and
+ * a batch of input reports in a single writev(). Events are handled in
+ * order; on error, the size of the events handled so far is returned.
+ */
+static ssize_t uhid_char_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct uhid_device *uhid = file->private_data;
+	const char __user *buffer;
+	ssize_t total = 0;
+	size_t seg;
+	int ret;
+
+	/* events may carry user pointers, only accept user-space buffers */
+	if (!iter_is_iovec(from))
+		return -EINVAL;
+
+	ret = mutex_lock_interruptible(&uhid->devlock);
+	if (ret)
+		return ret;
+
+	while (iov_iter_count(from)) {
+		seg = iov_iter_single_seg_count(from);
+		buffer = from->iov->iov_base + from->iov_offset;
+
+		ret = uhid_write_event(file, uhid, buffer, seg);
+		if (ret)
+			break;
+
+		iov_iter_advance(from, seg);
+		total += seg;
+	}
+
+	mutex_unlock(&uhid->devlock);
+	return total ? total : ret;
+}
+
 static __poll_t uhid_char_poll(struct file *file, poll_table *wait)
 {
 	struct uhid_device *uhid = file->private_data;
@@ -781,7 +901,9 @@ static const struct file_operations uhid_fops = {
 	.open		= uhid_char_open,
 	.release	= uhid_char_release,
 	.read		= uhid_char_read,
+	.read_iter	= uhid_char_read_iter,
 	.write		= uhid_char_write,
+	.write_iter	= uhid_char_write_iter,
 	.poll		= uhid_char_poll,
 	.llseek		= no_llseek,
 };
@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Compares the rate of single key and batched btree operations on a
+ * scratch metadata device.  Everything on the device is destroyed.
+ *
+ *	modprobe dm-btree-bench dev=/dev/sdX nr_keys=100000 run=256
+ *
+ * Every pass inserts, looks up and then removes nr_keys consecutive keys,
+ * run of them per transaction, and the results are printed to the kernel
+ * log in metadata operations per second.
+ */
+#include "dm-btree.h"
+#include "dm-space-map.h"
+#include "dm-transaction-manager.h"
+
+#include <linux/bitmap.h>
+#include <linux/blkdev.h>
+#include <linux/device-mapper.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+#define DM_MSG_PREFIX "btree bench"
+
+#define BENCH_BLOCK_SIZE 4096
+#define BENCH_MAX_CONCURRENT_LOCKS 5
+#define BENCH_SUPERBLOCK_LOCATION 0
+
+static char *dev;
+module_param(dev, charp, 0444);
+MODULE_PARM_DESC(dev, "Scratch block device, its contents are destroyed");
+
+static unsigned int nr_keys = 100000;
+module_param(nr_keys, uint, 0444);
+MODULE_PARM_DESC(nr_keys, "Number of keys handled by each pass");
+
+static unsigned int run = 256;
+module_param(run, uint, 0444);
+MODULE_PARM_DESC(run, "Number of keys per batched call and per transaction");
+
+enum bench_op {
+	BENCH_INSERT,
+	BENCH_LOOKUP,
+	BENCH_REMOVE,
+	BENCH_NR_OPS
+};
+
+static const char * const bench_op_names[BENCH_NR_OPS] = {
+	[BENCH_INSERT] = "insert",
+	[BENCH_LOOKUP] = "lookup",
+	[BENCH_REMOVE] = "remove",
+};
+
+struct bench {
+	struct dm_block_manager *bm;
+	struct dm_transaction_manager *tm;
+	struct dm_space_map *sm;
+	struct dm_btree_info info;
+
+	uint64_t *keys;
+	__le64 *values;
+	unsigned long *found;
+};
+
+static int bench_commit(struct bench *b)
+{
+	int r;
+	struct dm_block *sblock;
+
+	r = dm_tm_pre_commit(b->tm);
+	if (r)
+		return r;
+
+	r = dm_bm_write_lock_zero(b->bm, BENCH_SUPERBLOCK_LOCATION, NULL,
+				  &sblock);
+	if (r)
+		return r;
+
+	return dm_tm_commit(b->tm, sblock);
+}
+
+static int bench_single(struct bench *b, enum bench_op op, dm_block_t *root,
+			uint64_t first, unsigned int nr)
+{
+	int r = 0;
+	unsigned int i;
+	uint64_t key;
+	__le64 value;
+
+	for (i = 0; i < nr && !r; i++) {
+		key = first + i;
+
+		switch (op) {
+		case BENCH_INSERT:
+			value = cpu_to_le64(key);
+			__dm_bless_for_disk(&value);
+			r = dm_btree_insert(&b->info, *root, &key, &value, root);
+			break;
+
+		case BENCH_LOOKUP:
+			r = dm_btree_lookup(&b->info, *root, &key, &value);
+			if (!r && le64_to_cpu(value) != key)
+				r = -EIO;
+			break;
+
+		default:
+			r = dm_btree_remove(&b->info, *root, &key, root);
+			break;
+		}
+	}
+
+	return r;
+}
+
+static int bench_run(struct bench *b, enum bench_op op, dm_block_t *root,
+		     uint64_t first, unsigned int nr)
+{
+	int r;
+	unsigned int i, done;
+
+	for (i = 0; i < nr; i++) {
+		b->keys[i] = first + i;
+		b->values[i] = op == BENCH_INSERT ? cpu_to_le64(first + i) : 0;
+	}
+
+	switch (op) {
+	case BENCH_INSERT:
+		__dm_bless_for_disk(b->values);
+		r = dm_btree_insert_run(&b->info, *root, NULL, b->keys, nr,
+					b->values, root, &done);
+		break;
+
+	case BENCH_LOOKUP:
+		r = dm_btree_lookup_run(&b->info, *root, NULL, b->keys, nr,
+					b->values, b->found);
+		if (r < 0)
+			return r;
+
+		done = r;
+		r = 0;
+		for (i = 0; i < nr; i++)
+			if (le64_to_cpu(b->values[i]) != first + i)
+				r = -EIO;
+		break;
+
+	default:
+		r = dm_btree_remove_run(&b->info, *root, NULL, b->keys, nr,
+					root, &done);
+		break;
+	}
+
+	if (!r && done != nr)
+		r = -EIO;
+
+	return r;
+}
+
+static int bench_pass(struct bench *b, enum bench_op op, bool batched,
+		      dm_block_t *root)
+{
+	int r;
+	unsigned int first, nr;
+	ktime_t start = ktime_get();
+	u64 nsec;
+
+	for (first = 0; first < nr_keys; first += nr) {
+		nr = min(run, nr_keys - first);
+
+		if (batched)
+			r = bench_run(b, op, root, first, nr);
+		else
+			r = bench_single(b, op, root, first, nr);
+
+		if (!r && op != BENCH_LOOKUP)
+			r = bench_commit(b);
+
+		if (r) {
+			DMERR("%s %s failed at key %u: %d", bench_op_names[op],
+			      batched ? "batched" : "single", first, r);
+			return r;
+		}
+
+		cond_resched();
+	}
+
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start)) ?: 1;
+	DMINFO("%s %s: %u keys in %llu us, %llu ops/s",
+	       bench_op_names[op], batched ? "batched" : "single", nr_keys,
+	       div_u64(nsec, NSEC_PER_USEC),
+	       div64_u64((u64)nr_keys * NSEC_PER_SEC, nsec));
+
+	return 0;
+}
+
+static int bench_all(struct bench *b)
+{
+	int r, op, batched;
+	dm_block_t root;
+
+	for (batched = 0; batched < 2; batched++) {
+		r = dm_btree_empty(&b->info, &root);
+		if (r)
+			return r;
+
+		for (op = 0; op < BENCH_NR_OPS; op++) {
+			r = bench_pass(b, op, batched, &root);
+			if (r)
+				return r;
+		}
+
+		r = dm_btree_del(&b->info, root);
+		if (!r)
+			r = bench_commit(b);
+		if (r)
+			return r;
+	}
+
+	return 0;
+}
+
+static int __init dm_btree_bench_init(void)
+{
+	int r;
+	struct bench b = { };
+	struct block_device *bdev;
+	const fmode_t mode = FMODE_READ | FMODE_WRITE | FMODE_EXCL;
+
+	if (!dev || !run || !nr_keys) {
+		DMERR("a scratch device and non-zero nr_keys and run are needed");
+		return -EINVAL;
+	}
+
+	bdev = blkdev_get_by_path(dev, mode, &b);
+	if (IS_ERR(bdev)) {
+		DMERR("couldn't open %s", dev);
+		return PTR_ERR(bdev);
+	}
+
+	r = -ENOMEM;
+	b.keys = kvmalloc_array(run, sizeof(*b.keys), GFP_KERNEL);
+	b.values = kvmalloc_array(run, sizeof(*b.values), GFP_KERNEL);
+	b.found = bitmap_alloc(run, GFP_KERNEL);
+	if (!b.keys || !b.values || !b.found)
+		goto out_free;
+
+	b.bm = dm_block_manager_create(bdev, BENCH_BLOCK_SIZE,
+				       BENCH_MAX_CONCURRENT_LOCKS);
+	if (IS_ERR(b.bm)) {
+		r = PTR_ERR(b.bm);
+		goto out_free;
+	}
+
+	r = dm_tm_create_with_sm(b.bm, BENCH_SUPERBLOCK_LOCATION,
+				 &b.tm, &b.sm);
+	if (r) {
+		DMERR("couldn't create the transaction manager: %d", r);
+		goto out_bm;
+	}
+
+	b.info.tm = b.tm;
+	b.info.levels = 1;
+	b.info.value_type.size = sizeof(__le64);
+
+	r = bench_commit(&b);
+	if (!r)
+		r = bench_all(&b);
+
+	dm_sm_destroy(b.sm);
+	dm_tm_destroy(b.tm);
+out_bm:
+	dm_block_manager_destroy(b.bm);
+out_free:
+	bitmap_free(b.found);
+	kvfree(b.values);
+	kvfree(b.keys);
+	blkdev_put(bdev, mode);
+	return r;
+}
+module_init(dm_btree_bench_init);
+
+static void __exit dm_btree_bench_exit(void)
+{
+}
+module_exit(dm_btree_bench_exit);
+
+MODULE_DESCRIPTION("Persistent data btree benchmark");
+MODULE_LICENSE("GPL");
@@ -136,6 +136,20 @@ static inline uint64_t value64(struct btree_node *n, uint32_t index)
  */
 int lower_bound(struct btree_node *n, uint64_t key);
 
+/*
+ * The batched operations need the bottom level keys strictly ascending.
+ */
+static inline bool run_is_sorted(uint64_t *keys, unsigned nr)
+{
+	unsigned i;
+
+	for (i = 1; i < nr; i++)
+		if (keys[i] <= keys[i - 1])
+			return false;
+
+	return true;
+}
+
 extern struct dm_block_validator btree_node_validator;
 
 /*
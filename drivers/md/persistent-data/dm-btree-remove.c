@@ -685,3 +685,86 @@ int dm_btree_remove_leaves(struct dm_btree_info *info, dm_block_t root,
 	return r == -ENODATA ? 0 : r;
 }
 EXPORT_SYMBOL_GPL(dm_btree_remove_leaves);
+
+int dm_btree_remove_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			dm_block_t *new_root, unsigned *nr_removed)
+{
+	unsigned level, last_level = info->levels - 1, i = 0, nr_entries;
+	int index, r = 0;
+	struct shadow_spine spine;
+	struct btree_node *n;
+	struct dm_btree_value_type le64_vt;
+
+	*nr_removed = 0;
+	*new_root = root;
+	if (!run_is_sorted(bottom_keys, nr))
+		return -EINVAL;
+
+	init_le64_type(info->tm, &le64_vt);
+	while (i < nr) {
+		init_shadow_spine(&spine, info);
+
+		index = 0;
+		for (level = 0; level < last_level; level++) {
+			r = remove_raw(&spine, info, &le64_vt,
+				       root, keys[level], (unsigned *) &index);
+			if (r < 0)
+				goto out;
+
+			n = dm_block_data(shadow_current(&spine));
+			root = value64(n, index);
+		}
+
+		r = remove_nearest(&spine, info, &info->value_type,
+				   root, bottom_keys[i], &index);
+		if (r == -ENODATA) {
+			/* below the lowest key of the tree */
+			i++;
+			goto next;
+		}
+		if (r < 0)
+			goto out;
+
+		n = dm_block_data(shadow_current(&spine));
+		if (index < 0)
+			index = 0;
+
+		/*
+		 * The leaf was rebalanced on the way down, so keep removing
+		 * from it until it would need rebalancing again.
+		 */
+		do {
+			nr_entries = le32_to_cpu(n->header.nr_entries);
+			while (index < nr_entries &&
+			       le64_to_cpu(n->keys[index]) < bottom_keys[i])
+				index++;
+
+			if (index < nr_entries &&
+			    le64_to_cpu(n->keys[index]) == bottom_keys[i]) {
+				if (info->value_type.dec)
+					info->value_type.dec(info->value_type.context,
+							     value_ptr(n, index));
+
+				delete_at(n, index);
+				(*nr_removed)++;
+				nr_entries--;
+			}
+		} while (++i < nr && nr_entries > merge_threshold(n) &&
+			 bottom_keys[i] <= le64_to_cpu(n->keys[nr_entries - 1]));
+
+next:
+		root = shadow_root(&spine);
+		exit_shadow_spine(&spine);
+		*new_root = root;
+	}
+
+	return 0;
+
+out:
+	*new_root = shadow_root(&spine);
+	exit_shadow_spine(&spine);
+
+	return r == -ENODATA ? 0 : r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_remove_run);
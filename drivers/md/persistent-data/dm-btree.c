@@ -8,6 +8,7 @@
 #include "dm-space-map.h"
 #include "dm-transaction-manager.h"
 
+#include <linux/bitmap.h>
 #include <linux/export.h>
 #include <linux/device-mapper.h>
 
@@ -500,6 +501,100 @@ int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 
 EXPORT_SYMBOL_GPL(dm_btree_lookup_next);
 
+/*
+ * Finds the leaf of the bottom level tree that @key falls in, setting
+ * @leaf_hi to the lowest key of any leaf to its right.
+ */
+static int lookup_leaf(struct ro_spine *s, dm_block_t block, uint64_t key,
+		       uint64_t *leaf_hi)
+{
+	int r, i;
+	uint32_t flags, nr_entries;
+
+	*leaf_hi = U64_MAX;
+
+	for (;;) {
+		r = ro_step(s, block);
+		if (r < 0)
+			return r;
+
+		flags = le32_to_cpu(ro_node(s)->header.flags);
+		if (flags & LEAF_NODE)
+			return 0;
+
+		nr_entries = le32_to_cpu(ro_node(s)->header.nr_entries);
+		i = lower_bound(ro_node(s), key);
+		if (i < 0 || i >= nr_entries)
+			return -ENODATA;
+
+		if (i + 1 < nr_entries)
+			*leaf_hi = le64_to_cpu(ro_node(s)->keys[i + 1]);
+
+		block = value64(ro_node(s), i);
+	}
+}
+
+int dm_btree_lookup_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			void *values_le, unsigned long *found)
+{
+	int r = 0, index;
+	unsigned i = 0, level, nr_found = 0;
+	size_t size = info->value_type.size;
+	uint64_t rkey, hi;
+	__le64 internal_value_le;
+	struct ro_spine spine;
+	struct btree_node *n;
+
+	if (!run_is_sorted(bottom_keys, nr))
+		return -EINVAL;
+
+	bitmap_zero(found, nr);
+
+	init_ro_spine(&spine, info);
+	for (level = 0; level < info->levels - 1; level++) {
+		r = btree_lookup_raw(&spine, root, keys[level], lower_bound,
+				     &rkey, &internal_value_le,
+				     sizeof(uint64_t));
+		if (!r && rkey != keys[level])
+			r = -ENODATA;
+		if (r)
+			goto out;
+
+		root = le64_to_cpu(internal_value_le);
+	}
+
+	while (i < nr) {
+		r = lookup_leaf(&spine, root, bottom_keys[i], &hi);
+		if (r == -ENODATA) {
+			/* below the lowest key of the tree */
+			i++;
+			continue;
+		}
+		if (r)
+			goto out;
+
+		n = ro_node(&spine);
+		do {
+			index = lower_bound(n, bottom_keys[i]);
+			if (index >= 0 && le64_to_cpu(n->keys[index]) == bottom_keys[i]) {
+				memcpy(values_le + i * size, value_ptr(n, index), size);
+				__set_bit(i, found);
+				nr_found++;
+			}
+		} while (++i < nr && bottom_keys[i] < hi);
+	}
+
+out:
+	exit_ro_spine(&spine);
+
+	if (r == -ENODATA)
+		r = 0;
+
+	return r ? r : nr_found;
+}
+EXPORT_SYMBOL_GPL(dm_btree_lookup_run);
+
 /*
  * Splits a node by creating a sibling node and shifting half the nodes
  * contents across.  Assumes there is a parent node, and it has room for
@@ -690,13 +785,22 @@ static int btree_split_beneath(struct shadow_spine *s, uint64_t key)
 	return 0;
 }
 
+/*
+ * If @leaf_hi is not NULL it is set to the lowest key that belongs to a
+ * leaf to the right of the one returned, or U64_MAX if there is none.  Any
+ * key from @key up to, but not including, *@leaf_hi may be inserted
+ * straight into the leaf without touching the rest of the spine.
+ */
 static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			    struct dm_btree_value_type *vt,
-			    uint64_t key, unsigned *index)
+			    uint64_t key, unsigned *index, uint64_t *leaf_hi)
 {
 	int r, i = *index, top = 1;
 	struct btree_node *node;
 
+	if (leaf_hi)
+		*leaf_hi = U64_MAX;
+
 	for (;;) {
 		r = shadow_step(s, root, vt);
 		if (r < 0)
@@ -727,6 +831,18 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 
 			if (r < 0)
 				return r;
+
+			/*
+			 * Going left after a sibling split means the new
+			 * right node now bounds us.
+			 */
+			if (!top && leaf_hi) {
+				struct btree_node *pn = dm_block_data(shadow_parent(s));
+				uint64_t rkey = le64_to_cpu(pn->keys[i + 1]);
+
+				if (key < rkey)
+					*leaf_hi = rkey;
+			}
 		}
 
 		node = dm_block_data(shadow_current(s));
@@ -742,6 +858,9 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			i = 0;
 		}
 
+		if (leaf_hi && i + 1 < le32_to_cpu(node->header.nr_entries))
+			*leaf_hi = le64_to_cpu(node->keys[i + 1]);
+
 		root = value64(node, i);
 		top = 0;
 	}
@@ -760,64 +879,75 @@ static bool need_insert(struct btree_node *node, uint64_t *keys,
 		(le64_to_cpu(node->keys[index]) != keys[level]));
 }
 
-static int insert(struct dm_btree_info *info, dm_block_t root,
-		  uint64_t *keys, void *value, dm_block_t *new_root,
-		  int *inserted)
-		  __dm_written_to_disk(value)
+/*
+ * Shadows the path down to the leaf of the bottom level tree that @key
+ * belongs in, creating any missing subtree for the upper level @keys on
+ * the way.  The leaf is left as the current node of the spine.
+ */
+static int insert_descend(struct dm_btree_info *info, struct shadow_spine *s,
+			  dm_block_t root, uint64_t *keys, uint64_t key,
+			  unsigned *index, uint64_t *leaf_hi)
 {
 	int r;
-	unsigned level, index = -1, last_level = info->levels - 1;
+	unsigned level, last_level = info->levels - 1;
 	dm_block_t block = root;
-	struct shadow_spine spine;
 	struct btree_node *n;
 	struct dm_btree_value_type le64_type;
 
+	*index = -1;
 	init_le64_type(info->tm, &le64_type);
-	init_shadow_spine(&spine, info);
 
-	for (level = 0; level < (info->levels - 1); level++) {
-		r = btree_insert_raw(&spine, block, &le64_type, keys[level], &index);
+	for (level = 0; level < last_level; level++) {
+		r = btree_insert_raw(s, block, &le64_type, keys[level], index,
+				     NULL);
 		if (r < 0)
-			goto bad;
+			return r;
 
-		n = dm_block_data(shadow_current(&spine));
+		n = dm_block_data(shadow_current(s));
 
-		if (need_insert(n, keys, level, index)) {
+		if (need_insert(n, keys, level, *index)) {
 			dm_block_t new_tree;
 			__le64 new_le;
 
 			r = dm_btree_empty(info, &new_tree);
 			if (r < 0)
-				goto bad;
+				return r;
 
 			new_le = cpu_to_le64(new_tree);
 			__dm_bless_for_disk(&new_le);
 
-			r = insert_at(sizeof(uint64_t), n, index,
+			r = insert_at(sizeof(uint64_t), n, *index,
 				      keys[level], &new_le);
 			if (r)
-				goto bad;
+				return r;
 		}
 
-		if (level < last_level)
-			block = value64(n, index);
+		block = value64(n, *index);
 	}
 
-	r = btree_insert_raw(&spine, block, &info->value_type,
-			     keys[level], &index);
-	if (r < 0)
-		goto bad;
+	return btree_insert_raw(s, block, &info->value_type, key, index,
+				leaf_hi);
+}
 
-	n = dm_block_data(shadow_current(&spine));
+/*
+ * Stores @value at @index of leaf @n, either as a new entry or over the
+ * existing one for @key.
+ */
+static int insert_value(struct dm_btree_info *info, struct btree_node *n,
+			unsigned index, uint64_t key, void *value,
+			int *inserted)
+			__dm_written_to_disk(value)
+{
+	int r;
 
-	if (need_insert(n, keys, level, index)) {
+	if (index >= le32_to_cpu(n->header.nr_entries) ||
+	    le64_to_cpu(n->keys[index]) != key) {
 		if (inserted)
 			*inserted = 1;
 
-		r = insert_at(info->value_type.size, n, index,
-			      keys[level], value);
+		r = insert_at(info->value_type.size, n, index, key, value);
 		if (r)
-			goto bad_unblessed;
+			return r;
 	} else {
 		if (inserted)
 			*inserted = 0;
@@ -835,6 +965,30 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 			    value, info->value_type.size);
 	}
 
+	return 0;
+}
+
+static int insert(struct dm_btree_info *info, dm_block_t root,
+		  uint64_t *keys, void *value, dm_block_t *new_root,
+		  int *inserted)
+		  __dm_written_to_disk(value)
+{
+	int r;
+	unsigned index, last_level = info->levels - 1;
+	struct shadow_spine spine;
+
+	init_shadow_spine(&spine, info);
+
+	r = insert_descend(info, &spine, root, keys, keys[last_level],
+			   &index, NULL);
+	if (r < 0)
+		goto bad;
+
+	r = insert_value(info, dm_block_data(shadow_current(&spine)), index,
+			 keys[last_level], value, inserted);
+	if (r)
+		goto bad_unblessed;
+
 	*new_root = shadow_root(&spine);
 	exit_shadow_spine(&spine);
 
@@ -864,6 +1018,82 @@ int dm_btree_insert_notify(struct dm_btree_info *info, dm_block_t root,
 }
 EXPORT_SYMBOL_GPL(dm_btree_insert_notify);
 
+int dm_btree_insert_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			void *values, dm_block_t *new_root,
+			unsigned *nr_inserted)
+			__dm_written_to_disk(values)
+{
+	int r = 0, inserted;
+	unsigned i = 0, index;
+	uint64_t hi;
+	struct shadow_spine spine;
+	struct btree_node *n;
+
+	*nr_inserted = 0;
+	*new_root = root;
+	if (!run_is_sorted(bottom_keys, nr)) {
+		r = -EINVAL;
+		goto bad;
+	}
+
+	while (i < nr) {
+		init_shadow_spine(&spine, info);
+
+		r = insert_descend(info, &spine, root, keys, bottom_keys[i],
+				   &index, &hi);
+		if (r < 0) {
+			exit_shadow_spine(&spine);
+			break;
+		}
+
+		/*
+		 * Carry on filling this leaf for as long as the keys belong
+		 * in it and it has room, the rest of the path is already
+		 * shadowed.
+		 */
+		n = dm_block_data(shadow_current(&spine));
+		for (;;) {
+			r = insert_value(info, n, index, bottom_keys[i],
+					 values + i * info->value_type.size,
+					 &inserted);
+			if (r)
+				break;
+
+			*nr_inserted += inserted;
+			if (++i == nr || bottom_keys[i] >= hi ||
+			    n->header.nr_entries == n->header.max_entries)
+				break;
+
+			while (++index < le32_to_cpu(n->header.nr_entries) &&
+			       le64_to_cpu(n->keys[index]) < bottom_keys[i])
+				;
+		}
+
+		root = shadow_root(&spine);
+		exit_shadow_spine(&spine);
+		*new_root = root;
+		if (r)
+			break;
+	}
+
+	if (!r)
+		return 0;
+
+bad:
+	/*
+	 * The tree took over the references of the values stored so far,
+	 * drop those of the rest.
+	 */
+	if (info->value_type.dec)
+		for (; i < nr; i++)
+			info->value_type.dec(info->value_type.context,
+					     values + i * info->value_type.size);
+	__dm_unbless_for_disk(values);
+	return r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_insert_run);
+
 /*----------------------------------------------------------------*/
 
 static int find_key(struct ro_spine *s, dm_block_t block, bool find_highest,
@@ -151,6 +151,43 @@ int dm_btree_remove_leaves(struct dm_btree_info *info, dm_block_t root,
 			   uint64_t *keys, uint64_t end_key,
 			   dm_block_t *new_root, unsigned *nr_removed);
 
+/*
+ * Batched variants, operating on a run of @nr bottom level keys that share
+ * the upper level @keys (info->levels - 1 of them).  @bottom_keys must be
+ * strictly ascending, or -EINVAL is returned.  Keys that fall in the same
+ * leaf are handled in a single traversal, so a run of neighbouring keys
+ * costs little more than one of them.
+ */
+
+/*
+ * Inserts (or overwrites) the values in @values, an array of @nr values of
+ * value_type.size bytes.  @nr_inserted is set to the number of keys that
+ * were not already present.  On failure the values that were not stored
+ * are released with value_type.dec.
+ */
+int dm_btree_insert_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			void *values, dm_block_t *new_root,
+			unsigned *nr_inserted)
+			__dm_written_to_disk(values);
+
+/*
+ * Copies the value of every key found to the same index of @values_le and
+ * sets the matching bit of @found, a bitmap of @nr bits.  Returns < 0 on
+ * failure, otherwise the number of keys found.
+ */
+int dm_btree_lookup_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			void *values_le, unsigned long *found);
+
+/*
+ * Removes those of the keys that are present.  Like dm_btree_remove() this
+ * doesn't remove empty sub trees.
+ */
+int dm_btree_remove_run(struct dm_btree_info *info, dm_block_t root,
+			uint64_t *keys, uint64_t *bottom_keys, unsigned nr,
+			dm_block_t *new_root, unsigned *nr_removed);
+
 /*
  * Returns < 0 on failure.  Otherwise the number of key entries that have
  * been filled out.  Remember trees can have zero entries, and as such have
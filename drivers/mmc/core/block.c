@@ -172,6 +172,7 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 			       int disable_multi,
 			       struct mmc_queue *mq);
 static void mmc_blk_hsq_req_done(struct mmc_request *mrq);
+static void mmc_blk_mq_complete_rq(struct mmc_queue *mq, struct request *req);
 
 static struct mmc_blk_data *mmc_blk_get(struct gendisk *disk)
 {
@@ -305,6 +306,67 @@ static ssize_t force_ro_store(struct device *dev, struct device_attribute *attr,
 	return ret;
 }
 
+static ssize_t packed_write_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	int ret;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+
+	ret = snprintf(buf, PAGE_SIZE, "%d\n",
+		       READ_ONCE(md->queue.packed_enabled));
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t packed_write_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	int ret;
+	bool enable;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+
+	ret = kstrtobool(buf, &enable);
+	if (!ret) {
+		WRITE_ONCE(md->queue.packed_enabled, enable);
+		ret = count;
+	}
+	mmc_blk_put(md);
+	return ret;
+}
+
+static DEVICE_ATTR_RW(packed_write);
+
+/*
+ * Packed commands issued, requests and blocks written through them, and packed
+ * commands that failed and had their members re-issued one by one.
+ */
+static ssize_t packed_stats_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	int ret;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_packed_stats *stats = &md->queue.packed_stats;
+
+	ret = snprintf(buf, PAGE_SIZE, "%lu %lu %lu %lu\n",
+		       READ_ONCE(stats->cmds), READ_ONCE(stats->reqs),
+		       READ_ONCE(stats->blocks), READ_ONCE(stats->fallbacks));
+	mmc_blk_put(md);
+	return ret;
+}
+
+static DEVICE_ATTR_RO(packed_stats);
+
+static struct attribute *mmc_packed_attrs[] = {
+	&dev_attr_packed_write.attr,
+	&dev_attr_packed_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group mmc_packed_attr_group = {
+	.attrs = mmc_packed_attrs,
+};
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -1856,11 +1918,19 @@ static inline void mmc_blk_rw_reset_success(struct mmc_queue *mq,
 	mmc_blk_reset_success(mq->blkdata, type);
 }
 
+static void mmc_blk_packed_complete_rq(struct mmc_queue *mq,
+				       struct request *req);
+
 static void mmc_blk_mq_complete_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	unsigned int nr_bytes = mqrq->brq.data.bytes_xfered;
 
+	if (mqrq->packed) {
+		mmc_blk_packed_complete_rq(mq, req);
+		return;
+	}
+
 	if (nr_bytes) {
 		if (blk_update_request(req, BLK_STS_OK, nr_bytes))
 			blk_mq_requeue_request(req, true);
@@ -1892,6 +1962,47 @@ static void mmc_blk_urgent_bkops(struct mmc_queue *mq,
 		mmc_run_bkops(mq->card);
 }
 
+static void mmc_blk_packed_put(struct mmc_queue *mq, struct mmc_packed *packed)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	packed->in_use = false;
+	spin_unlock_irqrestore(&mq->lock, flags);
+}
+
+/*
+ * The card reports which entry of a failed packed command went wrong only
+ * through EXT_CSD, which cannot be read from here. So on any error all members
+ * are retried, and with a non-zero retry count they are then issued one by
+ * one. Writing the same data again is harmless.
+ */
+static void mmc_blk_packed_complete_rq(struct mmc_queue *mq,
+				       struct request *req)
+{
+	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_packed *packed = mqrq->packed;
+	struct request *prq, *tmp;
+	bool ok;
+
+	ok = brq->data.bytes_xfered == brq->data.blocks * brq->data.blksz;
+	if (!ok)
+		WRITE_ONCE(mq->packed_stats.fallbacks,
+			   mq->packed_stats.fallbacks + 1);
+
+	list_for_each_entry_safe(prq, tmp, &packed->list, queuelist) {
+		struct mmc_queue_req *pmqrq = req_to_mmc_queue_req(prq);
+
+		list_del_init(&prq->queuelist);
+		pmqrq->packed = NULL;
+		pmqrq->brq.data.bytes_xfered = ok ? blk_rq_bytes(prq) : 0;
+		mmc_blk_mq_complete_rq(mq, prq);
+	}
+
+	mmc_blk_packed_put(mq, packed);
+}
+
 static void mmc_blk_hsq_req_done(struct mmc_request *mrq)
 {
 	struct mmc_queue_req *mqrq =
@@ -1954,14 +2065,15 @@ static void mmc_blk_mq_poll_completion(struct mmc_queue *mq,
 	mmc_blk_urgent_bkops(mq, mqrq);
 }
 
-static void mmc_blk_mq_dec_in_flight(struct mmc_queue *mq, struct request *req)
+static void mmc_blk_mq_dec_in_flight(struct mmc_queue *mq, struct request *req,
+				     unsigned int nr)
 {
 	unsigned long flags;
 	bool put_card;
 
 	spin_lock_irqsave(&mq->lock, flags);
 
-	mq->in_flight[mmc_issue_type(mq, req)] -= 1;
+	mq->in_flight[mmc_issue_type(mq, req)] -= nr;
 
 	put_card = (mmc_tot_in_flight(mq) == 0);
 
@@ -1976,6 +2088,8 @@ static void mmc_blk_mq_post_req(struct mmc_queue *mq, struct request *req)
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	struct mmc_request *mrq = &mqrq->brq.mrq;
 	struct mmc_host *host = mq->card->host;
+	/* All members of a packed command complete with the last one */
+	unsigned int nr = mqrq->packed ? mqrq->packed->nr_entries : 1;
 
 	mmc_post_req(host, mrq, 0);
 
@@ -1988,7 +2102,7 @@ static void mmc_blk_mq_post_req(struct mmc_queue *mq, struct request *req)
 	else if (likely(!blk_should_fake_timeout(req->q)))
 		blk_mq_complete_request(req);
 
-	mmc_blk_mq_dec_in_flight(mq, req);
+	mmc_blk_mq_dec_in_flight(mq, req, nr);
 }
 
 void mmc_blk_mq_recovery(struct mmc_queue *mq)
@@ -2135,16 +2249,13 @@ static int mmc_blk_rw_wait(struct mmc_queue *mq, struct request **prev_req)
 	return err;
 }
 
-static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
-				  struct request *req)
+static int mmc_blk_mq_start_rw_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	struct mmc_host *host = mq->card->host;
 	struct request *prev_req = NULL;
 	int err = 0;
 
-	mmc_blk_rw_rq_prep(mqrq, mq->card, 0, mq);
-
 	mqrq->brq.mrq.done = mmc_blk_mq_req_done;
 
 	mmc_pre_req(host, &mqrq->brq.mrq);
@@ -2174,6 +2285,258 @@ static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
 	return err;
 }
 
+static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
+				  struct request *req)
+{
+	mmc_blk_rw_rq_prep(req_to_mmc_queue_req(req), mq->card, 0, mq);
+
+	return mmc_blk_mq_start_rw_rq(mq, req);
+}
+
+/*
+ * eMMC 4.5 packed write: several write requests are sent as one CMD23/CMD25
+ * transfer whose first block(s) hold a header with the CMD23 and CMD25
+ * arguments of each member.
+ */
+#define MMC_PACKED_CMD_VER	0x01
+#define MMC_PACKED_CMD_WR	0x02
+
+static bool mmc_blk_packed_fits(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_host *host = mq->card->host;
+	struct mmc_packed *packed = mq->packed;
+	unsigned int nr_entries = 0, nr_segs = 0;
+	unsigned int blocks = mq->packed_hdr_blocks;
+
+	if (!mq->packed_slots || !READ_ONCE(mq->packed_enabled))
+		return false;
+
+	/* Reliable writes, tagged writes and retries are issued on their own */
+	if (req_op(req) != REQ_OP_WRITE ||
+	    (req->cmd_flags & (REQ_FUA | REQ_META)) ||
+	    req_to_mmc_queue_req(req)->retries)
+		return false;
+
+	if (packed) {
+		nr_entries = packed->nr_entries;
+		nr_segs = packed->nr_segs;
+		blocks += packed->blocks;
+	}
+
+	nr_segs += blk_rq_nr_phys_segments(req);
+	blocks += blk_rq_sectors(req);
+
+	/* The header takes one segment */
+	return nr_entries < mq->packed_max_entries &&
+	       nr_segs < host->max_segs &&
+	       blocks <= host->max_blk_count &&
+	       blocks <= host->max_req_size >> 9;
+}
+
+static struct mmc_packed *mmc_blk_packed_get(struct mmc_queue *mq)
+{
+	struct mmc_packed *packed = NULL;
+	int i;
+
+	spin_lock_irq(&mq->lock);
+	for (i = 0; i < MMC_PACKED_NR_SLOTS; i++) {
+		if (!mq->packed_slots[i].in_use) {
+			packed = &mq->packed_slots[i];
+			packed->in_use = true;
+			break;
+		}
+	}
+	spin_unlock_irq(&mq->lock);
+
+	if (packed) {
+		packed->nr_entries = 0;
+		packed->nr_segs = 0;
+		packed->blocks = 0;
+	}
+
+	return packed;
+}
+
+static void mmc_blk_packed_prep(struct mmc_queue *mq,
+				struct mmc_packed *packed,
+				struct request *req)
+{
+	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_card *card = mq->card;
+	unsigned int hdr_blocks = mq->packed_hdr_blocks;
+	unsigned int blocks = packed->blocks + hdr_blocks;
+	__le32 *hdr = packed->cmd_hdr;
+	struct request *first, *prq;
+	struct scatterlist *sg;
+	unsigned int sg_len = 1;
+	int i = 1;
+
+	memset(hdr, 0, hdr_blocks << 9);
+	hdr[0] = cpu_to_le32((packed->nr_entries << 16) |
+			     (MMC_PACKED_CMD_WR << 8) | MMC_PACKED_CMD_VER);
+
+	sg_init_table(packed->sg, card->host->max_segs);
+	sg = packed->sg;
+	sg_set_buf(sg, hdr, hdr_blocks << 9);
+
+	list_for_each_entry(prq, &packed->list, queuelist) {
+		struct mmc_queue_req *pmqrq = req_to_mmc_queue_req(prq);
+		struct scatterlist *psg;
+		u32 addr = blk_rq_pos(prq);
+		unsigned int n;
+		int j;
+
+		if (!mmc_card_blockaddr(card))
+			addr <<= 9;
+
+		/* Arguments of CMD23 and CMD25 for this entry */
+		hdr[i * 2] = cpu_to_le32(blk_rq_sectors(prq));
+		hdr[i * 2 + 1] = cpu_to_le32(addr);
+		i++;
+
+		n = mmc_queue_map_sg(mq, pmqrq);
+		for_each_sg(pmqrq->sg, psg, n, j) {
+			sg = sg_next(sg);
+			sg_set_page(sg, sg_page(psg), psg->length,
+				    psg->offset);
+		}
+		sg_len += n;
+	}
+	sg_mark_end(sg);
+
+	first = list_first_entry(&packed->list, struct request, queuelist);
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+
+	brq->mrq.sbc = &brq->sbc;
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	brq->mrq.stop = &brq->stop;
+	brq->mrq.tag = req->tag;
+
+	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+	brq->sbc.arg = MMC_CMD23_ARG_PACKED | blocks;
+	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(first);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	brq->data.flags = MMC_DATA_WRITE;
+	brq->data.blksz = 512;
+	brq->data.blocks = blocks;
+	brq->data.blk_addr = blk_rq_pos(first);
+	brq->data.sg = packed->sg;
+	brq->data.sg_len = sg_len;
+
+	mmc_set_data_timeout(&brq->data, card);
+}
+
+/*
+ * Give a held request that failed to start back to the block layer. This
+ * counts as a retry, so that it is issued on its own the next time, and
+ * fails once it has run out of retries.
+ */
+static void mmc_blk_packed_requeue(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
+
+	mmc_blk_mq_dec_in_flight(mq, req, 1);
+	if (mqrq->retries++ < MMC_MAX_RETRIES)
+		blk_mq_requeue_request(req, true);
+	else
+		blk_mq_end_request(req, BLK_STS_IOERR);
+}
+
+/*
+ * Issue the gathered requests. They have already been reported as started to
+ * the block layer, so failing to start them means requeueing them, see
+ * mmc_blk_packed_requeue().
+ */
+static void mmc_blk_packed_issue(struct mmc_queue *mq)
+{
+	struct mmc_packed *packed = mq->packed;
+	struct mmc_packed_stats *stats = &mq->packed_stats;
+	unsigned int nr_entries = packed->nr_entries;
+	unsigned int blocks = packed->blocks;
+	struct request *req, *tmp;
+
+	mq->packed = NULL;
+
+	if (nr_entries == 1) {
+		req = list_first_entry(&packed->list, struct request,
+				       queuelist);
+		list_del_init(&req->queuelist);
+		req_to_mmc_queue_req(req)->packed = NULL;
+		mmc_blk_packed_put(mq, packed);
+
+		if (mmc_blk_mq_issue_rw_rq(mq, req))
+			mmc_blk_packed_requeue(mq, req);
+		return;
+	}
+
+	/* The last member carries the packed command */
+	req = list_last_entry(&packed->list, struct request, queuelist);
+	mmc_blk_packed_prep(mq, packed, req);
+
+	if (!mmc_blk_mq_start_rw_rq(mq, req)) {
+		WRITE_ONCE(stats->cmds, stats->cmds + 1);
+		WRITE_ONCE(stats->reqs, stats->reqs + nr_entries);
+		WRITE_ONCE(stats->blocks, stats->blocks + blocks);
+		return;
+	}
+
+	list_for_each_entry_safe(req, tmp, &packed->list, queuelist) {
+		list_del_init(&req->queuelist);
+		req_to_mmc_queue_req(req)->packed = NULL;
+		mmc_blk_packed_requeue(mq, req);
+	}
+	mmc_blk_packed_put(mq, packed);
+}
+
+/*
+ * Hold back a write that can be packed with the ones dispatched after it.
+ * Returns false if the request must be issued on its own.
+ */
+static bool mmc_blk_packed_add(struct mmc_queue *mq, struct request *req,
+			       bool last)
+{
+	struct mmc_packed *packed = mq->packed;
+
+	if (!packed) {
+		if (last || !mmc_blk_packed_fits(mq, req))
+			return false;
+		packed = mmc_blk_packed_get(mq);
+		if (!packed)
+			return false;
+		mq->packed = packed;
+	}
+
+	list_add_tail(&req->queuelist, &packed->list);
+	req_to_mmc_queue_req(req)->packed = packed;
+	packed->nr_entries += 1;
+	packed->nr_segs += blk_rq_nr_phys_segments(req);
+	packed->blocks += blk_rq_sectors(req);
+
+	if (last)
+		mmc_blk_packed_issue(mq);
+
+	return true;
+}
+
+/* Called with mq->busy set once the block layer has no more requests */
+void mmc_blk_mq_commit_rqs(struct mmc_queue *mq)
+{
+	if (mq->packed)
+		mmc_blk_packed_issue(mq);
+}
+
 static int mmc_blk_wait_for_idle(struct mmc_queue *mq, struct mmc_host *host)
 {
 	if (mq->use_cqe)
@@ -2182,13 +2545,18 @@ static int mmc_blk_wait_for_idle(struct mmc_queue *mq, struct mmc_host *host)
 	return mmc_blk_rw_wait(mq, NULL);
 }
 
-enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req)
+enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req,
+				    bool last)
 {
 	struct mmc_blk_data *md = mq->blkdata;
 	struct mmc_card *card = md->queue.card;
 	struct mmc_host *host = card->host;
 	int ret;
 
+	/* Held requests go first, unless this one can join them */
+	if (mq->packed && !mmc_blk_packed_fits(mq, req))
+		mmc_blk_packed_issue(mq);
+
 	ret = mmc_blk_part_switch(card, md->part_type);
 	if (ret)
 		return MMC_REQ_FAILED_TO_START;
@@ -2227,6 +2595,8 @@ enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req)
 		case REQ_OP_WRITE:
 			if (mq->use_cqe)
 				ret = mmc_blk_cqe_issue_rw_rq(mq, req);
+			else if (mmc_blk_packed_add(mq, req, last))
+				ret = 0;
 			else
 				ret = mmc_blk_mq_issue_rw_rq(mq, req);
 			break;
@@ -2633,6 +3003,9 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 					card->ext_csd.boot_ro_lockable)
 				device_remove_file(disk_to_dev(md->disk),
 					&md->power_ro_lock);
+			if (md->queue.packed_slots)
+				sysfs_remove_group(&disk_to_dev(md->disk)->kobj,
+						   &mmc_packed_attr_group);
 
 			del_gendisk(md->disk);
 		}
@@ -2697,8 +3070,19 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 		if (ret)
 			goto power_ro_lock_fail;
 	}
+
+	if (md->queue.packed_slots) {
+		ret = sysfs_create_group(&disk_to_dev(md->disk)->kobj,
+					 &mmc_packed_attr_group);
+		if (ret)
+			goto packed_fail;
+	}
 	return ret;
 
+packed_fail:
+	if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
+	     card->ext_csd.boot_ro_lockable)
+		device_remove_file(disk_to_dev(md->disk), &md->power_ro_lock);
 power_ro_lock_fail:
 	device_remove_file(disk_to_dev(md->disk), &md->force_ro);
 force_ro_fail:
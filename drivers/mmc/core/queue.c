@@ -243,6 +243,35 @@ static void mmc_mq_exit_request(struct blk_mq_tag_set *set, struct request *req,
 	mmc_exit_request(mq->queue, req);
 }
 
+/*
+ * Requests gathered for a packed write are held by the driver until the block
+ * layer signals the end of a dispatch batch, either with bd->last or with
+ * ->commit_rqs(). The latter can race with another dispatcher holding
+ * mq->busy, in which case the commit is handed over to that dispatcher, which
+ * must then issue the held requests before dropping mq->busy.
+ */
+static void mmc_mq_release_busy(struct mmc_queue *mq)
+{
+	bool commit;
+
+	if (!mq->packed_slots) {
+		WRITE_ONCE(mq->busy, false);
+		return;
+	}
+
+	do {
+		spin_lock_irq(&mq->lock);
+		commit = mq->packed_commit;
+		mq->packed_commit = false;
+		if (!commit)
+			mq->busy = false;
+		spin_unlock_irq(&mq->lock);
+
+		if (commit)
+			mmc_blk_mq_commit_rqs(mq);
+	} while (commit);
+}
+
 static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 				    const struct blk_mq_queue_data *bd)
 {
@@ -324,7 +353,7 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(req);
 
-	issued = mmc_blk_mq_issue_rq(mq, req);
+	issued = mmc_blk_mq_issue_rq(mq, req, bd->last);
 
 	switch (issued) {
 	case MMC_REQ_BUSY:
@@ -345,19 +374,41 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 		mq->in_flight[issue_type] -= 1;
 		if (mmc_tot_in_flight(mq) == 0)
 			put_card = true;
-		mq->busy = false;
 		spin_unlock_irq(&mq->lock);
 		if (put_card)
 			mmc_put_card(card, &mq->ctx);
-	} else {
-		WRITE_ONCE(mq->busy, false);
 	}
 
+	mmc_mq_release_busy(mq);
+
 	return ret;
 }
 
+static void mmc_mq_commit_rqs(struct blk_mq_hw_ctx *hctx)
+{
+	struct mmc_queue *mq = hctx->queue->queuedata;
+
+	if (!mq->packed_slots)
+		return;
+
+	spin_lock_irq(&mq->lock);
+	if (mq->busy) {
+		/* Leave it to the current dispatcher, see mmc_mq_release_busy() */
+		mq->packed_commit = true;
+		spin_unlock_irq(&mq->lock);
+		return;
+	}
+	mq->busy = true;
+	spin_unlock_irq(&mq->lock);
+
+	mmc_blk_mq_commit_rqs(mq);
+
+	mmc_mq_release_busy(mq);
+}
+
 static const struct blk_mq_ops mmc_mq_ops = {
 	.queue_rq	= mmc_mq_queue_rq,
+	.commit_rqs	= mmc_mq_commit_rqs,
 	.init_request	= mmc_mq_init_request,
 	.exit_request	= mmc_mq_exit_request,
 	.complete	= mmc_blk_mq_complete,
@@ -409,6 +460,81 @@ static void mmc_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 	init_waitqueue_head(&mq->wait);
 }
 
+static bool mmc_packed_write_capable(struct mmc_queue *mq,
+				     struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+
+	/*
+	 * Packed commands are bounded by CMD23 and the header and all member
+	 * data must fit into a single host transfer. Hosts opt in, as not all
+	 * of them cope with the large transfers packing produces.
+	 */
+	return (host->caps2 & MMC_CAP2_PACKED_WR) &&
+	       mmc_card_mmc(card) && card->ext_csd.max_packed_writes > 1 &&
+	       !mq->use_cqe && !mmc_host_is_spi(host) &&
+	       (host->caps & MMC_CAP_CMD23) &&
+	       !(card->quirks & MMC_QUIRK_BLK_NO_CMD23) &&
+	       !host->ops->multi_io_quirk && !host->can_dma_map_merge &&
+	       host->max_segs > 1;
+}
+
+static void mmc_packed_free(struct mmc_queue *mq)
+{
+	int i;
+
+	if (!mq->packed_slots)
+		return;
+
+	for (i = 0; i < MMC_PACKED_NR_SLOTS; i++) {
+		kfree(mq->packed_slots[i].cmd_hdr);
+		kfree(mq->packed_slots[i].sg);
+	}
+	kfree(mq->packed_slots);
+	mq->packed_slots = NULL;
+}
+
+/*
+ * Packing is optional, so failing to allocate the packed command slots only
+ * leaves the queue without it.
+ */
+static void mmc_packed_init(struct mmc_queue *mq, struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	unsigned int hdr_size = 512;
+	int i;
+
+	if (!mmc_packed_write_capable(mq, card))
+		return;
+
+	if (card->ext_csd.data_sector_size)
+		hdr_size = card->ext_csd.data_sector_size;
+
+	mq->packed_slots = kcalloc(MMC_PACKED_NR_SLOTS,
+				   sizeof(*mq->packed_slots), GFP_KERNEL);
+	if (!mq->packed_slots)
+		return;
+
+	for (i = 0; i < MMC_PACKED_NR_SLOTS; i++) {
+		struct mmc_packed *packed = &mq->packed_slots[i];
+
+		INIT_LIST_HEAD(&packed->list);
+		packed->cmd_hdr = kzalloc(hdr_size, GFP_KERNEL);
+		packed->sg = mmc_alloc_sg(host->max_segs, GFP_KERNEL);
+		if (!packed->cmd_hdr || !packed->sg) {
+			mmc_packed_free(mq);
+			return;
+		}
+	}
+
+	mq->packed_hdr_blocks = hdr_size >> 9;
+	/* Each entry is 8 bytes and the first one is the header proper */
+	mq->packed_max_entries = min_t(unsigned int,
+				       card->ext_csd.max_packed_writes,
+				       hdr_size / 8 - 1);
+	mq->packed_enabled = true;
+}
+
 static inline bool mmc_merge_capable(struct mmc_host *host)
 {
 	return host->caps2 & MMC_CAP2_MERGE_CAPABLE;
@@ -480,6 +606,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card)
 	blk_queue_rq_timeout(mq->queue, 60 * HZ);
 
 	mmc_setup_queue(mq, card);
+	mmc_packed_init(mq, card);
 	return 0;
 
 free_tag_set:
@@ -525,6 +652,8 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	 */
 	flush_work(&mq->complete_work);
 
+	mmc_packed_free(mq);
+
 	mq->card = NULL;
 }
 
@@ -28,6 +28,7 @@ static inline struct mmc_queue_req *req_to_mmc_queue_req(struct request *rq)
 }
 
 struct mmc_queue_req;
+struct mmc_packed;
 
 static inline struct request *mmc_queue_req_to_req(struct mmc_queue_req *mqr)
 {
@@ -69,6 +70,45 @@ struct mmc_queue_req {
 	void			*drv_op_data;
 	unsigned int		ioc_count;
 	int			retries;
+	struct mmc_packed	*packed;
+};
+
+/* Number of packed commands that can be gathered or in flight at once */
+#define MMC_PACKED_NR_SLOTS	3
+
+/**
+ * struct mmc_packed - an eMMC packed write command
+ * @list: member requests linked through their queuelist, in header order
+ * @cmd_hdr: packed command header, sent as the first block(s) of data
+ * @sg: scatterlist for the header followed by the data of all members
+ * @nr_entries: number of member requests
+ * @nr_segs: upper bound of the number of data segments of all members
+ * @blocks: number of 512-byte data blocks of all members
+ * @in_use: set while the slot is being gathered or is in flight
+ */
+struct mmc_packed {
+	struct list_head	list;
+	__le32			*cmd_hdr;
+	struct scatterlist	*sg;
+	unsigned int		nr_entries;
+	unsigned int		nr_segs;
+	unsigned int		blocks;
+	bool			in_use;
+};
+
+/**
+ * struct mmc_packed_stats - packed write counters
+ * @cmds: number of packed commands issued
+ * @reqs: number of requests issued as part of a packed command
+ * @blocks: number of data blocks written by packed commands
+ * @fallbacks: number of packed commands that failed and whose members
+ *	       were re-issued one by one
+ */
+struct mmc_packed_stats {
+	unsigned long		cmds;
+	unsigned long		reqs;
+	unsigned long		blocks;
+	unsigned long		fallbacks;
 };
 
 struct mmc_queue {
@@ -94,6 +134,14 @@ struct mmc_queue {
 	struct request		*complete_req;
 	struct mutex		complete_lock;
 	struct work_struct	complete_work;
+
+	struct mmc_packed	*packed_slots;	/* NULL if packing is impossible */
+	struct mmc_packed	*packed;	/* packed command being gathered */
+	bool			packed_enabled;
+	bool			packed_commit;
+	unsigned int		packed_hdr_blocks;
+	unsigned int		packed_max_entries;
+	struct mmc_packed_stats	packed_stats;
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *);
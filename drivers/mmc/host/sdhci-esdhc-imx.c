@@ -1634,6 +1634,11 @@ static int sdhci_esdhc_imx_probe(struct platform_device *pdev)
 	if (err)
 		goto disable_ahb_clk;
 
+	/* Overlap request preparation with transfers on eMMC */
+	if (!(imx_data->socdata->flags & ESDHC_FLAG_CQHCI) &&
+	    (host->mmc->caps & MMC_CAP_NONREMOVABLE))
+		host->flags |= SDHCI_USE_HSQ;
+
 	sdhci_esdhc_imx_hwinit(host);
 
 	err = sdhci_add_host(host);
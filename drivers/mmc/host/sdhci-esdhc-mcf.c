@@ -319,7 +319,7 @@ static void esdhc_mcf_request_done(struct sdhci_host *host,
 	}
 
 exit_done:
-	mmc_request_done(host->mmc, mrq);
+	sdhci_mmc_request_done(host, mrq);
 }
 
 static void esdhc_mcf_copy_to_bounce_buffer(struct sdhci_host *host,
@@ -19,7 +19,6 @@
 #include <linux/slab.h>
 
 #include "sdhci-pltfm.h"
-#include "mmc_hsq.h"
 
 /* SDHCI_ARGUMENT2 register high 16bit */
 #define SDHCI_SPRD_ARG2_STUFF		GENMASK(31, 16)
@@ -380,16 +379,6 @@ static unsigned int sdhci_sprd_get_ro(struct sdhci_host *host)
 	return 0;
 }
 
-static void sdhci_sprd_request_done(struct sdhci_host *host,
-				    struct mmc_request *mrq)
-{
-	/* Validate if the request was from software queue firstly. */
-	if (mmc_hsq_finalize_request(host->mmc, mrq))
-		return;
-
-	mmc_request_done(host->mmc, mrq);
-}
-
 static struct sdhci_ops sdhci_sprd_ops = {
 	.read_l = sdhci_sprd_readl,
 	.write_l = sdhci_sprd_writel,
@@ -403,7 +392,6 @@ static struct sdhci_ops sdhci_sprd_ops = {
 	.hw_reset = sdhci_sprd_hw_reset,
 	.get_max_timeout_count = sdhci_sprd_get_max_timeout_count,
 	.get_ro = sdhci_sprd_get_ro,
-	.request_done = sdhci_sprd_request_done,
 };
 
 static void sdhci_sprd_check_auto_cmd23(struct mmc_host *mmc,
@@ -547,7 +535,6 @@ static int sdhci_sprd_probe(struct platform_device *pdev)
 {
 	struct sdhci_host *host;
 	struct sdhci_sprd_host *sprd_host;
-	struct mmc_hsq *hsq;
 	struct clk *clk;
 	int ret = 0;
 
@@ -578,8 +565,6 @@ static int sdhci_sprd_probe(struct platform_device *pdev)
 
 	if (!mmc_card_is_removable(host->mmc))
 		host->mmc_host_ops.request_atomic = sdhci_sprd_request_atomic;
-	else
-		host->always_defer_done = true;
 
 	sprd_host = TO_SPRD_HOST(host);
 	sdhci_sprd_phy_param_parse(sprd_host, pdev->dev.of_node);
@@ -664,15 +649,7 @@ static int sdhci_sprd_probe(struct platform_device *pdev)
 
 	sprd_host->flags = host->flags;
 
-	hsq = devm_kzalloc(&pdev->dev, sizeof(*hsq), GFP_KERNEL);
-	if (!hsq) {
-		ret = -ENOMEM;
-		goto err_cleanup_host;
-	}
-
-	ret = mmc_hsq_init(hsq, host->mmc);
-	if (ret)
-		goto err_cleanup_host;
+	host->flags |= SDHCI_USE_HSQ;
 
 	ret = __sdhci_add_host(host);
 	if (ret)
@@ -732,7 +709,6 @@ static int sdhci_sprd_runtime_suspend(struct device *dev)
 	struct sdhci_host *host = dev_get_drvdata(dev);
 	struct sdhci_sprd_host *sprd_host = TO_SPRD_HOST(host);
 
-	mmc_hsq_suspend(host->mmc);
 	sdhci_runtime_suspend_host(host);
 
 	clk_disable_unprepare(sprd_host->clk_sdio);
@@ -761,7 +737,6 @@ static int sdhci_sprd_runtime_resume(struct device *dev)
 		goto clk_disable;
 
 	sdhci_runtime_resume_host(host, 1);
-	mmc_hsq_resume(host->mmc);
 
 	return 0;
 
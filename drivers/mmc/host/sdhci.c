@@ -34,6 +34,7 @@
 #include <linux/mmc/slot-gpio.h>
 
 #include "sdhci.h"
+#include "mmc_hsq.h"
 
 #define DRIVER_NAME "sdhci"
 
@@ -2978,6 +2979,29 @@ static const struct mmc_host_ops sdhci_ops = {
  *                                                                           *
 \*****************************************************************************/
 
+/*
+ * Requests from the software queue go back to it first. Drivers with their
+ * own ->request_done() must complete through here, not mmc_request_done().
+ */
+void sdhci_mmc_request_done(struct sdhci_host *host, struct mmc_request *mrq)
+{
+	if ((host->flags & SDHCI_USE_HSQ) &&
+	    mmc_hsq_finalize_request(host->mmc, mrq))
+		return;
+
+	mmc_request_done(host->mmc, mrq);
+}
+EXPORT_SYMBOL_GPL(sdhci_mmc_request_done);
+
+static void sdhci_complete_mrq(struct sdhci_host *host,
+			       struct mmc_request *mrq)
+{
+	if (host->ops->request_done)
+		host->ops->request_done(host, mrq);
+	else
+		sdhci_mmc_request_done(host, mrq);
+}
+
 static bool sdhci_request_done(struct sdhci_host *host)
 {
 	unsigned long flags;
@@ -3093,10 +3117,7 @@ static bool sdhci_request_done(struct sdhci_host *host)
 
 	spin_unlock_irqrestore(&host->lock, flags);
 
-	if (host->ops->request_done)
-		host->ops->request_done(host, mrq);
-	else
-		mmc_request_done(host->mmc, mrq);
+	sdhci_complete_mrq(host, mrq);
 
 	return false;
 }
@@ -3530,10 +3551,7 @@ static irqreturn_t sdhci_irq(int irq, void *dev_id)
 		if (!mrqs_done[i])
 			continue;
 
-		if (host->ops->request_done)
-			host->ops->request_done(host, mrqs_done[i]);
-		else
-			mmc_request_done(host->mmc, mrqs_done[i]);
+		sdhci_complete_mrq(host, mrqs_done[i]);
 	}
 
 	if (unexpected) {
@@ -3708,6 +3726,9 @@ int sdhci_runtime_suspend_host(struct sdhci_host *host)
 {
 	unsigned long flags;
 
+	if ((host->flags & SDHCI_USE_HSQ) && host->mmc->hsq_enabled)
+		mmc_hsq_suspend(host->mmc);
+
 	mmc_retune_timer_stop(host->mmc);
 
 	spin_lock_irqsave(&host->lock, flags);
@@ -3772,6 +3793,9 @@ int sdhci_runtime_resume_host(struct sdhci_host *host, int soft_reset)
 
 	spin_unlock_irqrestore(&host->lock, flags);
 
+	if ((host->flags & SDHCI_USE_HSQ) && mmc->hsq_enabled)
+		mmc_hsq_resume(mmc);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(sdhci_runtime_resume_host);
@@ -4670,6 +4694,47 @@ void sdhci_cleanup_host(struct sdhci_host *host)
 }
 EXPORT_SYMBOL_GPL(sdhci_cleanup_host);
 
+/*
+ * The MMC host software queue lets the core prepare the next request while
+ * the current one is running, and issue it from the completion path of the
+ * current one instead of going back through the block layer.
+ */
+static int sdhci_setup_hsq(struct sdhci_host *host)
+{
+	struct mmc_host *mmc = host->mmc;
+	struct mmc_hsq *hsq;
+	int ret;
+
+	/* A hardware command queue engine makes the software one pointless */
+	if (mmc->cqe_ops) {
+		host->flags &= ~SDHCI_USE_HSQ;
+		return 0;
+	}
+
+	hsq = devm_kzalloc(mmc_dev(mmc), sizeof(*hsq), GFP_KERNEL);
+	if (!hsq)
+		return -ENOMEM;
+
+	ret = mmc_hsq_init(hsq, mmc);
+	if (ret)
+		return ret;
+
+	/*
+	 * The next request is issued from the completion of the previous one,
+	 * possibly in interrupt context. That needs ->request_atomic(), which
+	 * cannot be used when card detection may sleep, so requests to
+	 * removable cards are always completed from the workqueue instead.
+	 */
+	if (!mmc_card_is_removable(mmc)) {
+		if (!host->mmc_host_ops.request_atomic)
+			host->mmc_host_ops.request_atomic = sdhci_request_atomic;
+	} else {
+		host->always_defer_done = true;
+	}
+
+	return 0;
+}
+
 int __sdhci_add_host(struct sdhci_host *host)
 {
 	unsigned int flags = WQ_UNBOUND | WQ_MEM_RECLAIM | WQ_HIGHPRI;
@@ -4682,6 +4747,12 @@ int __sdhci_add_host(struct sdhci_host *host)
 		mmc->cqe_ops = NULL;
 	}
 
+	if (host->flags & SDHCI_USE_HSQ) {
+		ret = sdhci_setup_hsq(host);
+		if (ret)
+			return ret;
+	}
+
 	host->complete_wq = alloc_workqueue("sdhci", flags, 0);
 	if (!host->complete_wq)
 		return -ENOMEM;
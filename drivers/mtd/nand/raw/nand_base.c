@@ -1081,6 +1081,128 @@ static int nand_lp_exec_read_page_op(struct nand_chip *chip, unsigned int page,
 	return nand_exec_op(chip, &op);
 }
 
+static int nand_lp_exec_cont_read_page_op(struct nand_chip *chip,
+					  unsigned int page,
+					  unsigned int offset_in_page,
+					  void *buf, unsigned int len,
+					  bool check_only)
+{
+	const struct nand_sdr_timings *sdr =
+		nand_get_sdr_timings(nand_get_interface_config(chip));
+	u8 addrs[5];
+	struct nand_op_instr start_instrs[] = {
+		NAND_OP_CMD(NAND_CMD_READ0, 0),
+		NAND_OP_ADDR(4, addrs, 0),
+		NAND_OP_CMD(NAND_CMD_READSTART, PSEC_TO_NSEC(sdr->tWB_max)),
+		NAND_OP_WAIT_RDY(PSEC_TO_MSEC(sdr->tR_max), 0),
+		NAND_OP_CMD(NAND_CMD_READCACHESEQ, PSEC_TO_NSEC(sdr->tWB_max)),
+		NAND_OP_WAIT_RDY(PSEC_TO_MSEC(sdr->tR_max),
+				 PSEC_TO_NSEC(sdr->tRR_min)),
+		NAND_OP_DATA_IN(len, buf, 0),
+	};
+	struct nand_op_instr cont_instrs[] = {
+		NAND_OP_CMD(page == chip->cont_read.last_page ?
+			    NAND_CMD_READCACHEEND : NAND_CMD_READCACHESEQ,
+			    PSEC_TO_NSEC(sdr->tWB_max)),
+		NAND_OP_WAIT_RDY(PSEC_TO_MSEC(sdr->tR_max),
+				 PSEC_TO_NSEC(sdr->tRR_min)),
+		NAND_OP_DATA_IN(len, buf, 0),
+	};
+	struct nand_operation start_op = NAND_OPERATION(chip->cur_cs,
+							start_instrs);
+	struct nand_operation cont_op = NAND_OPERATION(chip->cur_cs,
+						       cont_instrs);
+	int ret;
+
+	/* Drop the DATA_IN instructions if len is set to 0. */
+	if (!len) {
+		start_op.ninstrs--;
+		cont_op.ninstrs--;
+	}
+
+	ret = nand_fill_column_cycles(chip, addrs, offset_in_page);
+	if (ret < 0)
+		return ret;
+
+	addrs[2] = page;
+	addrs[3] = page >> 8;
+
+	if (chip->options & NAND_ROW_ADDR_3) {
+		addrs[4] = page >> 16;
+		start_instrs[1].ctx.addr.naddrs++;
+	}
+
+	/* Check if the controller can chain cached page reads */
+	if (check_only) {
+		if (nand_check_op(chip, &start_op) ||
+		    nand_check_op(chip, &cont_op))
+			return -EOPNOTSUPP;
+
+		return 0;
+	}
+
+	if (page == chip->cont_read.first_page)
+		ret = nand_exec_op(chip, &start_op);
+	else
+		ret = nand_exec_op(chip, &cont_op);
+	if (ret)
+		return ret;
+
+	/* READ CACHE END leaves the cache read mode */
+	if (page == chip->cont_read.last_page) {
+		chip->cont_read.ongoing = 0;
+		chip->cont_read.started = 0;
+	} else {
+		chip->cont_read.started = 1;
+		chip->cont_read.next_page = page + 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Terminate a cached read sequence early, e.g. after an error. READ CACHE END
+ * moves the page which is being loaded to the cache register, where it is
+ * simply left unread.
+ */
+static void rawnand_cont_read_stop(struct nand_chip *chip)
+{
+	if (chip->cont_read.started) {
+		chip->cont_read.last_page = chip->cont_read.next_page;
+		nand_lp_exec_cont_read_page_op(chip, chip->cont_read.next_page,
+					       0, NULL, 0, false);
+	}
+
+	chip->cont_read.ongoing = 0;
+	chip->cont_read.started = 0;
+}
+
+static bool rawnand_cont_read_ongoing(struct nand_chip *chip,
+				      unsigned int page)
+{
+	if (!chip->cont_read.ongoing)
+		return false;
+
+	if (page < chip->cont_read.first_page ||
+	    page > chip->cont_read.last_page)
+		return false;
+
+	if (!chip->cont_read.started) {
+		if (page == chip->cont_read.first_page)
+			return true;
+	} else if (page == chip->cont_read.next_page) {
+		return true;
+	}
+
+	/*
+	 * The chip outputs pages in order only: fall back to regular page
+	 * reads if a page is skipped or read twice.
+	 */
+	rawnand_cont_read_stop(chip);
+
+	return false;
+}
+
 /**
  * nand_read_page_op - Do a READ PAGE operation
  * @chip: The NAND chip
@@ -1106,10 +1228,17 @@ int nand_read_page_op(struct nand_chip *chip, unsigned int page,
 		return -EINVAL;
 
 	if (nand_has_exec_op(chip)) {
-		if (mtd->writesize > 512)
+		if (mtd->writesize > 512) {
+			if (rawnand_cont_read_ongoing(chip, page))
+				return nand_lp_exec_cont_read_page_op(chip, page,
+								      offset_in_page,
+								      buf, len,
+								      false);
+
 			return nand_lp_exec_read_page_op(chip, page,
 							 offset_in_page, buf,
 							 len);
+		}
 
 		return nand_sp_exec_read_page_op(chip, page, offset_in_page,
 						 buf, len);
@@ -3103,6 +3232,35 @@ static void nand_wait_readrdy(struct nand_chip *chip)
 	WARN_ON(nand_wait_rdy_op(chip, PSEC_TO_MSEC(sdr->tR_max), 0));
 }
 
+/*
+ * Plan a cached read sequence covering the full pages left to read, starting
+ * at @page. Sequences do not cross eraseblock boundaries, the next one is
+ * planned when the current one is over.
+ */
+static void rawnand_enable_cont_reads(struct nand_chip *chip, unsigned int page,
+				      u32 readlen, int col)
+{
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	unsigned int ppb = mtd->erasesize / mtd->writesize;
+	unsigned int last_page;
+
+	if (!chip->cont_read.supported || col)
+		return;
+
+	last_page = page + readlen / mtd->writesize - 1;
+	last_page = min(last_page, round_down(page, ppb) + ppb - 1);
+	if (last_page <= page)
+		return;
+
+	chip->cont_read.first_page = page;
+	chip->cont_read.last_page = last_page;
+	chip->cont_read.started = 0;
+	chip->cont_read.ongoing = 1;
+
+	/* Pages must come from the chip, one after the other */
+	chip->pagecache.page = -1;
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @chip: NAND chip object
@@ -3142,6 +3300,9 @@ static int nand_do_read_ops(struct nand_chip *chip, loff_t from,
 	while (1) {
 		struct mtd_ecc_stats ecc_stats = mtd->ecc_stats;
 
+		if (!chip->cont_read.ongoing)
+			rawnand_enable_cont_reads(chip, page, readlen, col);
+
 		bytes = min(mtd->writesize - col, readlen);
 		aligned = (bytes == mtd->writesize);
 
@@ -3266,6 +3427,10 @@ static int nand_do_read_ops(struct nand_chip *chip, loff_t from,
 			nand_select_target(chip, chipnr);
 		}
 	}
+
+	if (chip->cont_read.ongoing)
+		rawnand_cont_read_stop(chip);
+
 	nand_deselect_target(chip);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -5679,6 +5844,41 @@ static const struct nand_ops rawnand_ops = {
 	.isbad = rawnand_isbad,
 };
 
+/*
+ * Sequential cached reads are only used with the core page accessors, which
+ * read each page once, from its first byte, through nand_read_page_op().
+ */
+static void rawnand_check_cont_read_support(struct nand_chip *chip)
+{
+	struct mtd_info *mtd = nand_to_mtd(chip);
+
+	chip->cont_read.supported = 0;
+
+	if (!chip->parameters.supports_read_cache)
+		return;
+
+	if (!nand_has_exec_op(chip) || mtd->writesize <= 512)
+		return;
+
+	/* Read retries need the same page to be read again */
+	if (chip->read_retries)
+		return;
+
+	if (chip->ecc.read_page_raw != nand_read_page_raw)
+		return;
+
+	if (chip->ecc.read_page != nand_read_page_raw &&
+	    chip->ecc.read_page != nand_read_page_swecc &&
+	    chip->ecc.read_page != nand_read_page_hwecc)
+		return;
+
+	nand_select_target(chip, 0);
+	if (!nand_lp_exec_cont_read_page_op(chip, 0, 0, NULL, mtd->writesize,
+					    true))
+		chip->cont_read.supported = 1;
+	nand_deselect_target(chip);
+}
+
 /**
  * nand_scan_tail - Scan for the NAND device
  * @chip: NAND chip object
@@ -5953,6 +6153,8 @@ static int nand_scan_tail(struct nand_chip *chip)
 			goto err_free_interface_config;
 	}
 
+	rawnand_check_cont_read_support(chip);
+
 	/* Check, if we should skip the bad block table scan */
 	if (chip->options & NAND_SKIP_BBTSCAN)
 		return 0;
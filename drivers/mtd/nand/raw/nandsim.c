@@ -96,6 +96,7 @@ static unsigned int overridesize = 0;
 static char *cache_file = NULL;
 static unsigned int bbt;
 static unsigned int bch;
+static unsigned int read_cache;
 static u_char id_bytes[8] = {
 	[0] = CONFIG_NANDSIM_FIRST_ID_BYTE,
 	[1] = CONFIG_NANDSIM_SECOND_ID_BYTE,
@@ -128,6 +129,7 @@ module_param(overridesize,   uint, 0400);
 module_param(cache_file,     charp, 0400);
 module_param(bbt,	     uint, 0400);
 module_param(bch,	     uint, 0400);
+module_param(read_cache,     uint, 0400);
 
 MODULE_PARM_DESC(id_bytes,       "The ID bytes returned by NAND Flash 'read ID' command");
 MODULE_PARM_DESC(first_id_byte,  "The first byte returned by NAND Flash 'read ID' command (manufacturer ID) (obsolete)");
@@ -163,6 +165,7 @@ MODULE_PARM_DESC(cache_file,     "File to use to cache nand pages instead of mem
 MODULE_PARM_DESC(bbt,		 "0 OOB, 1 BBT with marker in OOB, 2 BBT with marker in data area");
 MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 				 "be correctable in 512-byte blocks");
+MODULE_PARM_DESC(read_cache,     "Support READ CACHE SEQUENTIAL/END commands if not zero");
 
 /* The largest possible page size */
 #define NS_LARGEST_PAGE_SIZE	4096
@@ -209,6 +212,7 @@ MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 #define STATE_CMD_READOOB      0x00000005 /* read OOB area */
 #define STATE_CMD_ERASE1       0x00000006 /* sector erase first command */
 #define STATE_CMD_STATUS       0x00000007 /* read status */
+#define STATE_CMD_READCACHE    0x00000008 /* read cache sequential/end (large page devices) */
 #define STATE_CMD_SEQIN        0x00000009 /* sequential data input */
 #define STATE_CMD_READID       0x0000000A /* read ID */
 #define STATE_CMD_ERASE2       0x0000000B /* sector erase second command */
@@ -248,7 +252,7 @@ MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 #define ACTION_OOBOFF    0x00600000 /* add to address OOB offset */
 #define ACTION_MASK      0x00700000 /* action mask */
 
-#define NS_OPER_NUM      13 /* Number of operations supported by the simulator */
+#define NS_OPER_NUM      14 /* Number of operations supported by the simulator */
 #define NS_OPER_STATES   6  /* Maximum number of states in operation */
 
 #define OPT_ANY          0xFFFFFFFF /* any chip supports this operation */
@@ -332,6 +336,7 @@ struct nandsim {
 		unsigned command; /* the command register */
 		u_char   status;  /* the status register */
 		uint     row;     /* the page number */
+		int      cache_row; /* the page loaded for cache reads, -1 if none */
 		uint     column;  /* the offset within page */
 		uint     count;   /* internal counter */
 		uint     num;     /* number of bytes which must be processed */
@@ -398,6 +403,8 @@ static struct nandsim_operations {
 	/* Large page devices random page read */
 	{OPT_LARGEPAGE, {STATE_CMD_RNDOUT, STATE_ADDR_COLUMN, STATE_CMD_RNDOUTSTART | ACTION_CPY,
 			       STATE_DATAOUT, STATE_READY}},
+	/* Large page devices read cache sequential/end */
+	{OPT_LARGEPAGE, {STATE_CMD_READCACHE | ACTION_CPY, STATE_DATAOUT, STATE_READY}},
 };
 
 struct weak_block {
@@ -1031,6 +1038,8 @@ static char *ns_get_state_name(uint32_t state)
 			return "STATE_CMD_ERASE1";
 		case STATE_CMD_STATUS:
 			return "STATE_CMD_STATUS";
+		case STATE_CMD_READCACHE:
+			return "STATE_CMD_READCACHE";
 		case STATE_CMD_SEQIN:
 			return "STATE_CMD_SEQIN";
 		case STATE_CMD_READID:
@@ -1091,6 +1100,8 @@ static int ns_check_command(int cmd)
 	case NAND_CMD_RESET:
 	case NAND_CMD_RNDOUT:
 	case NAND_CMD_RNDOUTSTART:
+	case NAND_CMD_READCACHESEQ:
+	case NAND_CMD_READCACHEEND:
 		return 0;
 
 	default:
@@ -1130,6 +1141,9 @@ static uint32_t ns_get_state_by_command(unsigned command)
 			return STATE_CMD_RNDOUT;
 		case NAND_CMD_RNDOUTSTART:
 			return STATE_CMD_RNDOUTSTART;
+		case NAND_CMD_READCACHESEQ:
+		case NAND_CMD_READCACHEEND:
+			return STATE_CMD_READCACHE;
 	}
 
 	NS_ERR("get_state_by_command: unknown command, BUG\n");
@@ -1580,6 +1594,28 @@ static int ns_do_state_action(struct nandsim *ns, uint32_t action)
 
 	action &= ACTION_MASK;
 
+	/*
+	 * READ CACHE SEQUENTIAL and READ CACHE END output the page loaded by
+	 * the previous READ PAGE or READ CACHE SEQUENTIAL command, the former
+	 * also starts loading the next page.
+	 */
+	if (action == ACTION_CPY && NS_STATE(ns->state) == STATE_CMD_READCACHE) {
+		if (ns->regs.cache_row < 0) {
+			NS_ERR("do_state_action: no page to read from the cache\n");
+			return -1;
+		}
+
+		ns->regs.row = ns->regs.cache_row;
+		ns->regs.column = 0;
+		ns->regs.off = 0;
+
+		if (ns->regs.command == NAND_CMD_READCACHESEQ &&
+		    ns->regs.row + 1 < ns->geom.pgnum)
+			ns->regs.cache_row++;
+		else
+			ns->regs.cache_row = -1;
+	}
+
 	/* Check that page address input is correct */
 	if (action != ACTION_SECERASE && ns->regs.row >= ns->geom.pgnum) {
 		NS_WARN("do_state_action: wrong page number (%#x)\n", ns->regs.row);
@@ -1604,7 +1640,12 @@ static int ns_do_state_action(struct nandsim *ns, uint32_t action)
 		NS_DBG("do_state_action: (ACTION_CPY:) copy %d bytes to int buf, raw offset %d\n",
 			num, NS_RAW_OFFSET(ns) + ns->regs.off);
 
-		if (ns->regs.off == 0)
+		if (NS_STATE(ns->state) == STATE_CMD_READSTART)
+			ns->regs.cache_row = ns->regs.row;
+
+		if (NS_STATE(ns->state) == STATE_CMD_READCACHE)
+			NS_LOG("read page %d from cache\n", ns->regs.row);
+		else if (ns->regs.off == 0)
 			NS_LOG("read page %d\n", ns->regs.row);
 		else if (ns->regs.off < ns->geom.pgsz)
 			NS_LOG("read page %d (second half)\n", ns->regs.row);
@@ -1953,6 +1994,7 @@ static void ns_nand_write_byte(struct nand_chip *chip, u_char byte)
 
 		if (byte == NAND_CMD_RESET) {
 			NS_LOG("reset chip\n");
+			ns->regs.cache_row = -1;
 			ns_switch_to_ready_state(ns, NS_STATUS_OK(ns));
 			return;
 		}
@@ -1963,6 +2005,19 @@ static void ns_nand_write_byte(struct nand_chip *chip, u_char byte)
 			return;
 		}
 
+		/* Programming and erasing overwrite the page register */
+		if (byte == NAND_CMD_SEQIN || byte == NAND_CMD_ERASE1)
+			ns->regs.cache_row = -1;
+
+		/*
+		 * Cache read commands may be issued while the previous page
+		 * is being output, the rest of it is simply dropped.
+		 */
+		if ((byte == NAND_CMD_READCACHESEQ ||
+		     byte == NAND_CMD_READCACHEEND) &&
+		    NS_STATE(ns->state) == STATE_DATAOUT)
+			ns_switch_to_ready_state(ns, NS_STATUS_OK(ns));
+
 		if (NS_STATE(ns->state) == STATE_DATAOUT_STATUS
 			|| NS_STATE(ns->state) == STATE_DATAOUT) {
 			int row = ns->regs.row;
@@ -2213,6 +2268,10 @@ static int ns_attach_chip(struct nand_chip *chip)
 	chip->ecc.engine_type = NAND_ECC_ENGINE_TYPE_SOFT;
 	chip->ecc.algo = bch ? NAND_ECC_ALGO_BCH : NAND_ECC_ALGO_HAMMING;
 
+	/* There is no parameter page to advertise the optional commands */
+	if (read_cache)
+		chip->parameters.supports_read_cache = true;
+
 	if (!bch)
 		return 0;
 
@@ -2305,6 +2364,7 @@ static int __init ns_init_module(void)
 	else
 		ns->geom.idbytes = 2;
 	ns->regs.status = NS_STATUS_OK(ns);
+	ns->regs.cache_row = -1;
 	ns->nxstate = STATE_UNKNOWN;
 	ns->options |= OPT_PAGE512; /* temporary value */
 	memcpy(ns->ids, id_bytes, sizeof(ns->ids));
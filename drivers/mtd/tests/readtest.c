@@ -26,6 +26,7 @@ MODULE_PARM_DESC(dev, "MTD device number to use");
 static struct mtd_info *mtd;
 static unsigned char *iobuf;
 static unsigned char *iobuf1;
+static unsigned char *iobuf2;
 static unsigned char *bbt;
 
 static int pgsize;
@@ -76,6 +77,43 @@ static int read_eraseblock_by_page(int ebnum)
 	return err;
 }
 
+/*
+ * Read the eraseblock again with a single multi-page read, which NAND drivers
+ * may turn into a sequential cached read, and check it against the data read
+ * one page at a time. An unaligned read checks partial first and last pages.
+ */
+static int read_eraseblock_at_once(int ebnum)
+{
+	loff_t addr = (loff_t)ebnum * mtd->erasesize;
+	size_t offs = pgsize / 2;
+	int err;
+
+	memset(iobuf2, 0, mtd->erasesize);
+	err = mtdtest_read(mtd, addr, mtd->erasesize, iobuf2);
+	if (err)
+		return err;
+	if (memcmp(iobuf, iobuf2, mtd->erasesize)) {
+		pr_err("error: multi-page read mismatch at %#llx\n",
+		       (long long)addr);
+		return -EINVAL;
+	}
+
+	if (pgcnt < 2)
+		return 0;
+
+	memset(iobuf2, 0, mtd->erasesize);
+	err = mtdtest_read(mtd, addr + offs, mtd->erasesize - pgsize, iobuf2);
+	if (err)
+		return err;
+	if (memcmp(iobuf + offs, iobuf2, mtd->erasesize - pgsize)) {
+		pr_err("error: unaligned multi-page read mismatch at %#llx\n",
+		       (long long)addr + offs);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static void dump_eraseblock(int ebnum)
 {
 	int i, j, n;
@@ -157,6 +195,9 @@ static int __init mtd_readtest_init(void)
 	iobuf1 = kmalloc(mtd->erasesize, GFP_KERNEL);
 	if (!iobuf1)
 		goto out;
+	iobuf2 = kmalloc(mtd->erasesize, GFP_KERNEL);
+	if (!iobuf2)
+		goto out;
 
 	bbt = kzalloc(ebcnt, GFP_KERNEL);
 	if (!bbt)
@@ -177,6 +218,10 @@ static int __init mtd_readtest_init(void)
 			dump_eraseblock(i);
 			if (!err)
 				err = ret;
+		} else {
+			ret = read_eraseblock_at_once(i);
+			if (ret && !err)
+				err = ret;
 		}
 
 		ret = mtdtest_relax();
@@ -195,6 +240,7 @@ static int __init mtd_readtest_init(void)
 
 	kfree(iobuf);
 	kfree(iobuf1);
+	kfree(iobuf2);
 	kfree(bbt);
 	put_mtd_device(mtd);
 	if (err)
@@ -16,6 +16,17 @@ struct serport {
 	struct tty_driver *tty_drv;
 	int tty_idx;
 	unsigned long flags;
+
+	/*
+	 * Serializes the deliveries to the client from the flip buffer work
+	 * and from serdev_tty_port_receive_direct(). rx_queued counts the
+	 * bytes the UART driver had to queue to the flip buffer instead, which
+	 * must reach the client before anything is delivered directly again.
+	 * The flip buffer work may consume bytes before the driver accounts
+	 * for them, so it can go below zero for a while.
+	 */
+	struct mutex rx_lock;
+	long rx_queued;
 };
 
 /*
@@ -32,15 +43,19 @@ static int ttyport_receive_buf(struct tty_port *port, const unsigned char *cp,
 	if (!test_bit(SERPORT_ACTIVE, &serport->flags))
 		return 0;
 
+	mutex_lock(&serport->rx_lock);
 	ret = serdev_controller_receive_buf(ctrl, cp, count);
 
 	dev_WARN_ONCE(&ctrl->dev, ret < 0 || ret > count,
 				"receive_buf returns %d (count = %zu)\n",
 				ret, count);
 	if (ret < 0)
-		return 0;
+		ret = 0;
 	else if (ret > count)
-		return count;
+		ret = count;
+
+	serport->rx_queued -= ret;
+	mutex_unlock(&serport->rx_lock);
 
 	return ret;
 }
@@ -138,6 +153,7 @@ static int ttyport_open(struct serdev_controller *ctrl)
 	ktermios.c_cflag |= CLOCAL;
 	tty_set_termios(tty, &ktermios);
 
+	serport->rx_queued = 0;
 	set_bit(SERPORT_ACTIVE, &serport->flags);
 
 	return 0;
@@ -280,6 +296,7 @@ struct device *serdev_tty_port_register(struct tty_port *port,
 	serport->port = port;
 	serport->tty_idx = idx;
 	serport->tty_drv = drv;
+	mutex_init(&serport->rx_lock);
 
 	ctrl->ops = &ctrl_ops;
 
@@ -301,6 +318,98 @@ struct device *serdev_tty_port_register(struct tty_port *port,
 	return ERR_PTR(ret);
 }
 
+/**
+ * serdev_tty_port_owned() - check whether a tty port is used by serdev
+ * @port: tty port
+ *
+ * UART drivers can use this to decide, when the port is opened, whether to
+ * hand received data to serdev_tty_port_receive_direct().
+ */
+bool serdev_tty_port_owned(struct tty_port *port)
+{
+	return port->client_ops == &client_ops;
+}
+EXPORT_SYMBOL_GPL(serdev_tty_port_owned);
+
+/**
+ * serdev_tty_port_receive_direct() - hand received data to a serdev client
+ * @port: tty port
+ * @data: received bytes
+ * @count: number of bytes in @data
+ *
+ * Serdev ports have no line discipline, so the data received by the UART
+ * driver can be given to the serdev client right away, rather than going
+ * through the flip buffer and the workqueue that drains it.
+ *
+ * Nothing is delivered while data the driver queued to the flip buffer, see
+ * serdev_tty_port_rx_queued(), is still pending, so that the client always
+ * sees the data in order. Neither is anything delivered on ports which are
+ * not used by serdev, or while the serdev controller is closed. The driver
+ * keeps what was not delivered, and queues it to the flip buffer in order
+ * with what it receives next.
+ *
+ * Must be called from a context that may sleep, typically the threaded
+ * interrupt handler of the driver, and never concurrently for a port.
+ *
+ * Return: the number of bytes delivered.
+ */
+int serdev_tty_port_receive_direct(struct tty_port *port,
+				   const unsigned char *data, size_t count)
+{
+	struct serdev_controller *ctrl = port->client_data;
+	struct serport *serport;
+	int ret = 0;
+
+	might_sleep();
+
+	if (!serdev_tty_port_owned(port) || !count)
+		return 0;
+
+	serport = serdev_controller_get_drvdata(ctrl);
+
+	mutex_lock(&serport->rx_lock);
+	if (test_bit(SERPORT_ACTIVE, &serport->flags) &&
+	    serport->rx_queued <= 0) {
+		ret = serdev_controller_receive_buf(ctrl, data, count);
+		dev_WARN_ONCE(&ctrl->dev, ret < 0 || ret > count,
+			      "receive_buf returns %d (count = %zu)\n",
+			      ret, count);
+		ret = clamp_t(int, ret, 0, count);
+	}
+	mutex_unlock(&serport->rx_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(serdev_tty_port_receive_direct);
+
+/**
+ * serdev_tty_port_rx_queued() - account for data queued to the flip buffer
+ * @port: tty port
+ * @count: number of bytes queued
+ *
+ * Drivers using serdev_tty_port_receive_direct() call this for the data they
+ * queue to the flip buffer of @port instead, before pushing it, so that no
+ * later data is delivered directly until the client has consumed it. Data the
+ * flip buffer work already consumed in the meantime is accounted for too.
+ *
+ * Must be called from a context that may sleep.
+ */
+void serdev_tty_port_rx_queued(struct tty_port *port, size_t count)
+{
+	struct serdev_controller *ctrl = port->client_data;
+	struct serport *serport;
+
+	if (!serdev_tty_port_owned(port) || !count)
+		return;
+
+	serport = serdev_controller_get_drvdata(ctrl);
+
+	mutex_lock(&serport->rx_lock);
+	serport->rx_queued += count;
+	mutex_unlock(&serport->rx_lock);
+}
+EXPORT_SYMBOL_GPL(serdev_tty_port_rx_queued);
+
 int serdev_tty_port_unregister(struct tty_port *port)
 {
 	struct serdev_controller *ctrl = port->client_data;
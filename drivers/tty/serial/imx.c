@@ -28,6 +28,8 @@
 #include <linux/of_device.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/kfifo.h>
+#include <linux/serdev.h>
 
 #include <asm/irq.h>
 #include <linux/platform_data/dma-imx.h>
@@ -195,6 +197,9 @@ enum imx_tx_state {
 	WAIT_AFTER_SEND,
 };
 
+/* Characters buffered between the RX interrupt and its thread */
+#define RX_DIRECT_FIFO_SIZE	256
+
 struct imx_port {
 	struct uart_port	port;
 	struct timer_list	timer;
@@ -204,6 +209,7 @@ struct imx_port {
 	unsigned int		dte_mode:1;
 	unsigned int		inverted_tx:1;
 	unsigned int		inverted_rx:1;
+	unsigned int		serdev_rx_direct:1;
 	struct clk		*clk_ipg;
 	struct clk		*clk_per;
 	const struct imx_uart_data *devdata;
@@ -235,6 +241,13 @@ struct imx_port {
 	enum imx_tx_state	tx_state;
 	struct hrtimer		trigger_start_tx;
 	struct hrtimer		trigger_stop_tx;
+
+	/* RX path for serdev ports, see imx_uart_rxthread() */
+	bool			rx_direct;
+	bool			rx_overflow;
+	unsigned int		rx_flip_count;
+	struct timer_list	rx_retry_timer;
+	DECLARE_KFIFO(rx_fifo, unsigned char, RX_DIRECT_FIFO_SIZE);
 };
 
 struct imx_port_ucrs {
@@ -841,16 +854,131 @@ static irqreturn_t __imx_uart_rxint(int irq, void *dev_id)
 		if (sport->port.ignore_status_mask & URXD_DUMMY_READ)
 			goto out;
 
-		if (tty_insert_flip_char(port, rx, flg) == 0)
-			sport->port.icount.buf_overrun++;
+		if (!sport->rx_direct) {
+			if (tty_insert_flip_char(port, rx, flg) == 0)
+				sport->port.icount.buf_overrun++;
+		} else if (sport->rx_overflow ||
+			   !kfifo_put(&sport->rx_fifo, (unsigned char)rx)) {
+			/*
+			 * Once the kfifo is full, characters go to the flip
+			 * buffer, pushed by the thread after the kfifo.
+			 */
+			sport->rx_overflow = true;
+			if (tty_insert_flip_char(port, rx, flg))
+				sport->rx_flip_count++;
+			else
+				sport->port.icount.buf_overrun++;
+		}
 	}
 
 out:
+	if (sport->rx_direct)
+		return kfifo_is_empty(&sport->rx_fifo) && !sport->rx_overflow ?
+			IRQ_HANDLED : IRQ_WAKE_THREAD;
+
 	tty_flip_buffer_push(port);
 
 	return IRQ_HANDLED;
 }
 
+/* Push characters queued to the flip buffer by the direct RX path */
+static void imx_uart_rx_push(struct imx_port *sport, unsigned int count)
+{
+	struct tty_port *port = &sport->port.state->port;
+	unsigned long flags;
+
+	serdev_tty_port_rx_queued(port, count);
+
+	spin_lock_irqsave(&sport->port.lock, flags);
+	tty_flip_buffer_push(port);
+	spin_unlock_irqrestore(&sport->port.lock, flags);
+}
+
+/* Queue the characters left in the kfifo to the flip buffer */
+static unsigned int imx_uart_rx_fifo_to_flip(struct imx_port *sport)
+{
+	struct tty_port *port = &sport->port.state->port;
+	unsigned int count = 0;
+	unsigned char c;
+
+	while (kfifo_get(&sport->rx_fifo, &c)) {
+		if (tty_insert_flip_char(port, c, TTY_NORMAL))
+			count++;
+		else
+			sport->port.icount.buf_overrun++;
+	}
+
+	return count;
+}
+
+static void imx_uart_rx_retry(struct timer_list *t)
+{
+	struct imx_port *sport = from_timer(sport, t, rx_retry_timer);
+
+	irq_wake_thread(sport->port.irq, sport);
+}
+
+/*
+ * Serdev ports have no line discipline, so instead of going through the
+ * flip buffer and its work item, the characters read by the interrupt
+ * handler are handed to the serdev client from the interrupt thread.
+ *
+ * What the client doesn't take is queued to the flip buffer, unless the
+ * interrupt handler already queued later characters there because the kfifo
+ * was full: it is then left in the kfifo, and the flip buffer is only pushed
+ * once the kfifo has been drained, so that the client sees everything in
+ * order. The thread is woken up again shortly to retry, rather than waiting
+ * for the next RX interrupt.
+ */
+static irqreturn_t imx_uart_rxthread(int irq, void *dev_id)
+{
+	struct imx_port *sport = dev_id;
+	struct tty_port *port = &sport->port.state->port;
+	unsigned int count, delivered, queued;
+	unsigned char buf[64];
+	unsigned long flags;
+	bool push = false;
+
+	for (;;) {
+		spin_lock_irqsave(&sport->port.lock, flags);
+		count = kfifo_out_peek(&sport->rx_fifo, buf, sizeof(buf));
+		spin_unlock_irqrestore(&sport->port.lock, flags);
+		if (!count)
+			break;
+
+		delivered = serdev_tty_port_receive_direct(port, buf, count);
+
+		queued = 0;
+		spin_lock_irqsave(&sport->port.lock, flags);
+		kfifo_out(&sport->rx_fifo, buf, delivered);
+		if (delivered < count && !sport->rx_overflow)
+			queued = imx_uart_rx_fifo_to_flip(sport);
+		spin_unlock_irqrestore(&sport->port.lock, flags);
+
+		if (delivered < count) {
+			if (queued)
+				imx_uart_rx_push(sport, queued);
+			else if (sport->rx_overflow)
+				mod_timer(&sport->rx_retry_timer, jiffies + 1);
+			break;
+		}
+	}
+
+	spin_lock_irqsave(&sport->port.lock, flags);
+	if (sport->rx_overflow && kfifo_is_empty(&sport->rx_fifo)) {
+		queued = sport->rx_flip_count;
+		sport->rx_flip_count = 0;
+		sport->rx_overflow = false;
+		push = true;
+	}
+	spin_unlock_irqrestore(&sport->port.lock, flags);
+
+	if (push)
+		imx_uart_rx_push(sport, queued);
+
+	return IRQ_HANDLED;
+}
+
 static irqreturn_t imx_uart_rxint(int irq, void *dev_id)
 {
 	struct imx_port *sport = dev_id;
@@ -923,6 +1051,7 @@ static irqreturn_t imx_uart_int(int irq, void *dev_id)
 	unsigned int usr1, usr2, ucr1, ucr2, ucr3, ucr4;
 	irqreturn_t ret = IRQ_NONE;
 	unsigned long flags = 0;
+	bool wake_thread = false;
 
 	/*
 	 * IRQs might not be disabled upon entering this interrupt handler,
@@ -966,7 +1095,8 @@ static irqreturn_t imx_uart_int(int irq, void *dev_id)
 	if (usr1 & (USR1_RRDY | USR1_AGTIM)) {
 		imx_uart_writel(sport, USR1_AGTIM, USR1);
 
-		__imx_uart_rxint(irq, dev_id);
+		if (__imx_uart_rxint(irq, dev_id) == IRQ_WAKE_THREAD)
+			wake_thread = true;
 		ret = IRQ_HANDLED;
 	}
 
@@ -1001,7 +1131,7 @@ static irqreturn_t imx_uart_int(int irq, void *dev_id)
 
 	spin_unlock_irqrestore(&sport->port.lock, flags);
 
-	return ret;
+	return wake_thread ? IRQ_WAKE_THREAD : ret;
 }
 
 /*
@@ -1418,8 +1548,19 @@ static int imx_uart_startup(struct uart_port *port)
 
 	imx_uart_writel(sport, ucr4 & ~UCR4_DREN, UCR4);
 
+	/*
+	 * Serdev clients of ports which opted in get the data from the RX
+	 * interrupt thread, which is only done in PIO mode. Others keep DMA.
+	 */
+	sport->rx_direct = sport->serdev_rx_direct &&
+			   serdev_tty_port_owned(&port->state->port);
+	sport->rx_overflow = false;
+	sport->rx_flip_count = 0;
+	kfifo_reset(&sport->rx_fifo);
+
 	/* Can we enable the DMA support? */
-	if (!uart_console(port) && imx_uart_dma_init(sport) == 0)
+	if (!uart_console(port) && !sport->rx_direct &&
+	    imx_uart_dma_init(sport) == 0)
 		dma_is_inited = 1;
 
 	spin_lock_irqsave(&sport->port.lock, flags);
@@ -1544,6 +1685,7 @@ static void imx_uart_shutdown(struct uart_port *port)
 	 * Stop our timer.
 	 */
 	del_timer_sync(&sport->timer);
+	del_timer_sync(&sport->rx_retry_timer);
 
 	/*
 	 * Disable all interrupts, port and break condition.
@@ -2228,6 +2370,9 @@ static int imx_uart_probe(struct platform_device *pdev)
 	if (of_get_property(np, "fsl,inverted-rx", NULL))
 		sport->inverted_rx = 1;
 
+	if (of_get_property(np, "fsl,serdev-direct-rx", NULL))
+		sport->serdev_rx_direct = 1;
+
 	if (sport->port.line >= ARRAY_SIZE(imx_uart_ports)) {
 		dev_err(&pdev->dev, "serial%d out of range\n",
 			sport->port.line);
@@ -2257,6 +2402,7 @@ static int imx_uart_probe(struct platform_device *pdev)
 	sport->port.rs485_config = imx_uart_rs485_config;
 	sport->port.flags = UPF_BOOT_AUTOCONF;
 	timer_setup(&sport->timer, imx_uart_timeout, 0);
+	timer_setup(&sport->rx_retry_timer, imx_uart_rx_retry, 0);
 
 	sport->gpios = mctrl_gpio_init(&sport->port, 0);
 	if (IS_ERR(sport->gpios))
@@ -2354,6 +2500,8 @@ static int imx_uart_probe(struct platform_device *pdev)
 
 	clk_disable_unprepare(sport->clk_ipg);
 
+	INIT_KFIFO(sport->rx_fifo);
+
 	hrtimer_init(&sport->trigger_start_tx, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	hrtimer_init(&sport->trigger_stop_tx, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	sport->trigger_start_tx.function = imx_trigger_start_tx;
@@ -2364,8 +2512,10 @@ static int imx_uart_probe(struct platform_device *pdev)
 	 * chips only have one interrupt.
 	 */
 	if (txirq > 0) {
-		ret = devm_request_irq(&pdev->dev, rxirq, imx_uart_rxint, 0,
-				       dev_name(&pdev->dev), sport);
+		ret = devm_request_threaded_irq(&pdev->dev, rxirq,
+						imx_uart_rxint,
+						imx_uart_rxthread, 0,
+						dev_name(&pdev->dev), sport);
 		if (ret) {
 			dev_err(&pdev->dev, "failed to request rx irq: %d\n",
 				ret);
@@ -2388,8 +2538,10 @@ static int imx_uart_probe(struct platform_device *pdev)
 			return ret;
 		}
 	} else {
-		ret = devm_request_irq(&pdev->dev, rxirq, imx_uart_int, 0,
-				       dev_name(&pdev->dev), sport);
+		ret = devm_request_threaded_irq(&pdev->dev, rxirq,
+						imx_uart_int,
+						imx_uart_rxthread, 0,
+						dev_name(&pdev->dev), sport);
 		if (ret) {
 			dev_err(&pdev->dev, "failed to request irq: %d\n", ret);
 			return ret;
@@ -154,6 +154,8 @@ static void console_callback(struct work_struct *ignored);
 static void con_driver_unregister_callback(struct work_struct *ignored);
 static void blank_screen_t(struct timer_list *unused);
 static void set_palette(struct vc_data *vc);
+static void vt_render_flush(struct work_struct *work);
+static bool con_flush_dirty(struct vc_data *vc);
 
 #define vt_get_kmsg_redirect() vt_kmsg_redirect(-1)
 
@@ -166,6 +168,17 @@ module_param(global_cursor_default, int, S_IRUGO | S_IWUSR);
 static int cur_default = CUR_UNDERLINE;
 module_param(cur_default, int, S_IRUGO | S_IWUSR);
 
+/*
+ * render_delay_ms: when non-zero, output to the foreground console only
+ * updates the screen buffer, and the rows it changed are drawn at most once
+ * per render_delay_ms. This saves a lot of redrawing on slow displays, e.g.
+ * when scrolling through boot messages.
+ */
+static unsigned int render_delay_ms;
+module_param(render_delay_ms, uint, S_IRUGO | S_IWUSR);
+
+static DECLARE_DELAYED_WORK(vt_render_work, vt_render_flush);
+
 /*
  * ignore_poke: don't unblank the screen when things are typed.  This is
  * mainly for the privacy of braille terminal users.
@@ -280,7 +293,80 @@ static inline bool con_is_fg(const struct vc_data *vc)
 
 static inline bool con_should_update(const struct vc_data *vc)
 {
-	return con_is_visible(vc) && !console_blanked;
+	return con_is_visible(vc) && !console_blanked && !vc->vc_deferred;
+}
+
+/* Mark rows [top, bottom) to be drawn by the next flush */
+static void con_defer_rows(struct vc_data *vc, unsigned int top,
+		unsigned int bottom)
+{
+	if (!vc->vc_deferred)
+		return;
+
+	if (vc->vc_dirty_top >= vc->vc_dirty_bottom) {
+		vc->vc_dirty_top = top;
+		vc->vc_dirty_bottom = bottom;
+		return;
+	}
+
+	vc->vc_dirty_top = min(vc->vc_dirty_top, top);
+	vc->vc_dirty_bottom = max(vc->vc_dirty_bottom, bottom);
+}
+
+static void con_defer_region(struct vc_data *vc, unsigned long start,
+		int count)
+{
+	unsigned long offset;
+
+	if (!vc->vc_deferred || count <= 0)
+		return;
+
+	/* Anything outside of the screen is redrawn in full */
+	if (start < vc->vc_origin || start >= vc->vc_scr_end) {
+		con_defer_rows(vc, 0, vc->vc_rows);
+		return;
+	}
+
+	offset = start - vc->vc_origin;
+	con_defer_rows(vc, offset / vc->vc_size_row,
+			(offset + 2 * count - 1) / vc->vc_size_row + 1);
+}
+
+/*
+ * Start deferring the drawing of output to @vc, if enabled. Consoles whose
+ * screen buffer is the video memory itself have nothing to gain from it.
+ * Neither are oops messages ever deferred: the rows still waiting for the
+ * flush are drawn right away, as it may never run.
+ */
+static void con_defer_begin(struct vc_data *vc)
+{
+	if (oops_in_progress) {
+		con_flush_dirty(vc);
+		return;
+	}
+
+	if (!render_delay_ms || !con_should_update(vc) ||
+	    vc->vc_mode != KD_TEXT ||
+	    vc->vc_origin != (unsigned long)vc->vc_screenbuf)
+		return;
+
+	vc->vc_deferred = 1;
+}
+
+/*
+ * Stop deferring the drawing of output to @vc, and schedule the flush if
+ * there is anything to draw. A flush already pending is not pushed back, so
+ * that the screen is drawn at least every render_delay_ms during bursts.
+ */
+static void con_defer_end(struct vc_data *vc)
+{
+	if (!vc->vc_deferred)
+		return;
+
+	vc->vc_deferred = 0;
+	if (vc->vc_dirty_top < vc->vc_dirty_bottom)
+		schedule_delayed_work(&vt_render_work,
+				msecs_to_jiffies(READ_ONCE(render_delay_ms)));
 }
 
 static inline unsigned short *screenpos(const struct vc_data *vc, int offset,
@@ -627,7 +713,13 @@ static void con_scroll(struct vc_data *vc, unsigned int t, unsigned int b,
 	if (b > vc->vc_rows || t >= b || nr < 1)
 		return;
 	vc_uniscr_scroll(vc, t, b, dir, nr);
-	if (con_is_visible(vc) && vc->vc_sw->con_scroll(vc, t, b, dir, nr))
+	/*
+	 * Deferred scrolls are applied to the screen buffer only, so that
+	 * consecutive scrolls of a region end up drawing it once.
+	 */
+	con_defer_rows(vc, t, b);
+	if (con_is_visible(vc) && !vc->vc_deferred &&
+	    vc->vc_sw->con_scroll(vc, t, b, dir, nr))
 		return;
 
 	s = clear = (u16 *)(vc->vc_origin + vc->vc_size_row * t);
@@ -798,6 +890,8 @@ void invert_screen(struct vc_data *vc, int offset, int count, bool viewed)
 
 	if (con_should_update(vc))
 		do_update_region(vc, (unsigned long) p, count);
+	else
+		con_defer_region(vc, (unsigned long) p, count);
 	notify_update(vc);
 }
 
@@ -848,6 +942,8 @@ static void insert_char(struct vc_data *vc, unsigned int nr)
 	if (con_should_update(vc))
 		do_update_region(vc, (unsigned long) p,
 			vc->vc_cols - vc->state.x);
+	else
+		con_defer_rows(vc, vc->state.y, vc->state.y + 1);
 }
 
 static void delete_char(struct vc_data *vc, unsigned int nr)
@@ -862,6 +958,8 @@ static void delete_char(struct vc_data *vc, unsigned int nr)
 	if (con_should_update(vc))
 		do_update_region(vc, (unsigned long) p,
 			vc->vc_cols - vc->state.x);
+	else
+		con_defer_rows(vc, vc->state.y, vc->state.y + 1);
 }
 
 static int softcursor_original = -1;
@@ -1033,6 +1131,7 @@ void redraw_screen(struct vc_data *vc, int is_switch)
 
 		if (update && vc->vc_mode != KD_GRAPHICS)
 			do_update_region(vc, vc->vc_origin, vc->vc_screenbuf_size / 2);
+		vc->vc_dirty_top = vc->vc_dirty_bottom = 0;
 	}
 	set_cursor(vc);
 	if (is_switch) {
@@ -1566,6 +1665,8 @@ static void csi_J(struct vc_data *vc, int vpar)
 	scr_memsetw(start, vc->vc_video_erase_char, 2 * count);
 	if (con_should_update(vc))
 		do_update_region(vc, (unsigned long) start, count);
+	else
+		con_defer_region(vc, (unsigned long) start, count);
 	vc->vc_need_wrap = 0;
 }
 
@@ -1596,6 +1697,8 @@ static void csi_K(struct vc_data *vc, int vpar)
 	vc->vc_need_wrap = 0;
 	if (con_should_update(vc))
 		do_update_region(vc, (unsigned long)(start + offset), count);
+	else
+		con_defer_rows(vc, vc->state.y, vc->state.y + 1);
 }
 
 /* erase the following vpar positions */
@@ -1612,6 +1715,8 @@ static void csi_X(struct vc_data *vc, unsigned int vpar)
 	scr_memsetw((unsigned short *)vc->vc_pos, vc->vc_video_erase_char, 2 * count);
 	if (con_should_update(vc))
 		vc->vc_sw->con_clear(vc, vc->state.y, vc->state.x, 1, count);
+	else
+		con_defer_rows(vc, vc->state.y, vc->state.y + 1);
 	vc->vc_need_wrap = 0;
 }
 
@@ -2821,9 +2926,13 @@ static int vc_con_write_normal(struct vc_data *vc, int tc, int c,
 
 		scr_writew(tc, (u16 *)vc->vc_pos);
 
-		if (con_should_update(vc) && draw->x < 0) {
-			draw->x = vc->state.x;
-			draw->from = vc->vc_pos;
+		if (con_should_update(vc)) {
+			if (draw->x < 0) {
+				draw->x = vc->state.x;
+				draw->from = vc->vc_pos;
+			}
+		} else {
+			con_defer_rows(vc, vc->state.y, vc->state.y + 1);
 		}
 		if (vc->state.x == vc->vc_cols - 1) {
 			vc->vc_need_wrap = vc->vc_decawm;
@@ -2886,6 +2995,8 @@ static int do_con_write(struct tty_struct *tty, const unsigned char *buf, int co
 	if (con_is_fg(vc))
 		hide_cursor(vc);
 
+	con_defer_begin(vc);
+
 	param.vc = vc;
 
 	while (!tty->stopped && count) {
@@ -2919,6 +3030,7 @@ static int do_con_write(struct tty_struct *tty, const unsigned char *buf, int co
 			goto rescan_last_byte;
 	}
 	con_flush(vc, &draw);
+	con_defer_end(vc);
 	vc_uniscr_debug_check(vc);
 	console_conditional_schedule();
 	notify_update(vc);
@@ -2970,6 +3082,58 @@ static void console_callback(struct work_struct *ignored)
 	console_unlock();
 }
 
+/*
+ * Draw the rows of @vc left dirty by deferred output, see con_defer_begin().
+ * The caller holds the console lock and takes care of the cursor.
+ *
+ * Returns true if anything was drawn.
+ */
+static bool con_flush_dirty(struct vc_data *vc)
+{
+	unsigned int top, bottom;
+
+	if (vc->vc_dirty_top >= vc->vc_dirty_bottom)
+		return false;
+
+	top = vc->vc_dirty_top;
+	bottom = min(vc->vc_dirty_bottom, vc->vc_rows);
+	vc->vc_dirty_top = vc->vc_dirty_bottom = 0;
+
+	if (!con_should_update(vc) || vc->vc_mode != KD_TEXT || top >= bottom)
+		return false;
+
+	do_update_region(vc, vc->vc_origin + top * vc->vc_size_row,
+			 (bottom - top) * vc->vc_cols);
+	return true;
+}
+
+/*
+ * Flush the deferred output of all consoles, as the flush is shared by all
+ * of them.
+ */
+static void vt_render_flush(struct work_struct *work)
+{
+	struct vc_data *vc;
+	bool drawable;
+	int i;
+
+	console_lock();
+	for (i = 0; i < MAX_NR_CONSOLES; i++) {
+		vc = vc_cons[i].d;
+		if (!vc || vc->vc_dirty_top >= vc->vc_dirty_bottom)
+			continue;
+
+		drawable = con_should_update(vc) && vc->vc_mode == KD_TEXT;
+		if (drawable)
+			hide_cursor(vc);
+		if (con_flush_dirty(vc))
+			notify_update(vc);
+		if (drawable)
+			set_cursor(vc);
+	}
+	console_unlock();
+}
+
 int set_console(int nr)
 {
 	struct vc_data *vc = vc_cons[fg_console].d;
@@ -3035,6 +3199,18 @@ int vt_kmsg_redirect(int new)
  * The console must be locked when we get here.
  */
 
+static void vt_console_putcs(struct vc_data *vc, const ushort *start,
+		ushort cnt, ushort start_x)
+{
+	if (!con_is_visible(vc))
+		return;
+
+	if (vc->vc_deferred)
+		con_defer_rows(vc, vc->state.y, vc->state.y + 1);
+	else
+		vc->vc_sw->con_putcs(vc, start, cnt, vc->state.y, start_x);
+}
+
 static void vt_console_print(struct console *co, const char *b, unsigned count)
 {
 	struct vc_data *vc = vc_cons[fg_console].d;
@@ -3067,14 +3243,16 @@ static void vt_console_print(struct console *co, const char *b, unsigned count)
 	if (con_is_fg(vc))
 		hide_cursor(vc);
 
+	con_defer_begin(vc);
+
 	start = (ushort *)vc->vc_pos;
 	start_x = vc->state.x;
 	cnt = 0;
 	while (count--) {
 		c = *b++;
 		if (c == 10 || c == 13 || c == 8 || vc->vc_need_wrap) {
-			if (cnt && con_is_visible(vc))
-				vc->vc_sw->con_putcs(vc, start, cnt, vc->state.y, start_x);
+			if (cnt)
+				vt_console_putcs(vc, start, cnt, start_x);
 			cnt = 0;
 			if (c == 8) {		/* backspace */
 				bs(vc);
@@ -3101,8 +3279,9 @@ static void vt_console_print(struct console *co, const char *b, unsigned count)
 			vc->state.x++;
 		}
 	}
-	if (cnt && con_is_visible(vc))
-		vc->vc_sw->con_putcs(vc, start, cnt, vc->state.y, start_x);
+	if (cnt)
+		vt_console_putcs(vc, start, cnt, start_x);
+	con_defer_end(vc);
 	set_cursor(vc);
 	notify_update(vc);
 
@@ -185,14 +185,17 @@ void vhost_work_init(struct vhost_work *work, vhost_work_fn_t fn)
 }
 EXPORT_SYMBOL_GPL(vhost_work_init);
 
-/* Init poll structure */
+/* Init poll structure.  The work is run by the worker of @vq if there is
+ * one, by the default worker of @dev otherwise. */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
@@ -231,54 +234,120 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+static void vhost_worker_queue(struct vhost_worker *worker,
+			       struct vhost_work *work)
+{
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_worker_flush(struct vhost_worker *worker)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
-		init_completion(&flush.wait_event);
-		vhost_work_init(&flush.work, vhost_flush_work);
+	init_completion(&flush.wait_event);
+	vhost_work_init(&flush.work, vhost_flush_work);
+
+	vhost_worker_queue(worker, &flush.work);
+	wait_for_completion(&flush.wait_event);
+}
+
+/* Workers are only added, under the device mutex, until the owner goes away,
+ * so they can be walked without locking. */
+static struct vhost_worker *vhost_dev_worker(struct vhost_dev *dev, int i)
+{
+	return dev->workers ? READ_ONCE(dev->workers[i]) : NULL;
+}
+
+/* Work may have been queued on any of the workers of the device. */
+void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+{
+	struct vhost_worker *worker;
+	int i;
 
-		vhost_work_queue(dev, &flush.work);
-		wait_for_completion(&flush.wait_event);
+	for (i = 0; i < dev->nvqs; i++) {
+		worker = vhost_dev_worker(dev, i);
+		if (worker)
+			vhost_worker_flush(worker);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_work_flush);
 
+static struct vhost_worker *vhost_poll_worker(struct vhost_poll *poll)
+{
+	return poll->vq ? READ_ONCE(poll->vq->worker) : poll->dev->worker;
+}
+
 /* Flush any work that has been scheduled. When calling this, don't hold any
  * locks that are also used by the callback. */
 void vhost_poll_flush(struct vhost_poll *poll)
 {
-	vhost_work_flush(poll->dev, &poll->work);
+	struct vhost_worker *worker = vhost_poll_worker(poll);
+
+	if (worker)
+		vhost_worker_flush(worker);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_flush);
 
+/* Queue work on the default worker of the device */
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
 	if (!dev->worker)
 		return;
 
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	vhost_worker_queue(dev->worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
+/* Queue work on the worker processing the virtqueue */
+void vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	if (!worker)
+		return;
+
+	vhost_worker_queue(worker, work);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_work_queue);
+
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	struct vhost_worker *worker;
+	int i;
+
+	for (i = 0; i < dev->nvqs; i++) {
+		worker = vhost_dev_worker(dev, i);
+		if (worker && !llist_empty(&worker->work_list))
+			return true;
+	}
+
+	return false;
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
+/* Same as vhost_has_work(), for the worker of the virtqueue only */
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker = READ_ONCE(vq->worker);
+
+	return worker && !llist_empty(&worker->work_list);
+}
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
+
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	struct vhost_worker *worker = vhost_poll_worker(poll);
+
+	if (worker)
+		vhost_worker_queue(worker, &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -339,13 +408,16 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 	vq->iotlb = NULL;
 	vhost_vring_call_reset(&vq->call_ctx);
 	__vhost_vq_meta_reset(vq);
+	vq->worker = NULL;
 }
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
+	u64 start;
 
 	kthread_use_mm(dev->mm);
 
@@ -358,10 +430,13 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
-		if (!node)
+		node = llist_del_all(&worker->work_list);
+		if (!node) {
 			schedule();
+			continue;
+		}
 
+		WRITE_ONCE(worker->wakeups, worker->wakeups + 1);
 		node = llist_reverse_order(node);
 		/* make sure flag is seen after deletion */
 		smp_wmb();
@@ -369,7 +444,11 @@ static int vhost_worker(void *data)
 			clear_bit(VHOST_WORK_QUEUED, &work->flags);
 			__set_current_state(TASK_RUNNING);
 			kcov_remote_start_common(dev->kcov_handle);
+			start = ktime_get_ns();
 			work->fn(work);
+			WRITE_ONCE(worker->busy_ns,
+				   worker->busy_ns + ktime_get_ns() - start);
+			WRITE_ONCE(worker->works, worker->works + 1);
 			kcov_remote_stop();
 			if (need_resched())
 				schedule();
@@ -482,12 +561,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->iotlb = NULL;
 	dev->mm = NULL;
 	dev->worker = NULL;
+	dev->workers = NULL;
 	dev->iov_limit = iov_limit;
 	dev->weight = weight;
 	dev->byte_weight = byte_weight;
 	dev->use_worker = use_worker;
 	dev->msg_handler = msg_handler;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -504,7 +583,7 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -531,14 +610,14 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 	s->ret = cgroup_attach_task_all(s->owner, current);
 }
 
-static int vhost_attach_cgroups(struct vhost_dev *dev)
+static int vhost_attach_cgroups(struct vhost_worker *worker)
 {
 	struct vhost_attach_cgroups_struct attach;
 
 	attach.owner = current;
 	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_work_flush(dev, &attach.work);
+	vhost_worker_queue(worker, &attach.work);
+	vhost_worker_flush(worker);
 	return attach.ret;
 }
 
@@ -579,11 +658,80 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 	dev->mm = NULL;
 }
 
+/* Caller should have device mutex */
+static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	int id, err;
+
+	for (id = 0; id < dev->nvqs; id++)
+		if (!dev->workers[id])
+			break;
+	if (id == dev->nvqs)
+		return ERR_PTR(-ENOSPC);
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return ERR_PTR(-ENOMEM);
+
+	worker->dev = dev;
+	worker->id = id;
+	init_llist_head(&worker->work_list);
+
+	if (id)
+		task = kthread_create(vhost_worker, worker, "vhost-%d-%d",
+				      current->pid, id);
+	else
+		task = kthread_create(vhost_worker, worker, "vhost-%d",
+				      current->pid);
+	if (IS_ERR(task)) {
+		err = PTR_ERR(task);
+		goto err_free;
+	}
+
+	worker->task = task;
+	wake_up_process(task); /* avoid contributing to loadavg */
+
+	err = vhost_attach_cgroups(worker);
+	if (err)
+		goto err_stop;
+
+	WRITE_ONCE(dev->workers[id], worker);
+	return worker;
+
+err_stop:
+	kthread_stop(task);
+err_free:
+	kfree(worker);
+	return ERR_PTR(err);
+}
+
+static void vhost_workers_free(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	int i;
+
+	for (i = 0; i < dev->nvqs; i++) {
+		worker = dev->workers[i];
+		if (!worker)
+			continue;
+
+		WARN_ON(!llist_empty(&worker->work_list));
+		kthread_stop(worker->task);
+		kfree(worker);
+	}
+
+	kfree(dev->workers);
+	dev->workers = NULL;
+	dev->worker = NULL;
+}
+
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
-	int err;
+	struct vhost_worker *worker;
+	int i, err;
 
 	/* Is there an owner already? */
 	if (vhost_dev_has_owner(dev)) {
@@ -595,19 +743,23 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	dev->kcov_handle = kcov_common_handle();
 	if (dev->use_worker) {
-		worker = kthread_create(vhost_worker, dev,
-					"vhost-%d", current->pid);
+		dev->workers = kcalloc(dev->nvqs, sizeof(*dev->workers),
+				       GFP_KERNEL_ACCOUNT);
+		if (!dev->workers) {
+			err = -ENOMEM;
+			goto err_worker;
+		}
+
+		worker = vhost_worker_create(dev);
 		if (IS_ERR(worker)) {
 			err = PTR_ERR(worker);
-			goto err_worker;
+			goto err_cgroup;
 		}
 
 		dev->worker = worker;
-		wake_up_process(worker); /* avoid contributing to loadavg */
-
-		err = vhost_attach_cgroups(dev);
-		if (err)
-			goto err_cgroup;
+		for (i = 0; i < dev->nvqs; i++)
+			dev->vqs[i]->worker = worker;
+		worker->attachment_cnt = dev->nvqs;
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
@@ -616,9 +768,10 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	return 0;
 err_cgroup:
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+	if (dev->workers) {
+		for (i = 0; i < dev->nvqs; i++)
+			dev->vqs[i]->worker = NULL;
+		vhost_workers_free(dev);
 	}
 err_worker:
 	vhost_detach_mm(dev);
@@ -712,10 +865,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+	if (dev->workers) {
+		vhost_workers_free(dev);
 		dev->kcov_handle = 0;
 	}
 	vhost_detach_mm(dev);
@@ -1574,6 +1725,114 @@ static long vhost_vring_set_num_addr(struct vhost_dev *d,
 
 	return r;
 }
+static struct vhost_worker *vhost_find_worker(struct vhost_dev *d, u32 id)
+{
+	if (!d->workers || id >= d->nvqs)
+		return NULL;
+
+	return d->workers[array_index_nospec(id, d->nvqs)];
+}
+
+/* Caller must have device and virtqueue mutex */
+static long vhost_vq_attach_worker(struct vhost_virtqueue *vq, u32 id)
+{
+	struct vhost_worker *worker = vhost_find_worker(vq->dev, id);
+
+	if (!worker)
+		return -ENODEV;
+
+	/* Work already queued on the old worker may still run there, which
+	 * is harmless as long as no backend is processing the ring. */
+	if (vq->private_data)
+		return -EBUSY;
+
+	vq->worker->attachment_cnt--;
+	worker->attachment_cnt++;
+	WRITE_ONCE(vq->worker, worker);
+	return 0;
+}
+
+static long vhost_new_worker(struct vhost_dev *d, void __user *argp)
+{
+	struct vhost_worker_state state;
+	struct vhost_worker *worker;
+
+	if (!d->workers)
+		return -EINVAL;
+
+	worker = vhost_worker_create(d);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	state.worker_id = worker->id;
+	if (copy_to_user(argp, &state, sizeof(state)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static long vhost_set_worker_affinity(struct vhost_dev *d,
+				      void __user *argp)
+{
+	struct vhost_worker_affinity a;
+	struct vhost_worker *worker;
+	cpumask_var_t mask;
+	long r;
+
+	if (copy_from_user(&a, argp, sizeof(a)))
+		return -EFAULT;
+
+	worker = vhost_find_worker(d, a.worker_id);
+	if (!worker)
+		return -ENODEV;
+
+	if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (copy_from_user(cpumask_bits(mask), u64_to_user_ptr(a.cpumask),
+			   min_t(unsigned int, a.cpumask_size,
+				 cpumask_size()))) {
+		r = -EFAULT;
+		goto out;
+	}
+
+	/* Don't let the owner escape its own restrictions through us */
+	cpumask_and(mask, mask, current->cpus_ptr);
+	if (cpumask_empty(mask)) {
+		r = -EINVAL;
+		goto out;
+	}
+
+	r = set_cpus_allowed_ptr(worker->task, mask);
+out:
+	free_cpumask_var(mask);
+	return r;
+}
+
+static long vhost_get_worker_stats(struct vhost_dev *d, void __user *argp)
+{
+	struct vhost_worker_stats st = {};
+	struct vhost_worker *worker;
+
+	if (get_user(st.worker_id, (u32 __user *)argp))
+		return -EFAULT;
+
+	worker = vhost_find_worker(d, st.worker_id);
+	if (!worker)
+		return -ENODEV;
+
+	st.pid = task_pid_vnr(worker->task);
+	st.nr_vrings = worker->attachment_cnt;
+	st.busy_ns = READ_ONCE(worker->busy_ns);
+	st.works = READ_ONCE(worker->works);
+	st.wakeups = READ_ONCE(worker->wakeups);
+
+	if (copy_to_user(argp, &st, sizeof(st)))
+		return -EFAULT;
+
+	return 0;
+}
+
 long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 {
 	struct file *eventfp, *filep = NULL;
@@ -1583,6 +1842,7 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 	struct vhost_virtqueue *vq;
 	struct vhost_vring_state s;
 	struct vhost_vring_file f;
+	struct vhost_vring_worker w;
 	u32 idx;
 	long r;
 
@@ -1688,6 +1948,23 @@ long vhost_vring_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *arg
 		if (copy_to_user(argp, &s, sizeof(s)))
 			r = -EFAULT;
 		break;
+	case VHOST_ATTACH_VRING_WORKER:
+		if (copy_from_user(&w, argp, sizeof(w))) {
+			r = -EFAULT;
+			break;
+		}
+		r = vhost_vq_attach_worker(vq, w.worker_id);
+		break;
+	case VHOST_GET_VRING_WORKER:
+		if (!vq->worker) {
+			r = -EINVAL;
+			break;
+		}
+		w.index = idx;
+		w.worker_id = vq->worker->id;
+		if (copy_to_user(argp, &w, sizeof(w)))
+			r = -EFAULT;
+		break;
 	default:
 		r = -ENOIOCTLCMD;
 	}
@@ -1801,6 +2078,15 @@ long vhost_dev_ioctl(struct vhost_dev *d, unsigned int ioctl, void __user *argp)
 		if (ctx)
 			eventfd_ctx_put(ctx);
 		break;
+	case VHOST_NEW_WORKER:
+		r = vhost_new_worker(d, argp);
+		break;
+	case VHOST_SET_WORKER_AFFINITY:
+		r = vhost_set_worker_affinity(d, argp);
+		break;
+	case VHOST_GET_WORKER_STATS:
+		r = vhost_get_worker_stats(d, argp);
+		break;
 	default:
 		r = -ENOIOCTLCMD;
 		break;
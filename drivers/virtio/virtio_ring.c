@@ -68,6 +68,7 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 in_len;			/* Device-writable length. */
 };
 
 struct vring_desc_state_packed {
@@ -105,6 +106,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Host uses buffers in the order they were made available */
+	bool in_order;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -131,6 +135,16 @@ struct vring_virtqueue {
 			/* Per-descriptor state. */
 			struct vring_desc_state_split *desc_state;
 
+			/*
+			 * In order: head of the next buffer the device will
+			 * use, and the last buffer of the batch of used
+			 * buffers being returned, if any.
+			 */
+			u16 next_head;
+			u16 batch_last;
+			bool batch_pending;
+			u32 batch_len;
+
 			/* DMA address and size information */
 			dma_addr_t queue_dma_addr;
 			size_t queue_size_in_bytes;
@@ -425,6 +439,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 in_len = 0;
 	int head;
 	bool indirect;
 
@@ -500,6 +515,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 			desc[i].flags = cpu_to_virtio16(_vq->vdev, VRING_DESC_F_NEXT | VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_virtio64(_vq->vdev, addr);
 			desc[i].len = cpu_to_virtio32(_vq->vdev, sg->length);
+			in_len += sg->length;
 			prev = i;
 			i = virtio16_to_cpu(_vq->vdev, desc[i].next);
 		}
@@ -536,6 +552,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* Store token and indirect buffer state. */
 	vq->split.desc_state[head].data = data;
+	vq->split.desc_state[head].in_len = in_len;
 	if (indirect)
 		vq->split.desc_state[head].indir_desc = desc;
 	else
@@ -636,9 +653,17 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	}
 
 	vring_unmap_one_split(vq, &vq->split.vring.desc[i]);
-	vq->split.vring.desc[i].next = cpu_to_virtio16(vq->vq.vdev,
-						vq->free_head);
-	vq->free_head = head;
+	if (vq->in_order) {
+		/*
+		 * Descriptors are made available and used in ring order, so
+		 * the free list stays the ring itself.
+		 */
+		vq->split.next_head = (i + 1) & (vq->split.vring.num - 1);
+	} else {
+		vq->split.vring.desc[i].next = cpu_to_virtio16(vq->vq.vdev,
+							vq->free_head);
+		vq->free_head = head;
+	}
 
 	/* Plus final descriptor */
 	vq->vq.num_free++;
@@ -691,28 +716,57 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 		return NULL;
 	}
 
-	if (!more_used_split(vq)) {
+	if (!vq->split.batch_pending && !more_used_split(vq)) {
 		pr_debug("No more buffers in queue\n");
 		END_USE(vq);
 		return NULL;
 	}
 
-	/* Only get used array entries after they have been exposed by host. */
-	virtio_rmb(vq->weak_barriers);
+	if (!vq->split.batch_pending) {
+		/* Only get used array entries after they have been exposed by host. */
+		virtio_rmb(vq->weak_barriers);
 
-	last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
-	i = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].id);
-	*len = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].len);
+		last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		*len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
 
-	if (unlikely(i >= vq->split.vring.num)) {
-		BAD_RING(vq, "id %u out of range\n", i);
-		return NULL;
+		if (unlikely(i >= vq->split.vring.num)) {
+			BAD_RING(vq, "id %u out of range\n", i);
+			return NULL;
+		}
+		if (unlikely(!vq->split.desc_state[i].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", i);
+			return NULL;
+		}
+
+		/*
+		 * In order, a single used entry can stand for all the buffers
+		 * up to the one it names: return those without reading the
+		 * used ring again.
+		 */
+		if (vq->in_order && i != vq->split.next_head) {
+			vq->split.batch_last = i;
+			vq->split.batch_len = *len;
+			vq->split.batch_pending = true;
+		}
 	}
-	if (unlikely(!vq->split.desc_state[i].data)) {
-		BAD_RING(vq, "id %u is not a head!\n", i);
-		return NULL;
+
+	if (vq->split.batch_pending) {
+		i = vq->split.next_head;
+		if (unlikely(!vq->split.desc_state[i].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", i);
+			return NULL;
+		}
+
+		if (i == vq->split.batch_last) {
+			*len = vq->split.batch_len;
+			vq->split.batch_pending = false;
+		} else {
+			/* The device doesn't report the length of those */
+			*len = vq->split.desc_state[i].in_len;
+		}
 	}
 
 	/* detach_buf_split clears data, so grab it now. */
@@ -829,6 +883,9 @@ static void *virtqueue_detach_unused_buf_split(struct virtqueue *_vq)
 		/* detach_buf_split clears data, so grab it now. */
 		buf = vq->split.desc_state[i].data;
 		detach_buf_split(vq, i, NULL);
+		/* Once all is detached, the ring restarts at the free head. */
+		vq->split.next_head = vq->free_head;
+		vq->split.batch_pending = false;
 		vq->split.avail_idx_shadow--;
 		vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
 				vq->split.avail_idx_shadow);
@@ -2093,6 +2150,7 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2103,6 +2161,8 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->split.vring = vring;
 	vq->split.avail_flags_shadow = 0;
 	vq->split.avail_idx_shadow = 0;
+	vq->split.next_head = 0;
+	vq->split.batch_pending = false;
 
 	/* No callback?  Tell other side not to bother us. */
 	if (!callback) {
@@ -2123,6 +2183,11 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->free_head = 0;
 	for (i = 0; i < vring.num-1; i++)
 		vq->split.vring.desc[i].next = cpu_to_virtio16(vdev, i + 1);
+	/*
+	 * In order, the free list stays the ring itself and wraps around
+	 * from the last descriptor; the ring memory may not be zeroed.
+	 */
+	vq->split.vring.desc[i].next = 0;
 	memset(vq->split.desc_state, 0, vring.num *
 			sizeof(struct vring_desc_state_split));
 
@@ -2232,6 +2297,8 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_RING_PACKED:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
 		default:
@@ -2239,6 +2306,10 @@ void vring_transport_features(struct virtio_device *vdev)
 			__virtio_clear_bit(vdev, i);
 		}
 	}
+
+	/* Only the split ring knows how to use buffers in order. */
+	if (__virtio_test_bit(vdev, VIRTIO_F_RING_PACKED))
+		__virtio_clear_bit(vdev, VIRTIO_F_IN_ORDER);
 }
 EXPORT_SYMBOL_GPL(vring_transport_features);
 
@@ -625,10 +625,9 @@ static loff_t zonefs_file_llseek(struct file *file, loff_t offset, int whence)
 	return generic_file_llseek_size(file, offset, whence, isize, isize);
 }
 
-static int zonefs_file_write_dio_end_io(struct kiocb *iocb, ssize_t size,
-					int error, unsigned int flags)
+static int zonefs_file_write_end(struct inode *inode, loff_t pos,
+				 ssize_t size, int error)
 {
-	struct inode *inode = file_inode(iocb->ki_filp);
 	struct zonefs_inode_info *zi = ZONEFS_I(inode);
 
 	if (error) {
@@ -645,9 +644,9 @@ static int zonefs_file_write_dio_end_io(struct kiocb *iocb, ssize_t size,
 		 * size to the write end location.
 		 */
 		mutex_lock(&zi->i_truncate_mutex);
-		if (i_size_read(inode) < iocb->ki_pos + size) {
-			zonefs_update_stats(inode, iocb->ki_pos + size);
-			zonefs_i_size_write(inode, iocb->ki_pos + size);
+		if (i_size_read(inode) < pos + size) {
+			zonefs_update_stats(inode, pos + size);
+			zonefs_i_size_write(inode, pos + size);
 		}
 		mutex_unlock(&zi->i_truncate_mutex);
 	}
@@ -655,17 +654,91 @@ static int zonefs_file_write_dio_end_io(struct kiocb *iocb, ssize_t size,
 	return 0;
 }
 
+static int zonefs_file_write_dio_end_io(struct kiocb *iocb, ssize_t size,
+					int error, unsigned int flags)
+{
+	return zonefs_file_write_end(file_inode(iocb->ki_filp), iocb->ki_pos,
+				     size, error);
+}
+
 static const struct iomap_dio_ops zonefs_write_dio_ops = {
 	.end_io			= zonefs_file_write_dio_end_io,
 };
 
+/*
+ * Zone append BIOs, with what is needed to complete asynchronous ones.
+ */
+struct zonefs_dio_append {
+	struct kiocb		*iocb;
+	ssize_t			size;
+	struct work_struct	work;
+	struct bio		bio;
+};
+
+static struct bio_set zonefs_dio_append_bio_set;
+static struct workqueue_struct *zonefs_dio_append_wq;
+
+/*
+ * The location a zone append was written at is only known once it completes.
+ */
+static loff_t zonefs_dio_append_pos(struct inode *inode, struct bio *bio)
+{
+	return (loff_t)(bio->bi_iter.bi_sector - ZONEFS_I(inode)->i_zsector)
+		<< SECTOR_SHIFT;
+}
+
+static void zonefs_file_dio_append_complete(struct work_struct *work)
+{
+	struct zonefs_dio_append *za =
+		container_of(work, struct zonefs_dio_append, work);
+	struct kiocb *iocb = za->iocb;
+	struct bio *bio = &za->bio;
+	struct inode *inode = file_inode(iocb->ki_filp);
+	loff_t pos = zonefs_dio_append_pos(inode, bio);
+	ssize_t size = za->size;
+	int ret;
+
+	ret = zonefs_file_write_end(inode, pos, size,
+				    blk_status_to_errno(bio->bi_status));
+
+	bio_release_pages(bio, false);
+	bio_put(bio);
+	inode_dio_end(inode);
+
+	/* AIO users get the file offset the data landed at in res2 */
+	if (ret)
+		iocb->ki_complete(iocb, ret, 0);
+	else
+		iocb->ki_complete(iocb, size, pos);
+}
+
+static void zonefs_file_dio_append_end_io(struct bio *bio)
+{
+	struct zonefs_dio_append *za =
+		container_of(bio, struct zonefs_dio_append, bio);
+
+	/* Completing may need to sleep, e.g. to handle errors */
+	INIT_WORK(&za->work, zonefs_file_dio_append_complete);
+	queue_work(zonefs_dio_append_wq, &za->work);
+}
+
+/*
+ * Issue a single zone append BIO, truncating synchronous writes if needed, and
+ * wait for its completion. Asynchronous ones always fit into the BIO (see
+ * zonefs_file_dio_append_fits()) and are only submitted, so that several
+ * appends to the same zone can be in flight at once. The zone write offset of
+ * the file is advanced by the amount of data submitted.
+ */
 static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
 	struct zonefs_inode_info *zi = ZONEFS_I(inode);
 	struct block_device *bdev = inode->i_sb->s_bdev;
+	bool sync = is_sync_kiocb(iocb);
+	struct zonefs_dio_append *za;
 	unsigned int max;
 	struct bio *bio;
+	blk_qc_t qc;
 	ssize_t size;
 	int nr_pages;
 	ssize_t ret;
@@ -678,10 +751,11 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	if (!nr_pages)
 		return 0;
 
-	bio = bio_alloc_bioset(GFP_NOFS, nr_pages, &fs_bio_set);
+	bio = bio_alloc_bioset(GFP_NOFS, nr_pages, &zonefs_dio_append_bio_set);
 	if (!bio)
 		return -ENOMEM;
 
+	za = container_of(bio, struct zonefs_dio_append, bio);
 	bio_set_dev(bio, bdev);
 	bio->bi_iter.bi_sector = zi->i_zsector;
 	bio->bi_write_hint = iocb->ki_hint;
@@ -700,9 +774,31 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	if (iocb->ki_flags & IOCB_HIPRI)
 		bio_set_polled(bio, iocb);
 
-	ret = submit_bio_wait(bio);
+	mutex_lock(&zi->i_truncate_mutex);
+	zi->i_wpoffset += size;
+	mutex_unlock(&zi->i_truncate_mutex);
 
-	zonefs_file_write_dio_end_io(iocb, size, ret, 0);
+	if (sync) {
+		ret = submit_bio_wait(bio);
+		zonefs_file_write_end(inode, zonefs_dio_append_pos(inode, bio),
+				      size, ret);
+		goto out_release;
+	}
+
+	za->iocb = iocb;
+	za->size = size;
+	bio->bi_private = za;
+	bio->bi_end_io = zonefs_file_dio_append_end_io;
+
+	inode_dio_begin(inode);
+	qc = submit_bio(bio);
+	if (iocb->ki_flags & IOCB_HIPRI) {
+		/* As iomap does, for iomap_dio_iopoll() to find the queue */
+		WRITE_ONCE(iocb->ki_cookie, qc);
+		WRITE_ONCE(iocb->private, bdev_get_queue(bdev));
+	}
+
+	return -EIOCBQUEUED;
 
 out_release:
 	bio_release_pages(bio, false);
@@ -716,6 +812,28 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	return ret;
 }
 
+/*
+ * Asynchronous writes must be issued whole: a short zone append would leave
+ * the zone write offset of the file behind what the application expects. So
+ * they are only issued as zone appends if they fit into a single BIO.
+ */
+static bool zonefs_file_dio_append_fits(struct inode *inode,
+					struct iov_iter *from)
+{
+	struct request_queue *q = bdev_get_queue(inode->i_sb->s_bdev);
+	unsigned int max;
+	int nr_pages;
+
+	max = queue_max_zone_append_sectors(q);
+	max = ALIGN_DOWN(max << SECTOR_SHIFT, inode->i_sb->s_blocksize);
+	if (iov_iter_count(from) > max)
+		return false;
+
+	nr_pages = iov_iter_npages(from, BIO_MAX_PAGES + 1);
+
+	return nr_pages <= BIO_MAX_PAGES && nr_pages <= queue_max_segments(q);
+}
+
 /*
  * Handle direct writes. For sequential zone files, this is the only possible
  * write path. For these files, check that the user is issuing writes
@@ -740,6 +858,11 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 	 * For async direct IOs to sequential zone files, refuse IOCB_NOWAIT
 	 * as this can cause write reordering (e.g. the first aio gets EAGAIN
 	 * on the inode lock but the second goes through but is now unaligned).
+	 * Such writes are issued as zone appends. Asynchronous ones are too if
+	 * the file was opened with O_APPEND and they fit in a single zone
+	 * append: the device then picks where the data goes, so any number of
+	 * them can be in flight for the same zone, but they may land in a
+	 * different order than they were submitted in.
 	 */
 	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ && !sync &&
 	    (iocb->ki_flags & IOCB_NOWAIT))
@@ -756,6 +879,13 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 	if (ret <= 0)
 		goto inode_unlock;
 
+	/* The file size lags behind the zone appends still in flight */
+	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ && (iocb->ki_flags & IOCB_APPEND)) {
+		mutex_lock(&zi->i_truncate_mutex);
+		iocb->ki_pos = zi->i_wpoffset;
+		mutex_unlock(&zi->i_truncate_mutex);
+	}
+
 	iov_iter_truncate(from, zi->i_max_size - iocb->ki_pos);
 	count = iov_iter_count(from);
 
@@ -773,21 +903,31 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 			goto inode_unlock;
 		}
 		mutex_unlock(&zi->i_truncate_mutex);
-		append = sync;
+		append = sync || ((iocb->ki_flags & IOCB_APPEND) &&
+				  zonefs_file_dio_append_fits(inode, from));
+
+		/*
+		 * A regular write goes to the zone write pointer, which zone
+		 * appends still in flight have not moved yet.
+		 */
+		if (!append)
+			inode_dio_wait(inode);
 	}
 
-	if (append)
+	/* Zone appends advance the zone write offset themselves */
+	if (append) {
 		ret = zonefs_file_dio_append(iocb, from);
-	else
+	} else {
 		ret = iomap_dio_rw(iocb, from, &zonefs_iomap_ops,
 				   &zonefs_write_dio_ops, sync);
-	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ &&
-	    (ret > 0 || ret == -EIOCBQUEUED)) {
-		if (ret > 0)
-			count = ret;
-		mutex_lock(&zi->i_truncate_mutex);
-		zi->i_wpoffset += count;
-		mutex_unlock(&zi->i_truncate_mutex);
+		if (zi->i_ztype == ZONEFS_ZTYPE_SEQ &&
+		    (ret > 0 || ret == -EIOCBQUEUED)) {
+			if (ret > 0)
+				count = ret;
+			mutex_lock(&zi->i_truncate_mutex);
+			zi->i_wpoffset += count;
+			mutex_unlock(&zi->i_truncate_mutex);
+		}
 	}
 
 inode_unlock:
@@ -1701,23 +1841,44 @@ static int __init zonefs_init(void)
 
 	BUILD_BUG_ON(sizeof(struct zonefs_super) != ZONEFS_SUPER_SIZE);
 
-	ret = zonefs_init_inodecache();
+	ret = bioset_init(&zonefs_dio_append_bio_set, BIO_POOL_SIZE,
+			  offsetof(struct zonefs_dio_append, bio),
+			  BIOSET_NEED_BVECS);
 	if (ret)
 		return ret;
 
-	ret = register_filesystem(&zonefs_type);
-	if (ret) {
-		zonefs_destroy_inodecache();
-		return ret;
+	zonefs_dio_append_wq = alloc_workqueue("zonefs_dio_append",
+					       WQ_MEM_RECLAIM, 0);
+	if (!zonefs_dio_append_wq) {
+		ret = -ENOMEM;
+		goto out_bioset;
 	}
 
+	ret = zonefs_init_inodecache();
+	if (ret)
+		goto out_wq;
+
+	ret = register_filesystem(&zonefs_type);
+	if (ret)
+		goto out_inodecache;
+
 	return 0;
+
+out_inodecache:
+	zonefs_destroy_inodecache();
+out_wq:
+	destroy_workqueue(zonefs_dio_append_wq);
+out_bioset:
+	bioset_exit(&zonefs_dio_append_bio_set);
+	return ret;
 }
 
 static void __exit zonefs_exit(void)
 {
 	zonefs_destroy_inodecache();
 	unregister_filesystem(&zonefs_type);
+	destroy_workqueue(zonefs_dio_append_wq);
+	bioset_exit(&zonefs_dio_append_bio_set);
 }
 
 MODULE_AUTHOR("Damien Le Moal");
@@ -32,6 +32,8 @@
 #define CLK_OPS_PARENT_ENABLE	BIT(12)
 /* duty cycle call may be forwarded to the parent clock */
 #define CLK_DUTY_CYCLE_PARENT	BIT(13)
+/* clock and its children have their own prepare lock, see clk_core_lock() */
+#define CLK_LOCK_DOMAIN		BIT(14)
 
 struct clk;
 struct clk_hw;
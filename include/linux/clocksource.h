@@ -30,6 +30,9 @@ struct module;
 
 #include <vdso/clocksource.h>
 
+/* Number of skews to the watchdog kept for each clocksource */
+#define CLOCKSOURCE_SKEW_HISTORY	16
+
 /**
  * struct clocksource - hardware abstraction for a free running counter
  *	Provides mostly state-free accessors to the underlying hardware.
@@ -74,6 +77,11 @@ struct module;
  * @wd_list:		List head to enqueue into the watchdog list (internal)
  * @cs_last:		Last clocksource value for clocksource watchdog
  * @wd_last:		Last watchdog value corresponding to @cs_last
+ * @wd_skew:		Ring of the last skews to the watchdog, in parts per
+ *			billion of the check interval
+ * @wd_skew_nr:		Number of skews recorded in @wd_skew
+ * @wd_skew_min:	Lowest skew recorded
+ * @wd_skew_max:	Highest skew recorded
  * @owner:		Module reference, must be set by clocksource in modules
  *
  * Note: This struct is not used in hotpathes of the timekeeping code
@@ -116,6 +124,10 @@ struct clocksource {
 	struct list_head	wd_list;
 	u64			cs_last;
 	u64			wd_last;
+	s32			wd_skew[CLOCKSOURCE_SKEW_HISTORY];
+	unsigned int		wd_skew_nr;
+	s32			wd_skew_min;
+	s32			wd_skew_max;
 #endif
 	struct module		*owner;
 };
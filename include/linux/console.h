@@ -151,6 +151,10 @@ struct console {
 	int	cflag;
 	void	*data;
 	struct	 console *next;
+	u64	seq;		/* next printk record to print */
+	unsigned long dropped;	/* records lost since the last notice */
+	unsigned long lost;	/* records lost since registration */
+	struct task_struct *thread;	/* printer kthread, if any */
 };
 
 /*
@@ -473,6 +473,8 @@ struct hid_field {
 
 #define HID_MAX_FIELDS 256
 
+struct hid_report_plan;
+
 struct hid_report {
 	struct list_head list;
 	struct list_head hidinput_list;
@@ -483,6 +485,7 @@ struct hid_report {
 	unsigned maxfield;				/* maximum valid field index */
 	unsigned size;					/* size of the report (bits) */
 	struct hid_device *device;			/* associated device */
+	struct hid_report_plan *plan;			/* precompiled field extraction */
 };
 
 #define HID_MAX_IDS 256
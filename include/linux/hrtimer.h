@@ -195,6 +195,12 @@ enum  hrtimer_base_type {
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
+ * @nr_passes:		Total number of extra passes over the queues, for timers
+ *			which expired while hrtimer_interrupt was running
+ * @max_expired:	Maximum number of timers expired by one hrtimer interrupt
+ * @max_expiry_time:	Maximum time spent in one pass over the queues
+ * @nr_expired:		Total number of timers expired by hrtimer interrupts
+ * @expiry_time:	Total time spent expiring timers in hrtimer interrupts
  * @softirq_expiry_lock: Lock which is taken while softirq based hrtimer are
  *			 expired
  * @timer_waiters:	A hrtimer_cancel() invocation waits for the timer
@@ -225,6 +231,11 @@ struct hrtimer_cpu_base {
 	unsigned short			nr_retries;
 	unsigned short			nr_hangs;
 	unsigned int			max_hang_time;
+	unsigned int			nr_passes;
+	unsigned int			max_expired;
+	unsigned int			max_expiry_time;
+	u64				nr_expired;
+	u64				expiry_time;
 #endif
 #ifdef CONFIG_PREEMPT_RT
 	spinlock_t			softirq_expiry_lock;
@@ -48,6 +48,8 @@
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
+/* ONFI optional commands READ CACHE SEQUENTIAL/END supported? */
+#define ONFI_OPT_CMD_READ_CACHE		(1 << 1)
 /* ONFI optional commands SET/GET FEATURES supported? */
 #define ONFI_OPT_CMD_SET_GET_FEATURES	(1 << 2)
 
@@ -67,6 +67,8 @@ struct nand_chip;
 
 /* Extended commands for large page devices */
 #define NAND_CMD_READSTART	0x30
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
 
@@ -223,6 +225,7 @@ struct nand_chip;
  * struct nand_parameters - NAND generic parameters from the parameter page
  * @model: Model name
  * @supports_set_get_features: The NAND chip supports setting/getting features
+ * @supports_read_cache: The NAND chip supports READ CACHE SEQUENTIAL/END
  * @set_feature_list: Bitmap of features that can be set
  * @get_feature_list: Bitmap of features that can be get
  * @onfi: ONFI specific parameters
@@ -231,6 +234,7 @@ struct nand_parameters {
 	/* Generic parameters */
 	const char *model;
 	bool supports_set_get_features;
+	bool supports_read_cache;
 	DECLARE_BITMAP(set_feature_list, ONFI_FEATURE_NUMBER);
 	DECLARE_BITMAP(get_feature_list, ONFI_FEATURE_NUMBER);
 
@@ -1086,6 +1090,17 @@ struct nand_manufacturer {
  *          NAND Controller drivers should not modify this value, but they're
  *          allowed to read it.
  * @read_retries: The number of read retry modes supported
+ * @cont_read: Sequential cached page read internals
+ * @cont_read.supported: Both the chip and the controller can chain page reads
+ *                       with READ CACHE SEQUENTIAL/END
+ * @cont_read.ongoing: A cached read sequence is planned for the current read
+ *                     operation
+ * @cont_read.started: READ CACHE SEQUENTIAL has been sent and the sequence
+ *                     still has to be terminated with READ CACHE END
+ * @cont_read.first_page: First page of the cached read sequence
+ * @cont_read.last_page: Last page of the cached read sequence
+ * @cont_read.next_page: Page the chip will output on the next READ CACHE
+ *                       SEQUENTIAL/END command
  * @controller: The hardware controller	structure which is shared among multiple
  *              independent devices
  * @ecc: The ECC controller structure
@@ -1135,6 +1150,14 @@ struct nand_chip {
 	unsigned int suspended : 1;
 	int cur_cs;
 	int read_retries;
+	struct {
+		unsigned int supported : 1;
+		unsigned int ongoing : 1;
+		unsigned int started : 1;
+		unsigned int first_page;
+		unsigned int last_page;
+		unsigned int next_page;
+	} cont_read;
 
 	/* Externals */
 	struct nand_controller *controller;
@@ -117,6 +117,9 @@ struct posix_cputimer_base {
  * @expiry_active:	Timer expiry is active. Used for
  *			process wide timers to avoid multiple
  *			task trying to handle expiry concurrently
+ * @sched_active:	The thread group runtime is accounted. Only
+ *			used for process wide timers, as CPUCLOCK_SCHED
+ *			timers are the only ones which need it
  *
  * Used in task_struct and signal_struct
  */
@@ -124,6 +127,7 @@ struct posix_cputimers {
 	struct posix_cputimer_base	bases[CPUCLOCK_MAX];
 	unsigned int			timers_active;
 	unsigned int			expiry_active;
+	unsigned int			sched_active;
 };
 
 /**
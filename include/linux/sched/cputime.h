@@ -106,12 +106,37 @@ struct thread_group_cputimer *get_running_cputimer(struct task_struct *tsk)
 
 	return cputimer;
 }
+
+/**
+ * get_running_sched_cputimer - return &tsk->signal->cputimer if the thread
+ *				group runtime is accounted
+ *
+ * @tsk:	Pointer to target task.
+ *
+ * The runtime is updated on each scheduler clock update rather than on
+ * ticks, so it is only accounted while process wide CPUCLOCK_SCHED timers
+ * need it.
+ */
+static inline
+struct thread_group_cputimer *get_running_sched_cputimer(struct task_struct *tsk)
+{
+	if (!READ_ONCE(tsk->signal->posix_cputimers.sched_active))
+		return NULL;
+
+	return get_running_cputimer(tsk);
+}
 #else
 static inline
 struct thread_group_cputimer *get_running_cputimer(struct task_struct *tsk)
 {
 	return NULL;
 }
+
+static inline
+struct thread_group_cputimer *get_running_sched_cputimer(struct task_struct *tsk)
+{
+	return NULL;
+}
 #endif
 
 /**
@@ -163,13 +188,13 @@ static inline void account_group_system_time(struct task_struct *tsk,
  * @ns:		Time value by which to increment the sum_exec_runtime field
  *		of the thread_group_cputime structure.
  *
- * If thread group time is being maintained, get the structure for the
+ * If thread group runtime is being maintained, get the structure for the
  * running CPU and update the sum_exec_runtime field there.
  */
 static inline void account_group_exec_runtime(struct task_struct *tsk,
 					      unsigned long long ns)
 {
-	struct thread_group_cputimer *cputimer = get_running_cputimer(tsk);
+	struct thread_group_cputimer *cputimer = get_running_sched_cputimer(tsk);
 
 	if (!cputimer)
 		return;
@@ -74,8 +74,20 @@ struct sched_domain_shared {
 	atomic_t	ref;
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
+	/*
+	 * Hint of the CPUs of the LLC which are idle or only have SCHED_IDLE
+	 * tasks, updated as they enter and leave that state.
+	 *
+	 * NOTE: this field is variable length, see sched_domain::span.
+	 */
+	unsigned long	idle_cpus[];
 };
 
+static inline struct cpumask *sds_idle_cpus(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_cpus);
+}
+
 struct sched_domain {
 	/* These fields must be setup */
 	struct sched_domain __rcu *parent;	/* top domain must be null terminated */
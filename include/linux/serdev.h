@@ -314,6 +314,10 @@ struct device *serdev_tty_port_register(struct tty_port *port,
 					struct device *parent,
 					struct tty_driver *drv, int idx);
 int serdev_tty_port_unregister(struct tty_port *port);
+bool serdev_tty_port_owned(struct tty_port *port);
+int serdev_tty_port_receive_direct(struct tty_port *port,
+				   const unsigned char *data, size_t count);
+void serdev_tty_port_rx_queued(struct tty_port *port, size_t count);
 #else
 static inline struct device *serdev_tty_port_register(struct tty_port *port,
 					   struct device *parent,
@@ -325,6 +329,20 @@ static inline int serdev_tty_port_unregister(struct tty_port *port)
 {
 	return -ENODEV;
 }
+static inline bool serdev_tty_port_owned(struct tty_port *port)
+{
+	return false;
+}
+static inline int serdev_tty_port_receive_direct(struct tty_port *port,
+						 const unsigned char *data,
+						 size_t count)
+{
+	return 0;
+}
+static inline void serdev_tty_port_rx_queued(struct tty_port *port,
+					     size_t count)
+{
+}
 #endif /* CONFIG_SERIAL_DEV_CTRL_TTYPORT */
 
 #endif /*_LINUX_SERDEV_H */
@@ -264,6 +264,26 @@ DEFINE_EVENT(clk_duty_cycle, clk_set_duty_cycle_complete,
 	TP_ARGS(core, duty)
 );
 
+TRACE_EVENT(clk_lock_wait,
+
+	TP_PROTO(const char *lock, u64 wait_ns),
+
+	TP_ARGS(lock, wait_ns),
+
+	TP_STRUCT__entry(
+		__string(        lock,           lock             )
+		__field(         u64,            wait_ns          )
+	),
+
+	TP_fast_assign(
+		__assign_str(lock, lock);
+		__entry->wait_ns = wait_ns;
+	),
+
+	TP_printk("%s %llu", __get_str(lock),
+		  (unsigned long long)__entry->wait_ns)
+);
+
 #endif /* _TRACE_CLK_H */
 
 /* This part must be outside protection */
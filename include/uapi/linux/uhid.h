@@ -175,6 +175,9 @@ struct uhid_feature_answer_req {
  * that type and can be accessed via ev->u.XYZ accordingly.
  * If user-space writes short events, they're extended with 0s by the kernel. If
  * the kernel writes short events, user-space shall extend them with 0s.
+ * read() and write() transfer a single event. readv() and writev() transfer
+ * one event per iovec, so several events can be exchanged in one syscall;
+ * readv() only blocks until the first event is available.
  */
 
 struct uhid_event {
@@ -46,6 +46,17 @@
 /* Specify an eventfd file descriptor to signal on log write. */
 #define VHOST_SET_LOG_FD _IOW(VHOST_VIRTIO, 0x07, int)
 
+/* Worker threads. */
+/* Create a new worker thread, running in the cgroups of the caller.  Its id
+ * is returned in worker_id. */
+#define VHOST_NEW_WORKER _IOR(VHOST_VIRTIO, 0x08, struct vhost_worker_state)
+/* Restrict a worker to the given CPUs, within those allowed to the caller. */
+#define VHOST_SET_WORKER_AFFINITY _IOW(VHOST_VIRTIO, 0x09,	\
+				       struct vhost_worker_affinity)
+/* Get accessor: reads worker_id, writes the rest. */
+#define VHOST_GET_WORKER_STATS _IOWR(VHOST_VIRTIO, 0x0a,	\
+				     struct vhost_worker_stats)
+
 /* Ring setup. */
 /* Set number of descriptors in ring. This parameter can not
  * be modified while ring is running (bound to a device). */
@@ -71,6 +82,14 @@
 #define VHOST_SET_VRING_ENDIAN _IOW(VHOST_VIRTIO, 0x13, struct vhost_vring_state)
 #define VHOST_GET_VRING_ENDIAN _IOW(VHOST_VIRTIO, 0x14, struct vhost_vring_state)
 
+/* Select the worker processing a vring.  This can only be changed while the
+ * ring has no backend, trying to do so otherwise returns -EBUSY. */
+#define VHOST_ATTACH_VRING_WORKER _IOW(VHOST_VIRTIO, 0x15,	\
+				       struct vhost_vring_worker)
+/* Get accessor: reads index, writes worker_id. */
+#define VHOST_GET_VRING_WORKER _IOWR(VHOST_VIRTIO, 0x16,	\
+				     struct vhost_vring_worker)
+
 /* The following ioctls use eventfd file descriptors to signal and poll
  * for events. */
 
@@ -47,6 +47,44 @@ struct vhost_vring_addr {
 	__u64 log_guest_addr;
 };
 
+/* Every device gets a default worker thread, shared by all its virtqueues,
+ * when it gets an owner.  Further workers let virtqueues, or groups of them,
+ * be processed in parallel. */
+struct vhost_worker_state {
+	/* Returned by VHOST_NEW_WORKER. */
+	unsigned int worker_id;
+};
+
+struct vhost_vring_worker {
+	/* vring index */
+	unsigned int index;
+	/* Worker to process the vring, 0 being the default worker. */
+	unsigned int worker_id;
+};
+
+struct vhost_worker_affinity {
+	unsigned int worker_id;
+	/* Size in bytes of the CPU mask, as for sched_setaffinity(). */
+	unsigned int cpumask_size;
+	/* Userspace address of the CPU mask. */
+	__u64 cpumask;
+};
+
+struct vhost_worker_stats {
+	unsigned int worker_id;
+	/* Thread id of the worker. */
+	int pid;
+	/* Number of vrings processed by the worker. */
+	unsigned int nr_vrings;
+	unsigned int padding;
+	/* Time spent running work items, in nanoseconds. */
+	__u64 busy_ns;
+	/* Number of work items run. */
+	__u64 works;
+	/* Number of times the worker woke up to find work. */
+	__u64 wakeups;
+};
+
 /* no alignment requirement */
 struct vhost_iotlb_msg {
 	__u64 iova;
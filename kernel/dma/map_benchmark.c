@@ -8,24 +8,49 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-direct.h>
 #include <linux/dma-mapping.h>
+#include <linux/dmapool.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/swiotlb.h>
 #include <linux/timekeeping.h>
 
 #define DMA_MAP_BENCHMARK	_IOWR('d', 1, struct map_benchmark)
 #define DMA_MAP_MAX_THREADS	1024
 #define DMA_MAP_MAX_SECONDS	300
+#define DMA_MAP_MAX_GRANULE	1024
+#define DMA_MAP_MAX_NENTS	128
 
 #define DMA_MAP_BIDIRECTIONAL	0
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+/*
+ * What the benchmark threads do in a loop. For each mode, the "map" latency
+ * is the one of the first operation and the "unmap" latency the one of the
+ * operation undoing it.
+ */
+#define DMA_MAP_MODE_SINGLE	0	/* dma_map_single() */
+#define DMA_MAP_MODE_SWIOTLB	1	/* always bounce through the swiotlb */
+#define DMA_MAP_MODE_SG		2	/* dma_map_sg() of nents segments */
+#define DMA_MAP_MODE_COHERENT	3	/* dma_alloc_coherent() */
+#define DMA_MAP_MODE_POOL	4	/* dma_pool_alloc() of nents blocks */
+#define DMA_MAP_MODE_SYNC	5	/* dma_sync_single_for_device() */
+#define DMA_MAP_NR_MODES	6
+
+/* Percentiles reported, in per mille */
+#define DMA_MAP_NR_PCT		4
+static const unsigned int map_benchmark_pct[DMA_MAP_NR_PCT] = {
+	500, 900, 990, 999,
+};
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -36,9 +61,29 @@ struct map_benchmark {
 	__s32 node; /* which numa node this benchmark will run on */
 	__u32 dma_bits; /* DMA addressing capability */
 	__u32 dma_dir; /* DMA data direction */
-	__u64 expansion[10];	/* For future use */
+	__u32 mode; /* what is mapped and how */
+	__u32 granule; /* how many pages each mapping is made of */
+	__u32 nents; /* segments of a scatterlist, or pool blocks per loop */
+	__u32 pool_size; /* size of the DMA pool blocks */
+	__u32 pool_align; /* alignment of the DMA pool blocks */
+	/* keep an even number of __u32 above, the layout has no holes */
+	__u64 loops; /* number of map/unmap done by all threads */
+	__u64 map_pct_ns[DMA_MAP_NR_PCT]; /* map latency percentiles in ns */
+	__u64 unmap_pct_ns[DMA_MAP_NR_PCT]; /* as above */
+	__u64 expansion[8];	/* For future use */
 };
 
+/*
+ * Latencies are counted in a log-linear histogram: values below
+ * 2^MAP_HIST_SUB_BITS ns have a bucket each, and every following power of
+ * two is split in 2^MAP_HIST_SUB_BITS buckets, so that a percentile is
+ * known within 1/8th of its value.
+ */
+#define MAP_HIST_SUB_BITS	3
+#define MAP_HIST_MAX_BITS	40
+#define MAP_HIST_BUCKETS \
+	((MAP_HIST_MAX_BITS - MAP_HIST_SUB_BITS + 1) << MAP_HIST_SUB_BITS)
+
 struct map_benchmark_data {
 	struct map_benchmark bparam;
 	struct device *dev;
@@ -49,18 +94,355 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	struct dma_pool *pool;
+	struct mutex hist_lock;
+	u64 map_hist[MAP_HIST_BUCKETS];
+	u64 unmap_hist[MAP_HIST_BUCKETS];
 };
 
-static int map_benchmark_thread(void *data)
-{
+/* State of one benchmark thread */
+struct map_benchmark_ctx {
+	struct map_benchmark_data *map;
+	size_t size;
 	void *buf;
 	dma_addr_t dma_addr;
+	struct sg_table sgt;
+	unsigned int nr_bufs;
+	int mapped_nents;
+	void **blocks;
+	dma_addr_t *block_addrs;
+	u64 map_hist[MAP_HIST_BUCKETS];
+	u64 unmap_hist[MAP_HIST_BUCKETS];
+};
+
+/* ->prepare() undoes what it did when it fails, ->cleanup() is not called */
+struct map_benchmark_ops {
+	int (*prepare)(struct map_benchmark_ctx *ctx);
+	int (*map)(struct map_benchmark_ctx *ctx);
+	void (*unmap)(struct map_benchmark_ctx *ctx);
+	void (*cleanup)(struct map_benchmark_ctx *ctx);
+};
+
+static unsigned int map_hist_bucket(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < (1 << MAP_HIST_SUB_BITS))
+		return ns;
+
+	ns = min_t(u64, ns, BIT_ULL(MAP_HIST_MAX_BITS) - 1);
+	msb = fls64(ns) - 1;
+	return ((msb - MAP_HIST_SUB_BITS + 1) << MAP_HIST_SUB_BITS) +
+	       ((ns >> (msb - MAP_HIST_SUB_BITS)) &
+		((1 << MAP_HIST_SUB_BITS) - 1));
+}
+
+/* Highest value counted in @bucket */
+static u64 map_hist_bucket_max(unsigned int bucket)
+{
+	unsigned int shift = bucket >> MAP_HIST_SUB_BITS;
+	u64 sub = bucket & ((1 << MAP_HIST_SUB_BITS) - 1);
+
+	if (!shift)
+		return sub;
+
+	return (((1 << MAP_HIST_SUB_BITS) + sub + 1) << (shift - 1)) - 1;
+}
+
+static void map_hist_percentiles(const u64 *hist, u64 total, __u64 *pct_ns)
+{
+	unsigned int i, bucket = 0;
+	u64 seen = hist[0], target;
+
+	for (i = 0; i < DMA_MAP_NR_PCT; i++) {
+		target = DIV_ROUND_UP_ULL(total * map_benchmark_pct[i], 1000);
+		while (seen < target && bucket < MAP_HIST_BUCKETS - 1)
+			seen += hist[++bucket];
+		pct_ns[i] = map_hist_bucket_max(bucket);
+	}
+}
+
+/* Stain the buffers in the cache, see map_benchmark_thread() */
+static void map_benchmark_stain(struct map_benchmark_ctx *ctx, void *buf,
+				size_t size)
+{
+	if (ctx->map->dir != DMA_FROM_DEVICE)
+		memset(buf, 0x66, size);
+}
+
+static int map_benchmark_buf_prepare(struct map_benchmark_ctx *ctx)
+{
+	ctx->buf = (void *)__get_free_pages(GFP_KERNEL, get_order(ctx->size));
+	return ctx->buf ? 0 : -ENOMEM;
+}
+
+static void map_benchmark_buf_cleanup(struct map_benchmark_ctx *ctx)
+{
+	free_pages((unsigned long)ctx->buf, get_order(ctx->size));
+}
+
+static int map_benchmark_single_map(struct map_benchmark_ctx *ctx)
+{
+	struct map_benchmark_data *map = ctx->map;
+
+#ifdef CONFIG_SWIOTLB
+	if (map->bparam.mode == DMA_MAP_MODE_SWIOTLB)
+		ctx->dma_addr = swiotlb_map(map->dev, virt_to_phys(ctx->buf),
+					    ctx->size, map->dir, 0);
+	else
+#endif
+		ctx->dma_addr = dma_map_single(map->dev, ctx->buf, ctx->size,
+					       map->dir);
+
+	if (unlikely(dma_mapping_error(map->dev, ctx->dma_addr))) {
+		pr_err("dma_map_single failed on %s\n", dev_name(map->dev));
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void map_benchmark_single_unmap(struct map_benchmark_ctx *ctx)
+{
+	struct map_benchmark_data *map = ctx->map;
+
+#ifdef CONFIG_SWIOTLB
+	if (map->bparam.mode == DMA_MAP_MODE_SWIOTLB) {
+		swiotlb_tbl_unmap_single(map->dev,
+					 dma_to_phys(map->dev, ctx->dma_addr),
+					 ctx->size, ctx->size, map->dir, 0);
+		return;
+	}
+#endif
+	dma_unmap_single(map->dev, ctx->dma_addr, ctx->size, map->dir);
+}
+
+static void map_benchmark_sg_cleanup(struct map_benchmark_ctx *ctx)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(ctx->sgt.sgl, sg, ctx->nr_bufs, i)
+		free_pages((unsigned long)sg_virt(sg), get_order(ctx->size));
+	sg_free_table(&ctx->sgt);
+}
+
+/* Each segment is a separate allocation, as buffers of real requests are */
+static int map_benchmark_sg_prepare(struct map_benchmark_ctx *ctx)
+{
+	unsigned int nents = ctx->map->bparam.nents;
+	struct scatterlist *sg;
+	void *buf;
+	int i, ret;
+
+	ret = sg_alloc_table(&ctx->sgt, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sg(ctx->sgt.sgl, sg, nents, i) {
+		buf = (void *)__get_free_pages(GFP_KERNEL, get_order(ctx->size));
+		if (!buf) {
+			map_benchmark_sg_cleanup(ctx);
+			return -ENOMEM;
+		}
+		sg_set_buf(sg, buf, ctx->size);
+		ctx->nr_bufs++;
+	}
+	return 0;
+}
+
+static int map_benchmark_sg_map(struct map_benchmark_ctx *ctx)
+{
+	struct map_benchmark_data *map = ctx->map;
+
+	ctx->mapped_nents = dma_map_sg(map->dev, ctx->sgt.sgl,
+				       ctx->sgt.orig_nents, map->dir);
+	if (unlikely(!ctx->mapped_nents)) {
+		pr_err("dma_map_sg failed on %s\n", dev_name(map->dev));
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void map_benchmark_sg_unmap(struct map_benchmark_ctx *ctx)
+{
+	dma_unmap_sg(ctx->map->dev, ctx->sgt.sgl, ctx->sgt.orig_nents,
+		     ctx->map->dir);
+}
+
+static int map_benchmark_coherent_map(struct map_benchmark_ctx *ctx)
+{
+	ctx->buf = dma_alloc_coherent(ctx->map->dev, ctx->size,
+				      &ctx->dma_addr, GFP_KERNEL);
+	if (unlikely(!ctx->buf)) {
+		pr_err("dma_alloc_coherent failed on %s\n",
+		       dev_name(ctx->map->dev));
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void map_benchmark_coherent_unmap(struct map_benchmark_ctx *ctx)
+{
+	dma_free_coherent(ctx->map->dev, ctx->size, ctx->buf, ctx->dma_addr);
+}
+
+static void map_benchmark_pool_cleanup(struct map_benchmark_ctx *ctx)
+{
+	kfree(ctx->blocks);
+	kfree(ctx->block_addrs);
+}
+
+static int map_benchmark_pool_prepare(struct map_benchmark_ctx *ctx)
+{
+	unsigned int nents = ctx->map->bparam.nents;
+
+	ctx->blocks = kcalloc(nents, sizeof(*ctx->blocks), GFP_KERNEL);
+	ctx->block_addrs = kcalloc(nents, sizeof(*ctx->block_addrs),
+				   GFP_KERNEL);
+	if (!ctx->blocks || !ctx->block_addrs) {
+		map_benchmark_pool_cleanup(ctx);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void map_benchmark_pool_unmap(struct map_benchmark_ctx *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->map->bparam.nents && ctx->blocks[i]; i++) {
+		dma_pool_free(ctx->map->pool, ctx->blocks[i],
+			      ctx->block_addrs[i]);
+		ctx->blocks[i] = NULL;
+	}
+}
+
+static int map_benchmark_pool_map(struct map_benchmark_ctx *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->map->bparam.nents; i++) {
+		ctx->blocks[i] = dma_pool_alloc(ctx->map->pool, GFP_KERNEL,
+						&ctx->block_addrs[i]);
+		if (unlikely(!ctx->blocks[i])) {
+			pr_err("dma_pool_alloc failed on %s\n",
+			       dev_name(ctx->map->dev));
+			map_benchmark_pool_unmap(ctx);
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+/* The buffer stays mapped, only its ownership goes back and forth */
+static int map_benchmark_sync_prepare(struct map_benchmark_ctx *ctx)
+{
+	int ret;
+
+	ret = map_benchmark_buf_prepare(ctx);
+	if (ret)
+		return ret;
+
+	ret = map_benchmark_single_map(ctx);
+	if (ret)
+		map_benchmark_buf_cleanup(ctx);
+	return ret;
+}
+
+static void map_benchmark_sync_cleanup(struct map_benchmark_ctx *ctx)
+{
+	map_benchmark_single_unmap(ctx);
+	map_benchmark_buf_cleanup(ctx);
+}
+
+static int map_benchmark_sync_map(struct map_benchmark_ctx *ctx)
+{
+	dma_sync_single_for_device(ctx->map->dev, ctx->dma_addr, ctx->size,
+				   ctx->map->dir);
+	return 0;
+}
+
+static void map_benchmark_sync_unmap(struct map_benchmark_ctx *ctx)
+{
+	dma_sync_single_for_cpu(ctx->map->dev, ctx->dma_addr, ctx->size,
+				ctx->map->dir);
+}
+
+static const struct map_benchmark_ops map_benchmark_ops[DMA_MAP_NR_MODES] = {
+	[DMA_MAP_MODE_SINGLE] = {
+		.prepare	= map_benchmark_buf_prepare,
+		.map		= map_benchmark_single_map,
+		.unmap		= map_benchmark_single_unmap,
+		.cleanup	= map_benchmark_buf_cleanup,
+	},
+	[DMA_MAP_MODE_SWIOTLB] = {
+		.prepare	= map_benchmark_buf_prepare,
+		.map		= map_benchmark_single_map,
+		.unmap		= map_benchmark_single_unmap,
+		.cleanup	= map_benchmark_buf_cleanup,
+	},
+	[DMA_MAP_MODE_SG] = {
+		.prepare	= map_benchmark_sg_prepare,
+		.map		= map_benchmark_sg_map,
+		.unmap		= map_benchmark_sg_unmap,
+		.cleanup	= map_benchmark_sg_cleanup,
+	},
+	[DMA_MAP_MODE_COHERENT] = {
+		.map		= map_benchmark_coherent_map,
+		.unmap		= map_benchmark_coherent_unmap,
+	},
+	[DMA_MAP_MODE_POOL] = {
+		.prepare	= map_benchmark_pool_prepare,
+		.map		= map_benchmark_pool_map,
+		.unmap		= map_benchmark_pool_unmap,
+		.cleanup	= map_benchmark_pool_cleanup,
+	},
+	[DMA_MAP_MODE_SYNC] = {
+		.prepare	= map_benchmark_sync_prepare,
+		.map		= map_benchmark_sync_map,
+		.unmap		= map_benchmark_sync_unmap,
+		.cleanup	= map_benchmark_sync_cleanup,
+	},
+};
+
+static void map_benchmark_stain_ctx(struct map_benchmark_ctx *ctx)
+{
+	struct scatterlist *sg;
+	int i;
+
+	switch (ctx->map->bparam.mode) {
+	case DMA_MAP_MODE_SINGLE:
+	case DMA_MAP_MODE_SWIOTLB:
+	case DMA_MAP_MODE_SYNC:
+		map_benchmark_stain(ctx, ctx->buf, ctx->size);
+		break;
+	case DMA_MAP_MODE_SG:
+		for_each_sg(ctx->sgt.sgl, sg, ctx->sgt.orig_nents, i)
+			map_benchmark_stain(ctx, sg_virt(sg), ctx->size);
+		break;
+	}
+}
+
+static int map_benchmark_thread(void *data)
+{
 	struct map_benchmark_data *map = data;
+	const struct map_benchmark_ops *ops =
+		&map_benchmark_ops[map->bparam.mode];
+	struct map_benchmark_ctx *ctx;
+	unsigned int i;
 	int ret = 0;
 
-	buf = (void *)__get_free_page(GFP_KERNEL);
-	if (!buf)
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
 		return -ENOMEM;
+	ctx->map = map;
+	ctx->size = map->bparam.granule * PAGE_SIZE;
+
+	if (ops->prepare) {
+		ret = ops->prepare(ctx);
+		if (ret)
+			goto out_free;
+	}
 
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
@@ -73,25 +455,23 @@ static int map_benchmark_thread(void *data)
 		 * overhead of BIDIRECTIONAL or TO_DEVICE mappings;
 		 * 66 means evertything goes well! 66 is lucky.
 		 */
-		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, PAGE_SIZE);
+		map_benchmark_stain_ctx(ctx);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, PAGE_SIZE, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
-			goto out;
-		}
+		ret = ops->map(ctx);
+		if (unlikely(ret))
+			break;
 		map_etime = ktime_get();
 		map_delta = ktime_sub(map_etime, map_stime);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, PAGE_SIZE, map->dir);
+		ops->unmap(ctx);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
+		ctx->map_hist[map_hist_bucket(map_delta)]++;
+		ctx->unmap_hist[map_hist_bucket(unmap_delta)]++;
+
 		/* calculate sum and sum of squares */
 
 		map_100ns = div64_ul(map_delta,  100);
@@ -106,8 +486,18 @@ static int map_benchmark_thread(void *data)
 		atomic64_inc(&map->loops);
 	}
 
-out:
-	free_page((unsigned long)buf);
+	if (ops->cleanup)
+		ops->cleanup(ctx);
+
+	mutex_lock(&map->hist_lock);
+	for (i = 0; i < MAP_HIST_BUCKETS; i++) {
+		map->map_hist[i] += ctx->map_hist[i];
+		map->unmap_hist[i] += ctx->unmap_hist[i];
+	}
+	mutex_unlock(&map->hist_lock);
+
+out_free:
+	kfree(ctx);
 	return ret;
 }
 
@@ -127,13 +517,26 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 
 	get_device(map->dev);
 
+	if (map->bparam.mode == DMA_MAP_MODE_POOL) {
+		map->pool = dma_pool_create("dma_map_benchmark", map->dev,
+					    map->bparam.pool_size,
+					    map->bparam.pool_align, 0);
+		if (!map->pool) {
+			pr_err("create dma pool failed\n");
+			ret = -ENOMEM;
+			goto out_put;
+		}
+	}
+
 	for (i = 0; i < threads; i++) {
 		tsk[i] = kthread_create_on_node(map_benchmark_thread, map,
 				map->bparam.node, "dma-map-benchmark/%d", i);
 		if (IS_ERR(tsk[i])) {
 			pr_err("create dma_map thread failed\n");
 			ret = PTR_ERR(tsk[i]);
-			goto out;
+			while (--i >= 0)
+				kthread_stop(tsk[i]);
+			goto out_pool;
 		}
 
 		if (node != NUMA_NO_NODE)
@@ -146,6 +549,8 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	memset(map->map_hist, 0, sizeof(map->map_hist));
+	memset(map->unmap_hist, 0, sizeof(map->unmap_hist));
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -156,12 +561,16 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 
 	/* wait for the completion of benchmark threads */
 	for (i = 0; i < threads; i++) {
-		ret = kthread_stop(tsk[i]);
-		if (ret)
-			goto out;
+		int err = kthread_stop(tsk[i]);
+
+		if (err && !ret)
+			ret = err;
 	}
+	if (ret)
+		goto out;
 
 	loops = atomic64_read(&map->loops);
+	map->bparam.loops = loops;
 	if (likely(loops > 0)) {
 		u64 map_variance, unmap_variance;
 		u64 sum_map = atomic64_read(&map->sum_map_100ns);
@@ -182,11 +591,23 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		/* latency percentiles */
+		map_hist_percentiles(map->map_hist, loops,
+				     map->bparam.map_pct_ns);
+		map_hist_percentiles(map->unmap_hist, loops,
+				     map->bparam.unmap_pct_ns);
 	}
 
 out:
 	for (i = 0; i < threads; i++)
 		put_task_struct(tsk[i]);
+out_pool:
+	if (map->pool) {
+		dma_pool_destroy(map->pool);
+		map->pool = NULL;
+	}
+out_put:
 	put_device(map->dev);
 	kfree(tsk);
 	return ret;
@@ -224,6 +645,56 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.granule < 1 ||
+		    map->bparam.granule > DMA_MAP_MAX_GRANULE) {
+			pr_err("invalid granule size\n");
+			return -EINVAL;
+		}
+
+		switch (map->bparam.mode) {
+		case DMA_MAP_MODE_SINGLE:
+		case DMA_MAP_MODE_COHERENT:
+		case DMA_MAP_MODE_SYNC:
+			break;
+		case DMA_MAP_MODE_SG:
+			if (map->bparam.nents < 1 ||
+			    map->bparam.nents > DMA_MAP_MAX_NENTS ||
+			    map->bparam.nents * map->bparam.granule >
+			    DMA_MAP_MAX_GRANULE) {
+				pr_err("invalid number of segments\n");
+				return -EINVAL;
+			}
+			break;
+		case DMA_MAP_MODE_POOL:
+			if (map->bparam.nents < 1 ||
+			    map->bparam.nents > DMA_MAP_MAX_NENTS) {
+				pr_err("invalid number of pool blocks\n");
+				return -EINVAL;
+			}
+			if (map->bparam.pool_size < 1 ||
+			    map->bparam.pool_size > PAGE_SIZE ||
+			    (map->bparam.pool_align &&
+			     !is_power_of_2(map->bparam.pool_align))) {
+				pr_err("invalid pool block size or alignment\n");
+				return -EINVAL;
+			}
+			break;
+		case DMA_MAP_MODE_SWIOTLB:
+			if (!IS_ENABLED(CONFIG_SWIOTLB) || !is_swiotlb_active()) {
+				pr_err("swiotlb is not in use\n");
+				return -ENODEV;
+			}
+			if (map->bparam.granule * PAGE_SIZE >
+			    swiotlb_max_mapping_size(map->dev)) {
+				pr_err("granule too large for swiotlb\n");
+				return -EINVAL;
+			}
+			break;
+		default:
+			pr_err("invalid mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -291,6 +762,7 @@ static int __map_benchmark_probe(struct device *dev)
 	if (!map)
 		return -ENOMEM;
 	map->dev = dev;
+	mutex_init(&map->hist_lock);
 
 	ret = devm_add_action(dev, map_benchmark_remove_debugfs, map);
 	if (ret) {
@@ -334,6 +806,30 @@ static struct pci_driver map_benchmark_pci_driver = {
 	.probe	= map_benchmark_pci_probe,
 };
 
+/*
+ * A platform device without any DMA hardware behind it is enough to
+ * measure the cost of the DMA API itself, so optionally create one rather
+ * than having to unbind a real device from its driver.
+ */
+static bool dummy_device;
+module_param(dummy_device, bool, 0444);
+MODULE_PARM_DESC(dummy_device,
+		 "Create a platform device to run the benchmark on");
+
+static struct platform_device *map_benchmark_pdev;
+
+static int map_benchmark_create_dummy_device(void)
+{
+	struct platform_device_info info = {
+		.name		= "dma_map_benchmark",
+		.id		= PLATFORM_DEVID_NONE,
+		.dma_mask	= DMA_BIT_MASK(64),
+	};
+
+	map_benchmark_pdev = platform_device_register_full(&info);
+	return PTR_ERR_OR_ZERO(map_benchmark_pdev);
+}
+
 static int __init map_benchmark_init(void)
 {
 	int ret;
@@ -348,11 +844,22 @@ static int __init map_benchmark_init(void)
 		return ret;
 	}
 
+	if (dummy_device) {
+		ret = map_benchmark_create_dummy_device();
+		if (ret) {
+			platform_driver_unregister(&map_benchmark_platform_driver);
+			pci_unregister_driver(&map_benchmark_pci_driver);
+			return ret;
+		}
+	}
+
 	return 0;
 }
 
 static void __exit map_benchmark_cleanup(void)
 {
+	if (map_benchmark_pdev)
+		platform_device_unregister(map_benchmark_pdev);
 	platform_driver_unregister(&map_benchmark_platform_driver);
 	pci_unregister_driver(&map_benchmark_pci_driver);
 }
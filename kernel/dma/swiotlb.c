@@ -36,8 +36,11 @@
 #include <linux/scatterlist.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #endif
 
 #include <asm/io.h>
@@ -77,17 +80,36 @@ phys_addr_t io_tlb_start, io_tlb_end;
  */
 static unsigned long io_tlb_nslabs;
 
-/*
- * The number of used IO TLB block
- */
-static unsigned long io_tlb_used;
-
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The IO TLB is split into areas of io_tlb_area_nslabs slabs, each with its
+ * own lock, and mappings are allocated from the area of the current CPU
+ * first, so that CPUs mapping at the same time rarely contend. An area is
+ * a multiple of IO_TLB_SEGSIZE slabs, so no free list segment crosses two
+ * areas.
+ */
+struct io_tlb_area {
+	spinlock_t lock;
+	unsigned long used;		/* slabs in use */
+	unsigned int index;		/* where to start the next search */
+	unsigned long contended;	/* lock found held by someone else */
+	unsigned long full;		/* no room for a mapping */
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area *io_tlb_areas;
+static unsigned int io_tlb_nareas;
+static unsigned int io_tlb_area_nslabs;
+
+/* Number of areas asked for on the command line, 0 for one per CPU */
+static unsigned int io_tlb_nareas_param;
+
+/* Mappings that failed as no area had room for them */
+static atomic_t io_tlb_failed;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -102,11 +124,6 @@ static unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -119,6 +136,11 @@ setup_io_tlb_npages(char *str)
 	}
 	if (*str == ',')
 		++str;
+	if (isdigit(*str)) {
+		io_tlb_nareas_param = simple_strtoul(str, &str, 0);
+		if (*str == ',')
+			++str;
+	}
 	if (!strcmp(str, "force")) {
 		swiotlb_force = SWIOTLB_FORCE;
 	} else if (!strcmp(str, "noforce")) {
@@ -188,8 +210,52 @@ void swiotlb_print_info(void)
 		return;
 	}
 
-	pr_info("mapped [mem %pa-%pa] (%luMB)\n", &io_tlb_start, &io_tlb_end,
-	       bytes >> 20);
+	pr_info("mapped [mem %pa-%pa] (%luMB, %u areas)\n", &io_tlb_start,
+		&io_tlb_end, bytes >> 20, io_tlb_nareas);
+}
+
+/*
+ * Pick the number of areas for @nslabs slabs: a power of two, by default
+ * the number of possible CPUs rounded up, reduced until the slabs can be
+ * split evenly in areas made of whole segments.
+ */
+static unsigned int swiotlb_nr_areas(unsigned long nslabs)
+{
+	unsigned int nareas = io_tlb_nareas_param;
+
+	if (!nareas)
+		nareas = num_possible_cpus();
+	nareas = roundup_pow_of_two(nareas);
+
+	while (nareas > 1 && nslabs % ((unsigned long)nareas * IO_TLB_SEGSIZE))
+		nareas >>= 1;
+
+	return nareas;
+}
+
+static void swiotlb_init_areas(void)
+{
+	unsigned int i;
+
+	io_tlb_area_nslabs = io_tlb_nslabs / io_tlb_nareas;
+	for (i = 0; i < io_tlb_nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].used = 0;
+		io_tlb_areas[i].index = 0;
+		io_tlb_areas[i].contended = 0;
+		io_tlb_areas[i].full = 0;
+	}
+}
+
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+
+	return used;
 }
 
 /*
@@ -240,11 +306,18 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		panic("%s: Failed to allocate %zu bytes align=0x%lx\n",
 		      __func__, alloc_size, PAGE_SIZE);
 
+	io_tlb_nareas = swiotlb_nr_areas(io_tlb_nslabs);
+	alloc_size = array_size(io_tlb_nareas, sizeof(*io_tlb_areas));
+	io_tlb_areas = memblock_alloc(alloc_size, SMP_CACHE_BYTES);
+	if (!io_tlb_areas)
+		panic("%s: Failed to allocate %zu bytes align=0x%x\n",
+		      __func__, alloc_size, SMP_CACHE_BYTES);
+
 	for (i = 0; i < io_tlb_nslabs; i++) {
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	if (verbose)
@@ -340,6 +413,9 @@ static void swiotlb_cleanup(void)
 	io_tlb_end = 0;
 	io_tlb_start = 0;
 	io_tlb_nslabs = 0;
+	io_tlb_areas = NULL;
+	io_tlb_nareas = 0;
+	io_tlb_area_nslabs = 0;
 	max_segment = 0;
 }
 
@@ -374,11 +450,17 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 	if (!io_tlb_orig_addr)
 		goto cleanup4;
 
+	io_tlb_nareas = swiotlb_nr_areas(io_tlb_nslabs);
+	io_tlb_areas = kcalloc(io_tlb_nareas, sizeof(*io_tlb_areas),
+			       GFP_KERNEL);
+	if (!io_tlb_areas)
+		goto cleanup5;
+
 	for (i = 0; i < io_tlb_nslabs; i++) {
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 	no_iotlb_memory = false;
 
 	swiotlb_print_info();
@@ -389,6 +471,10 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 
 	return 0;
 
+cleanup5:
+	free_pages((unsigned long)io_tlb_orig_addr,
+		   get_order(io_tlb_nslabs * sizeof(phys_addr_t)));
+	io_tlb_orig_addr = NULL;
 cleanup4:
 	free_pages((unsigned long)io_tlb_list, get_order(io_tlb_nslabs *
 	                                                 sizeof(int)));
@@ -404,6 +490,7 @@ void __init swiotlb_exit(void)
 		return;
 
 	if (late_alloc) {
+		kfree(io_tlb_areas);
 		free_pages((unsigned long)io_tlb_orig_addr,
 			   get_order(io_tlb_nslabs * sizeof(phys_addr_t)));
 		free_pages((unsigned long)io_tlb_list, get_order(io_tlb_nslabs *
@@ -411,6 +498,9 @@ void __init swiotlb_exit(void)
 		free_pages((unsigned long)phys_to_virt(io_tlb_start),
 			   get_order(io_tlb_nslabs << IO_TLB_SHIFT));
 	} else {
+		memblock_free_late(__pa(io_tlb_areas),
+				   array_size(io_tlb_nareas,
+					      sizeof(*io_tlb_areas)));
 		memblock_free_late(__pa(io_tlb_orig_addr),
 				   PAGE_ALIGN(io_tlb_nslabs * sizeof(phys_addr_t)));
 		memblock_free_late(__pa(io_tlb_list),
@@ -461,19 +551,96 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Look for @nslots free slots in the area @area_index, and mark them used.
+ * Returns the index of the first slot, or -1 if the area has no room.
+ */
+static int swiotlb_area_find_slots(unsigned int area_index,
+		unsigned int nslots, unsigned int stride,
+		unsigned long offset_slots, unsigned long max_slots)
+{
+	struct io_tlb_area *area = &io_tlb_areas[area_index];
+	unsigned int area_start = area_index * io_tlb_area_nslabs;
+	unsigned int index, slot, step, scanned;
+	unsigned long flags;
+	int i, count = 0;
+
+	if (!spin_trylock_irqsave(&area->lock, flags)) {
+		spin_lock_irqsave(&area->lock, flags);
+		area->contended++;
+	}
+
+	if (unlikely(nslots > io_tlb_area_nslabs - area->used))
+		goto not_found;
+
+	/*
+	 * The area is a multiple of the stride, so wrapping around keeps the
+	 * index aligned.
+	 */
+	index = ALIGN(area->index, stride);
+	if (index >= io_tlb_area_nslabs)
+		index = 0;
+
+	for (scanned = 0; scanned < io_tlb_area_nslabs; scanned += step) {
+		slot = area_start + index;
+		step = stride;
+
+		if (!iommu_is_span_boundary(slot, nslots, offset_slots,
+					    max_slots)) {
+			/*
+			 * If we find a slot that indicates we have 'nslots'
+			 * number of contiguous buffers, we allocate the
+			 * buffers from that slot.
+			 */
+			if (io_tlb_list[slot] >= nslots)
+				goto found;
+
+			/*
+			 * The free run starting here is too short, and so are
+			 * all the runs starting inside of it: skip past it.
+			 */
+			if (io_tlb_list[slot])
+				step = ALIGN(io_tlb_list[slot], stride);
+		}
+
+		index += step;
+		if (index >= io_tlb_area_nslabs)
+			index -= io_tlb_area_nslabs;
+	}
+
+not_found:
+	area->full++;
+	spin_unlock_irqrestore(&area->lock, flags);
+	return -1;
+
+found:
+	/* Mark the entries as '0' indicating unavailable */
+	for (i = slot; i < (int) (slot + nslots); i++)
+		io_tlb_list[i] = 0;
+	for (i = slot - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+		io_tlb_list[i] = ++count;
+
+	/*
+	 * Update the indices to avoid searching in the next round.
+	 */
+	area->index = index + nslots < io_tlb_area_nslabs ? index + nslots : 0;
+	area->used += nslots;
+	spin_unlock_irqrestore(&area->lock, flags);
+
+	return slot;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev, phys_addr_t orig_addr,
 		size_t mapping_size, size_t alloc_size,
 		enum dma_data_direction dir, unsigned long attrs)
 {
 	dma_addr_t tbl_dma_addr = phys_to_dma_unencrypted(hwdev, io_tlb_start);
-	unsigned long flags;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, start, area;
+	int i, index;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
-	unsigned long tmp_io_tlb_used;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -514,67 +681,31 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev, phys_addr_t orig_addr,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request, starting with the area of this CPU and moving on to the
+	 * next ones if it has no room.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
+	if (unlikely(!io_tlb_nareas))
 		goto not_found;
 
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
+	start = raw_smp_processor_id() & (io_tlb_nareas - 1);
+	area = start;
 	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
+		index = swiotlb_area_find_slots(area, nslots, stride,
+						offset_slots, max_slots);
+		if (index >= 0)
 			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
+		if (++area >= io_tlb_nareas)
+			area = 0;
+	} while (area != start);
 
 not_found:
-	tmp_io_tlb_used = io_tlb_used;
-
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	atomic_inc(&io_tlb_failed);
 	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
 		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-			 alloc_size, io_tlb_nslabs, tmp_io_tlb_used);
+			 alloc_size, io_tlb_nslabs, swiotlb_used());
 	return (phys_addr_t)DMA_MAPPING_ERROR;
 found:
-	io_tlb_used += nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -600,6 +731,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	unsigned long flags;
 	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
+	struct io_tlb_area *area = &io_tlb_areas[index / io_tlb_area_nslabs];
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
 
 	/*
@@ -616,7 +748,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	spin_lock_irqsave(&area->lock, flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -635,9 +767,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
 
-		io_tlb_used -= nslots;
+		area->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -721,13 +853,41 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
+static int io_tlb_areas_show(struct seq_file *m, void *v)
+{
+	struct io_tlb_area *area;
+	unsigned int i;
+
+	seq_puts(m, "area       used  contended       full\n");
+	for (i = 0; i < io_tlb_nareas; i++) {
+		area = &io_tlb_areas[i];
+		seq_printf(m, "%4u %10lu %10lu %10lu\n", i,
+			   READ_ONCE(area->used), READ_ONCE(area->contended),
+			   READ_ONCE(area->full));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(io_tlb_areas);
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_used", 0400, root, NULL,
+				   &fops_io_tlb_used);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
+	debugfs_create_atomic_t("io_tlb_failed", 0400, root, &io_tlb_failed);
+	debugfs_create_file("io_tlb_areas", 0400, root, NULL,
+			    &io_tlb_areas_fops);
 	return 0;
 }
 
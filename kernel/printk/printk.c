@@ -42,6 +42,9 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -211,9 +214,6 @@ int devkmsg_sysctl_set_loglvl(struct ctl_table *table, int write,
 	return 0;
 }
 
-/* Number of registered extended console drivers. */
-static int nr_ext_console_drivers;
-
 /*
  * Helper macros to handle lockdep when locking/unlocking console_sem. We use
  * macros instead of functions so that _RET_IP_ contains useful information.
@@ -267,9 +267,27 @@ static void __up_console_sem(unsigned long ip)
 static int console_locked, console_suspended;
 
 /*
- * If exclusive_console is non-NULL then only this console is to be printed to.
+ * Once printk_kthreads_available is set, each console gets a kthread which
+ * prints to it at its own pace, and printk() callers only wake the kthreads
+ * up. The consoles without a kthread, counted in printk_nr_unthreaded, are
+ * still printed to by the console_lock owner, as are all consoles whenever
+ * printk_direct() says so.
  */
-static struct console *exclusive_console;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static bool printk_kthreads_available;
+static int printk_nr_unthreaded;
+
+/*
+ * Whether the console_lock owner has to print to all consoles, bypassing the
+ * printer kthreads: when they are not running yet, or when they cannot be
+ * relied upon to ever get scheduled again.
+ */
+static bool printk_direct(void)
+{
+	return !READ_ONCE(printk_kthreads_available) || oops_in_progress ||
+	       atomic_read(&panic_cpu) != PANIC_CPU_INVALID ||
+	       system_state > SYSTEM_RUNNING;
+}
 
 /*
  *	Array of consoles built from command line options (console=)
@@ -397,11 +415,6 @@ static u64 syslog_seq;
 static size_t syslog_partial;
 static bool syslog_time;
 
-/* the next printk record to write to the console */
-static u64 console_seq;
-static u64 exclusive_console_stop_seq;
-static unsigned long console_dropped;
-
 /* the next printk record to read after the last 'clear' command */
 static u64 clear_seq;
 
@@ -1815,47 +1828,31 @@ static int console_trylock_spinning(void)
 }
 
 /*
- * Call the console drivers, asking them to write out
- * log_buf[start] to log_buf[end - 1].
+ * Call a console driver, asking it to write out a formatted record, preceded
+ * by a notice of the records it missed if any.
  * The console_lock must be held.
  */
-static void call_console_drivers(const char *ext_text, size_t ext_len,
-				 const char *text, size_t len)
+static void call_console_driver(struct console *con, const char *text,
+				size_t len)
 {
 	static char dropped_text[64];
-	size_t dropped_len = 0;
-	struct console *con;
+	size_t dropped_len;
 
 	trace_console_rcuidle(text, len);
 
-	if (!console_drivers)
-		return;
-
-	if (console_dropped) {
-		dropped_len = snprintf(dropped_text, sizeof(dropped_text),
-				       "** %lu printk messages dropped **\n",
-				       console_dropped);
-		console_dropped = 0;
-	}
-
-	for_each_console(con) {
-		if (exclusive_console && con != exclusive_console)
-			continue;
-		if (!(con->flags & CON_ENABLED))
-			continue;
-		if (!con->write)
-			continue;
-		if (!cpu_online(smp_processor_id()) &&
-		    !(con->flags & CON_ANYTIME))
-			continue;
-		if (con->flags & CON_EXTENDED)
-			con->write(con, ext_text, ext_len);
-		else {
-			if (dropped_len)
-				con->write(con, dropped_text, dropped_len);
-			con->write(con, text, len);
+	if (con->dropped) {
+		/* Extended consoles see the gap in the sequence numbers. */
+		if (!(con->flags & CON_EXTENDED)) {
+			dropped_len = snprintf(dropped_text,
+					       sizeof(dropped_text),
+					       "** %lu printk messages dropped **\n",
+					       con->dropped);
+			con->write(con, dropped_text, dropped_len);
 		}
+		con->dropped = 0;
 	}
+
+	con->write(con, text, len);
 }
 
 int printk_delay_msec __read_mostly;
@@ -2051,6 +2048,12 @@ int vprintk_store(int facility, int level,
 	return (text_len + trunc_msg_len);
 }
 
+/* Whether printk() callers have to print to some consoles themselves */
+static bool printk_caller_prints(void)
+{
+	return printk_direct() || READ_ONCE(printk_nr_unthreaded);
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const struct dev_printk_info *dev_info,
 			    const char *fmt, va_list args)
@@ -2075,8 +2078,11 @@ asmlinkage int vprintk_emit(int facility, int level,
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 	printk_safe_exit_irqrestore(flags);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	/*
+	 * If called from the scheduler, we can not call up(). Otherwise only
+	 * print when some consoles have no printer kthread to do it for us.
+	 */
+	if (!in_sched && printk_caller_prints()) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2152,11 +2158,9 @@ EXPORT_SYMBOL(printk);
 
 #define prb_read_valid(rb, seq, r)	false
 #define prb_first_valid_seq(rb)		0
+#define prb_next_seq(rb)		0
 
 static u64 syslog_seq;
-static u64 console_seq;
-static u64 exclusive_console_stop_seq;
-static unsigned long console_dropped;
 
 static size_t record_print_text(const struct printk_record *r,
 				bool syslog, bool time)
@@ -2173,8 +2177,8 @@ static ssize_t msg_print_ext_body(char *buf, size_t size,
 				  struct dev_printk_info *dev_info) { return 0; }
 static void console_lock_spinning_enable(void) { }
 static int console_lock_spinning_disable_and_check(void) { return 0; }
-static void call_console_drivers(const char *ext_text, size_t ext_len,
-				 const char *text, size_t len) {}
+static void call_console_driver(struct console *con, const char *text,
+				size_t len) {}
 static bool suppress_message_printing(int level) { return false; }
 
 #endif /* CONFIG_PRINTK */
@@ -2351,6 +2355,7 @@ void resume_console(void)
 	down_console_sem();
 	console_suspended = 0;
 	console_unlock();
+	wake_up_interruptible_all(&printk_kthread_wait);
 }
 
 /**
@@ -2448,6 +2453,103 @@ static inline int can_use_console(void)
 	return cpu_online(raw_smp_processor_id()) || have_callable_console();
 }
 
+/* Whether @con is printed to by console_unlock() rather than its kthread */
+static bool console_printed_directly(struct console *con)
+{
+	return !con->thread || printk_direct();
+}
+
+static bool console_is_usable(struct console *con)
+{
+	if (!(con->flags & CON_ENABLED) || !con->write)
+		return false;
+
+	return cpu_online(raw_smp_processor_id()) || (con->flags & CON_ANYTIME);
+}
+
+/*
+ * Print the next record of @con, skipping the records above the console
+ * loglevel. Returns false if there was no record left to print.
+ *
+ * If @handover is not NULL, another printk() caller may take over the
+ * console_lock while the console driver is called; *@handover is then set
+ * and the console_lock is not held anymore on return.
+ *
+ * The console_lock must be held.
+ */
+static bool console_emit_next_record(struct console *con, bool *handover)
+{
+	static char ext_text[CONSOLE_EXT_LOG_MAX];
+	static char text[LOG_LINE_MAX + PREFIX_MAX];
+	struct printk_info info;
+	struct printk_record r;
+	unsigned long flags;
+	char *write_text;
+	size_t len;
+
+	prb_rec_init_rd(&r, &info, text, sizeof(text));
+
+	if (handover)
+		*handover = false;
+
+	printk_safe_enter_irqsave(flags);
+	raw_spin_lock(&logbuf_lock);
+skip:
+	if (!prb_read_valid(prb, con->seq, &r)) {
+		raw_spin_unlock(&logbuf_lock);
+		printk_safe_exit_irqrestore(flags);
+		return false;
+	}
+
+	if (con->seq != r.info->seq) {
+		con->dropped += r.info->seq - con->seq;
+		con->lost += r.info->seq - con->seq;
+		con->seq = r.info->seq;
+	}
+
+	/* Skip record that has level above the console loglevel. */
+	if (suppress_message_printing(r.info->level)) {
+		con->seq++;
+		goto skip;
+	}
+
+	if (con->flags & CON_EXTENDED) {
+		write_text = ext_text;
+		len = info_print_ext_header(ext_text, sizeof(ext_text), r.info);
+		len += msg_print_ext_body(ext_text + len,
+					  sizeof(ext_text) - len,
+					  &r.text_buf[0], r.info->text_len,
+					  &r.info->dev_info);
+	} else {
+		write_text = text;
+		len = record_print_text(&r,
+				console_msg_format & MSG_FORMAT_SYSLOG,
+				printk_time);
+	}
+	con->seq++;
+	raw_spin_unlock(&logbuf_lock);
+
+	/*
+	 * While actively printing out messages, if another printk()
+	 * were to occur on another CPU, it may wait for this one to
+	 * finish. This task can not be preempted if there is a
+	 * waiter waiting to take over.
+	 */
+	if (handover)
+		console_lock_spinning_enable();
+
+	stop_critical_timings();	/* don't trace print latency */
+	call_console_driver(con, write_text, len);
+	start_critical_timings();
+
+	if (handover)
+		*handover = console_lock_spinning_disable_and_check();
+
+	printk_safe_exit_irqrestore(flags);
+
+	return true;
+}
+
 /**
  * console_unlock - unlock the console system
  *
@@ -2456,7 +2558,8 @@ static inline int can_use_console(void)
  *
  * While the console_lock was held, console output may have been buffered
  * by printk().  If this is the case, console_unlock(); emits
- * the output prior to releasing the lock.
+ * the output prior to releasing the lock, to the consoles which have no
+ * printer kthread, or to all of them if printk_direct() is true.
  *
  * If there is output waiting, we wake /dev/kmsg and syslog() users.
  *
@@ -2464,20 +2567,16 @@ static inline int can_use_console(void)
  */
 void console_unlock(void)
 {
-	static char ext_text[CONSOLE_EXT_LOG_MAX];
-	static char text[LOG_LINE_MAX + PREFIX_MAX];
+	bool do_cond_resched, progress, handover, retry;
+	struct console *con;
 	unsigned long flags;
-	bool do_cond_resched, retry;
-	struct printk_info info;
-	struct printk_record r;
+	u64 next_seq;
 
 	if (console_suspended) {
 		up_console_sem();
 		return;
 	}
 
-	prb_rec_init_rd(&r, &info, text, sizeof(text));
-
 	/*
 	 * Console drivers are called with interrupts disabled, so
 	 * @console_may_schedule should be cleared before; however, we may
@@ -2507,94 +2606,53 @@ void console_unlock(void)
 		return;
 	}
 
-	for (;;) {
-		size_t ext_len = 0;
-		size_t len;
-
-		printk_safe_enter_irqsave(flags);
-		raw_spin_lock(&logbuf_lock);
-skip:
-		if (!prb_read_valid(prb, console_seq, &r))
-			break;
-
-		if (console_seq != r.info->seq) {
-			console_dropped += r.info->seq - console_seq;
-			console_seq = r.info->seq;
-		}
-
-		if (suppress_message_printing(r.info->level)) {
-			/*
-			 * Skip record we have buffered and already printed
-			 * directly to the console when we received it, and
-			 * record that has level above the console loglevel.
-			 */
-			console_seq++;
-			goto skip;
-		}
-
-		/* Output to all consoles once old messages replayed. */
-		if (unlikely(exclusive_console &&
-			     console_seq >= exclusive_console_stop_seq)) {
-			exclusive_console = NULL;
-		}
+	/*
+	 * Print one record to each console in turn, so that the consoles
+	 * replaying the log buffer do not hold the others back.
+	 */
+	do {
+		progress = false;
 
-		/*
-		 * Handle extended console text first because later
-		 * record_print_text() will modify the record buffer in-place.
-		 */
-		if (nr_ext_console_drivers) {
-			ext_len = info_print_ext_header(ext_text,
-						sizeof(ext_text),
-						r.info);
-			ext_len += msg_print_ext_body(ext_text + ext_len,
-						sizeof(ext_text) - ext_len,
-						&r.text_buf[0],
-						r.info->text_len,
-						&r.info->dev_info);
-		}
-		len = record_print_text(&r,
-				console_msg_format & MSG_FORMAT_SYSLOG,
-				printk_time);
-		console_seq++;
-		raw_spin_unlock(&logbuf_lock);
+		for_each_console(con) {
+			if (!console_is_usable(con) ||
+			    !console_printed_directly(con))
+				continue;
 
-		/*
-		 * While actively printing out messages, if another printk()
-		 * were to occur on another CPU, it may wait for this one to
-		 * finish. This task can not be preempted if there is a
-		 * waiter waiting to take over.
-		 */
-		console_lock_spinning_enable();
+			if (!console_emit_next_record(con, &handover))
+				continue;
+			if (handover)
+				return;
 
-		stop_critical_timings();	/* don't trace print latency */
-		call_console_drivers(ext_text, ext_len, text, len);
-		start_critical_timings();
+			progress = true;
 
-		if (console_lock_spinning_disable_and_check()) {
-			printk_safe_exit_irqrestore(flags);
-			return;
+			if (do_cond_resched)
+				cond_resched();
 		}
+	} while (progress);
 
-		printk_safe_exit_irqrestore(flags);
-
-		if (do_cond_resched)
-			cond_resched();
+	/* Find where to look for new records once the lock is dropped. */
+	next_seq = U64_MAX;
+	for_each_console(con) {
+		if (console_is_usable(con) && console_printed_directly(con))
+			next_seq = min(next_seq, con->seq);
 	}
 
 	console_locked = 0;
 
-	raw_spin_unlock(&logbuf_lock);
-
 	up_console_sem();
 
+	if (next_seq == U64_MAX)
+		return;
+
 	/*
 	 * Someone could have filled up the buffer again, so re-check if there's
 	 * something to flush. In case we cannot trylock the console_sem again,
 	 * there's a new owner and the console_unlock() from them will do the
 	 * flush, no worries.
 	 */
+	printk_safe_enter_irqsave(flags);
 	raw_spin_lock(&logbuf_lock);
-	retry = prb_read_valid(prb, console_seq, NULL);
+	retry = prb_read_valid(prb, next_seq, NULL);
 	raw_spin_unlock(&logbuf_lock);
 	printk_safe_exit_irqrestore(flags);
 
@@ -2661,9 +2719,11 @@ void console_flush_on_panic(enum con_flush_mode mode)
 
 	if (mode == CONSOLE_REPLAY_ALL) {
 		unsigned long flags;
+		struct console *c;
 
 		logbuf_lock_irqsave(flags);
-		console_seq = prb_first_valid_seq(prb);
+		for_each_console(c)
+			c->seq = prb_first_valid_seq(prb);
 		logbuf_unlock_irqrestore(flags);
 	}
 	console_unlock();
@@ -2707,9 +2767,128 @@ void console_start(struct console *console)
 	console_lock();
 	console->flags |= CON_ENABLED;
 	console_unlock();
+	wake_up_interruptible_all(&printk_kthread_wait);
 }
 EXPORT_SYMBOL(console_start);
 
+static bool printk_kthread_should_wakeup(struct console *con)
+{
+	unsigned long flags;
+	bool ret;
+
+	if (kthread_should_stop())
+		return true;
+
+	if (console_suspended || printk_direct() || !console_is_usable(con))
+		return false;
+
+	/* Only the console_lock owner moves con->seq, a stale value is fine. */
+	printk_safe_enter_irqsave(flags);
+	raw_spin_lock(&logbuf_lock);
+	ret = prb_read_valid(prb, READ_ONCE(con->seq), NULL);
+	raw_spin_unlock(&logbuf_lock);
+	printk_safe_exit_irqrestore(flags);
+
+	return ret;
+}
+
+/*
+ * The console_lock is taken for each record rather than for a batch of them,
+ * so that printing to a slow console never delays for long a printk() caller
+ * which has to print to the unthreaded consoles, or anyone else waiting for
+ * the console_lock.
+ */
+static int printk_kthread_func(void *data)
+{
+	struct console *con = data;
+
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 printk_kthread_should_wakeup(con));
+
+		if (kthread_should_stop())
+			break;
+
+		console_lock();
+		if (!console_suspended && !printk_direct() &&
+		    console_is_usable(con))
+			console_emit_next_record(con, NULL);
+		console_unlock();
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/* The console_lock must be held. */
+static void printk_start_kthread(struct console *con)
+{
+	struct task_struct *thread;
+
+	if (!printk_kthreads_available || (con->flags & CON_BOOT))
+		return;
+
+	thread = kthread_run(printk_kthread_func, con, "pr/%s%d",
+			     con->name, con->index);
+	if (IS_ERR(thread)) {
+		pr_err("console [%s%d]: unable to start printing thread\n",
+		       con->name, con->index);
+		return;
+	}
+
+	con->thread = thread;
+}
+
+/* The console_lock must be held. */
+static void printk_update_unthreaded(void)
+{
+	struct console *con;
+	int nr = 0;
+
+	for_each_console(con) {
+		if (!con->thread)
+			nr++;
+	}
+
+	WRITE_ONCE(printk_nr_unthreaded, nr);
+}
+
+#if defined(CONFIG_PRINTK) && defined(CONFIG_DEBUG_FS)
+/* Where each console stands in the log buffer, and what it missed so far */
+static int printk_consoles_show(struct seq_file *m, void *v)
+{
+	struct console *con;
+	char name[24];
+	u64 next_seq;
+
+	seq_puts(m, "console             pid          seq          lag         lost\n");
+
+	console_lock();
+	next_seq = prb_next_seq(prb);
+	for_each_console(con) {
+		snprintf(name, sizeof(name), "%s%d", con->name, con->index);
+		seq_printf(m, "%-16s %6d %12llu %12llu %12lu\n", name,
+			   con->thread ? task_pid_nr(con->thread) : 0,
+			   con->seq,
+			   next_seq > con->seq ? next_seq - con->seq : 0,
+			   con->lost);
+	}
+	console_unlock();
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(printk_consoles);
+
+static void __init printk_debugfs_init(void)
+{
+	debugfs_create_file("printk_consoles", 0400, NULL, NULL,
+			    &printk_consoles_fops);
+}
+#else
+static inline void printk_debugfs_init(void) { }
+#endif
+
 static int __read_mostly keep_bootcon;
 
 static int __init keep_bootcon_setup(char *str)
@@ -2885,29 +3064,27 @@ void register_console(struct console *newcon)
 		console_drivers->next = newcon;
 	}
 
-	if (newcon->flags & CON_EXTENDED)
-		nr_ext_console_drivers++;
+	/*
+	 * The new console replays the log buffer on its own, if asked to, or
+	 * picks up where the boot console it replaces stands. The other
+	 * consoles are not affected. Update the sequence number with
+	 * disabled interrupts to reduce the race window with an eventual
+	 * console_flush_on_panic() that ignores console_lock.
+	 */
+	logbuf_lock_irqsave(flags);
+	newcon->dropped = 0;
+	newcon->lost = 0;
+	if (newcon->flags & CON_PRINTBUFFER)
+		newcon->seq = syslog_seq;
+	else if (bcon)
+		newcon->seq = bcon->seq;
+	else
+		newcon->seq = prb_next_seq(prb);
+	logbuf_unlock_irqrestore(flags);
 
-	if (newcon->flags & CON_PRINTBUFFER) {
-		/*
-		 * console_unlock(); will print out the buffered messages
-		 * for us.
-		 */
-		logbuf_lock_irqsave(flags);
-		/*
-		 * We're about to replay the log buffer.  Only do this to the
-		 * just-registered console to avoid excessive message spam to
-		 * the already-registered consoles.
-		 *
-		 * Set exclusive_console with disabled interrupts to reduce
-		 * race window with eventual console_flush_on_panic() that
-		 * ignores console_lock.
-		 */
-		exclusive_console = newcon;
-		exclusive_console_stop_seq = console_seq;
-		console_seq = syslog_seq;
-		logbuf_unlock_irqrestore(flags);
-	}
+	newcon->thread = NULL;
+	printk_start_kthread(newcon);
+	printk_update_unthreaded();
 	console_unlock();
 	console_sysfs_notify();
 
@@ -2936,6 +3113,7 @@ EXPORT_SYMBOL(register_console);
 
 int unregister_console(struct console *console)
 {
+	struct task_struct *thread;
 	struct console *con;
 	int res;
 
@@ -2949,6 +3127,18 @@ int unregister_console(struct console *console)
 	if (res > 0)
 		return 0;
 
+	/*
+	 * Stop the printer kthread first, it may be waiting for the
+	 * console_lock and is not allowed to touch @console afterwards.
+	 */
+	console_lock();
+	thread = console->thread;
+	console->thread = NULL;
+	printk_update_unthreaded();
+	console_unlock();
+	if (thread)
+		kthread_stop(thread);
+
 	res = -ENODEV;
 	console_lock();
 	if (console_drivers == console) {
@@ -2967,9 +3157,6 @@ int unregister_console(struct console *console)
 	if (res)
 		goto out_disable_unlock;
 
-	if (console->flags & CON_EXTENDED)
-		nr_ext_console_drivers--;
-
 	/*
 	 * If this isn't the last console and it has CON_CONSDEV set, we
 	 * need to set it on the next preferred console.
@@ -3063,6 +3250,16 @@ static int __init printk_late_init(void)
 			unregister_console(con);
 		}
 	}
+
+	console_lock();
+	WRITE_ONCE(printk_kthreads_available, true);
+	for_each_console(con)
+		printk_start_kthread(con);
+	printk_update_unthreaded();
+	console_unlock();
+
+	printk_debugfs_init();
+
 	ret = cpuhp_setup_state_nocalls(CPUHP_PRINTK_DEAD, "printk:dead", NULL,
 					console_cpu_notify);
 	WARN_ON(ret < 0);
@@ -3094,6 +3291,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_WAKEUP)
 		wake_up_interruptible(&log_wait);
+
+	/*
+	 * Records stored for deferred output, e.g. from NMI, must reach the
+	 * threaded consoles too: console_unlock() only prints to the others.
+	 */
+	if (pending & (PRINTK_PENDING_WAKEUP | PRINTK_PENDING_OUTPUT))
+		wake_up_interruptible_all(&printk_kthread_wait);
 }
 
 static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) =
@@ -3105,7 +3309,8 @@ void wake_up_klogd(void)
 		return;
 
 	preempt_disable();
-	if (waitqueue_active(&log_wait)) {
+	if (waitqueue_active(&log_wait) ||
+	    wq_has_sleeper(&printk_kthread_wait)) {
 		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 		irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
 	}
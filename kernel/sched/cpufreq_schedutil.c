@@ -15,6 +15,29 @@
 
 #define IOWAIT_BOOST_MIN	(SCHED_CAPACITY_SCALE / 8)
 
+/* Frequency requests are counted in that many equal slices of [0, max_freq] */
+#define SUGOV_FREQ_HIST_SLOTS	16
+
+/*
+ * Per-policy decision counters, reported in debugfs under
+ * schedutil/policy<cpu>/ and reset whenever the governor is started. They are
+ * updated under the same serialization as the fields they describe.
+ */
+struct sugov_stats {
+	unsigned long		updates;	/* utilization updates */
+	unsigned long		rate_limited;	/* updates within rate_limit_us */
+	unsigned long		cached;		/* raw frequency unchanged */
+	unsigned long		unchanged;	/* same frequency requested */
+	unsigned long		iowait_boosts;	/* iowait boosts raised */
+	unsigned long		fast_switches;
+	u64			fast_switch_ns;	/* total time in the driver */
+	u64			fast_switch_max_ns;
+	unsigned long		deferred;	/* sugov_work() runs */
+	u64			deferred_ns;	/* total time from request to driver return */
+	u64			deferred_max_ns;
+	unsigned long		freq_hist[SUGOV_FREQ_HIST_SLOTS];
+};
+
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
@@ -42,6 +65,10 @@ struct sugov_policy {
 
 	bool			limits_changed;
 	bool			need_freq_update;
+
+	u64			work_queued_ns;	/* Protected by update_lock */
+	struct sugov_stats	stats;
+	struct dentry		*debugfs_dir;
 };
 
 struct sugov_cpu {
@@ -89,6 +116,8 @@ static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
 	if (!cpufreq_this_cpu_can_update(sg_policy->policy))
 		return false;
 
+	sg_policy->stats.updates++;
+
 	if (unlikely(sg_policy->limits_changed)) {
 		sg_policy->limits_changed = false;
 		sg_policy->need_freq_update = true;
@@ -97,28 +126,52 @@ static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
 
 	delta_ns = time - sg_policy->last_freq_update_time;
 
-	return delta_ns >= sg_policy->freq_update_delay_ns;
+	if (delta_ns < sg_policy->freq_update_delay_ns) {
+		sg_policy->stats.rate_limited++;
+		return false;
+	}
+
+	return true;
 }
 
 static bool sugov_update_next_freq(struct sugov_policy *sg_policy, u64 time,
 				   unsigned int next_freq)
 {
-	if (sg_policy->need_freq_update)
+	struct sugov_stats *stats = &sg_policy->stats;
+	unsigned int max_freq = sg_policy->policy->cpuinfo.max_freq;
+
+	if (sg_policy->need_freq_update) {
 		sg_policy->need_freq_update = cpufreq_driver_test_flags(CPUFREQ_NEED_UPDATE_LIMITS);
-	else if (sg_policy->next_freq == next_freq)
+	} else if (sg_policy->next_freq == next_freq) {
+		stats->unchanged++;
 		return false;
+	}
 
 	sg_policy->next_freq = next_freq;
 	sg_policy->last_freq_update_time = time;
 
+	stats->freq_hist[min_t(u64, (u64)next_freq * SUGOV_FREQ_HIST_SLOTS /
+				    (max_freq + 1), SUGOV_FREQ_HIST_SLOTS - 1)]++;
+
 	return true;
 }
 
 static void sugov_fast_switch(struct sugov_policy *sg_policy, u64 time,
 			      unsigned int next_freq)
 {
-	if (sugov_update_next_freq(sg_policy, time, next_freq))
-		cpufreq_driver_fast_switch(sg_policy->policy, next_freq);
+	struct sugov_stats *stats = &sg_policy->stats;
+	u64 start, delta;
+
+	if (!sugov_update_next_freq(sg_policy, time, next_freq))
+		return;
+
+	start = local_clock();
+	cpufreq_driver_fast_switch(sg_policy->policy, next_freq);
+	delta = local_clock() - start;
+
+	stats->fast_switches++;
+	stats->fast_switch_ns += delta;
+	stats->fast_switch_max_ns = max(stats->fast_switch_max_ns, delta);
 }
 
 static void sugov_deferred_update(struct sugov_policy *sg_policy, u64 time,
@@ -129,6 +182,7 @@ static void sugov_deferred_update(struct sugov_policy *sg_policy, u64 time,
 
 	if (!sg_policy->work_in_progress) {
 		sg_policy->work_in_progress = true;
+		sg_policy->work_queued_ns = ktime_get_ns();
 		irq_work_queue(&sg_policy->irq_work);
 	}
 }
@@ -164,8 +218,10 @@ static unsigned int get_next_freq(struct sugov_policy *sg_policy,
 
 	freq = map_util_freq(util, freq, max);
 
-	if (freq == sg_policy->cached_raw_freq && !sg_policy->need_freq_update)
+	if (freq == sg_policy->cached_raw_freq && !sg_policy->need_freq_update) {
+		sg_policy->stats.cached++;
 		return sg_policy->next_freq;
+	}
 
 	sg_policy->cached_raw_freq = freq;
 	return cpufreq_driver_resolve_freq(policy, freq);
@@ -346,6 +402,7 @@ static void sugov_iowait_boost(struct sugov_cpu *sg_cpu, u64 time,
 	if (sg_cpu->iowait_boost_pending)
 		return;
 	sg_cpu->iowait_boost_pending = true;
+	sg_cpu->sg_policy->stats.iowait_boosts++;
 
 	/* Double the boost at each request */
 	if (sg_cpu->iowait_boost) {
@@ -574,8 +631,10 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 static void sugov_work(struct kthread_work *work)
 {
 	struct sugov_policy *sg_policy = container_of(work, struct sugov_policy, work);
+	struct sugov_stats *stats = &sg_policy->stats;
 	unsigned int freq;
 	unsigned long flags;
+	u64 queued, delta;
 
 	/*
 	 * Hold sg_policy->update_lock shortly to handle the case where:
@@ -589,11 +648,18 @@ static void sugov_work(struct kthread_work *work)
 	 */
 	raw_spin_lock_irqsave(&sg_policy->update_lock, flags);
 	freq = sg_policy->next_freq;
+	queued = sg_policy->work_queued_ns;
 	sg_policy->work_in_progress = false;
 	raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags);
 
 	mutex_lock(&sg_policy->work_lock);
 	__cpufreq_driver_target(sg_policy->policy, freq, CPUFREQ_RELATION_L);
+
+	/* The latency of the deferred path, irq_work and kthread included */
+	delta = ktime_get_ns() - queued;
+	stats->deferred++;
+	stats->deferred_ns += delta;
+	stats->deferred_max_ns = max(stats->deferred_max_ns, delta);
 	mutex_unlock(&sg_policy->work_lock);
 }
 
@@ -658,6 +724,69 @@ static struct kobj_type sugov_tunables_ktype = {
 
 struct cpufreq_governor schedutil_gov;
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *sugov_debugfs_root;
+
+/* One "<from kHz> <to kHz> <requests>" line per slot */
+static int sugov_freq_histogram_show(struct seq_file *s, void *unused)
+{
+	struct sugov_policy *sg_policy = s->private;
+	u64 max_freq = sg_policy->policy->cpuinfo.max_freq + 1;
+	int i;
+
+	for (i = 0; i < SUGOV_FREQ_HIST_SLOTS; i++)
+		seq_printf(s, "%llu %llu %lu\n",
+			   div_u64(max_freq * i, SUGOV_FREQ_HIST_SLOTS),
+			   div_u64(max_freq * (i + 1), SUGOV_FREQ_HIST_SLOTS) - 1,
+			   READ_ONCE(sg_policy->stats.freq_hist[i]));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sugov_freq_histogram);
+
+/*
+ * The counters are read without synchronization with the updates, a set of
+ * values read from several files may thus be slightly inconsistent.
+ * Called with global_tunables_lock held.
+ */
+static void sugov_debugfs_add(struct sugov_policy *sg_policy)
+{
+	struct sugov_stats *stats = &sg_policy->stats;
+	struct dentry *d;
+
+	if (!sugov_debugfs_root)
+		sugov_debugfs_root = debugfs_create_dir("schedutil", NULL);
+
+	d = debugfs_create_dir(kobject_name(&sg_policy->policy->kobj),
+			       sugov_debugfs_root);
+	sg_policy->debugfs_dir = d;
+
+	debugfs_create_ulong("updates", 0444, d, &stats->updates);
+	debugfs_create_ulong("rate_limited", 0444, d, &stats->rate_limited);
+	debugfs_create_ulong("cached", 0444, d, &stats->cached);
+	debugfs_create_ulong("unchanged", 0444, d, &stats->unchanged);
+	debugfs_create_ulong("iowait_boosts", 0444, d, &stats->iowait_boosts);
+	debugfs_create_ulong("fast_switches", 0444, d, &stats->fast_switches);
+	debugfs_create_u64("fast_switch_ns", 0444, d, &stats->fast_switch_ns);
+	debugfs_create_u64("fast_switch_max_ns", 0444, d,
+			   &stats->fast_switch_max_ns);
+	debugfs_create_ulong("deferred", 0444, d, &stats->deferred);
+	debugfs_create_u64("deferred_ns", 0444, d, &stats->deferred_ns);
+	debugfs_create_u64("deferred_max_ns", 0444, d, &stats->deferred_max_ns);
+	debugfs_create_file("freq_histogram", 0444, d, sg_policy,
+			    &sugov_freq_histogram_fops);
+}
+
+static void sugov_debugfs_remove(struct sugov_policy *sg_policy)
+{
+	debugfs_remove_recursive(sg_policy->debugfs_dir);
+	sg_policy->debugfs_dir = NULL;
+}
+#else /* CONFIG_DEBUG_FS */
+static void sugov_debugfs_add(struct sugov_policy *sg_policy) {}
+static void sugov_debugfs_remove(struct sugov_policy *sg_policy) {}
+#endif
+
 static struct sugov_policy *sugov_policy_alloc(struct cpufreq_policy *policy)
 {
 	struct sugov_policy *sg_policy;
@@ -813,6 +942,7 @@ static int sugov_init(struct cpufreq_policy *policy)
 		goto fail;
 
 out:
+	sugov_debugfs_add(sg_policy);
 	mutex_unlock(&global_tunables_lock);
 	return 0;
 
@@ -843,6 +973,8 @@ static void sugov_exit(struct cpufreq_policy *policy)
 
 	mutex_lock(&global_tunables_lock);
 
+	sugov_debugfs_remove(sg_policy);
+
 	count = gov_attr_set_put(&tunables->attr_set, &sg_policy->tunables_hook);
 	policy->governor_data = NULL;
 	if (!count)
@@ -868,6 +1000,8 @@ static int sugov_start(struct cpufreq_policy *policy)
 	sg_policy->limits_changed		= false;
 	sg_policy->cached_raw_freq		= 0;
 
+	memset(&sg_policy->stats, 0, sizeof(sg_policy->stats));
+
 	sg_policy->need_freq_update = cpufreq_driver_test_flags(CPUFREQ_NEED_UPDATE_LIMITS);
 
 	for_each_cpu(cpu, policy->cpus) {
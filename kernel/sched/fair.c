@@ -5498,6 +5498,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct sched_entity *se = &p->se;
 	int idle_h_nr_running = task_has_idle_policy(p);
 	int task_new = !(flags & ENQUEUE_WAKEUP);
+	bool was_sched_idle = sched_idle_rq(rq);
 
 	/*
 	 * The code below (indirectly) updates schedutil which looks at
@@ -5556,6 +5557,9 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	/* At this point se is NULL and we are at root level*/
 	add_nr_running(rq, 1);
 
+	if (unlikely(was_sched_idle && !sched_idle_rq(rq)))
+		update_idle_cpumask(rq, false);
+
 	/*
 	 * Since new tasks are assigned an initial util_avg equal to
 	 * half of the spare capacity of their CPU, tiny tasks have the
@@ -5655,8 +5659,10 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	sub_nr_running(rq, 1);
 
 	/* balance early to pull high priority tasks */
-	if (unlikely(!was_sched_idle && sched_idle_rq(rq)))
+	if (unlikely(!was_sched_idle && sched_idle_rq(rq))) {
 		rq->next_balance = jiffies;
+		update_idle_cpumask(rq, false);
+	}
 
 dequeue_throttle:
 	util_est_dequeue(&rq->cfs, p, task_sleep);
@@ -6136,10 +6142,41 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Maintain this CPU's bit in sd_llc_shared->idle_cpus as it enters and leaves
+ * the idle task (@idle), and as its runqueue starts and stops having only
+ * SCHED_IDLE tasks. Tasks of other classes do not clear the bit of such a
+ * runqueue: a stale bit only costs select_idle_cpu() one extra check.
+ *
+ * The mask is maintained whether SIS_MASK is enabled or not, so that it is
+ * up to date when the feature gets enabled. It is shared by the whole LLC, so
+ * only write to it when the bit actually changes.
+ */
+void update_idle_cpumask(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+
+	idle = idle || sched_idle_rq(rq);
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds && cpumask_test_cpu(cpu, sds_idle_cpus(sds)) != idle) {
+		if (idle)
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		else
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+	rcu_read_unlock();
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
  * average idle time for this rq (as found in rq->avg_idle).
+ *
+ * With SIS_MASK, only the CPUs flagged in sd_llc_shared->idle_cpus, idle or
+ * only running SCHED_IDLE tasks, are scanned.
  */
 static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int target)
 {
@@ -6148,7 +6185,7 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	u64 avg_cost, avg_idle;
 	u64 time;
 	int this = smp_processor_id();
-	int cpu, nr = INT_MAX;
+	int cpu, nr = INT_MAX, scanned = 0;
 
 	this_sd = rcu_dereference(*this_cpu_ptr(&sd_llc));
 	if (!this_sd)
@@ -6175,14 +6212,25 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	time = cpu_clock(this);
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
+	if (sched_feat(SIS_MASK) && sd->shared)
+		cpumask_and(cpus, cpus, sds_idle_cpus(sd->shared));
+
+	schedstat_inc(this_rq()->sis_search);
 
 	for_each_cpu_wrap(cpu, cpus, target) {
-		if (!--nr)
+		if (!--nr) {
+			schedstat_add(this_rq()->sis_scanned, scanned);
 			return -1;
+		}
+		scanned++;
 		if (available_idle_cpu(cpu) || sched_idle_cpu(cpu))
 			break;
 	}
 
+	schedstat_add(this_rq()->sis_scanned, scanned);
+	if ((unsigned int)cpu < nr_cpumask_bits)
+		schedstat_inc(this_rq()->sis_found);
+
 	time = cpu_clock(this) - time;
 	update_avg(&this_sd->avg_scan_cost, time);
 
@@ -57,6 +57,13 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(SIS_AVG_CPU, false)
 SCHED_FEAT(SIS_PROP, true)
 
+/*
+ * When looking for an idle CPU in the LLC domain, only scan the CPUs which
+ * went idle, or only have SCHED_IDLE tasks, and did not leave that state
+ * since, see sched_domain_shared::idle_cpus.
+ */
+SCHED_FEAT(SIS_MASK, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -1049,6 +1049,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* select_idle_cpu() stats */
+	unsigned int		sis_search;
+	unsigned int		sis_scanned;
+	unsigned int		sis_found;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1112,6 +1117,12 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(struct rq *rq, bool idle);
+#else
+static inline void update_idle_cpumask(struct rq *rq, bool idle) { }
+#endif
+
 DECLARE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
 #define cpu_rq(cpu)		(&per_cpu(runqueues, (cpu)))
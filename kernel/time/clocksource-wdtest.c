@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test clocksource for the clocksource watchdog
+ *
+ * Registers a clocksource which the watchdog has to verify. It runs off the
+ * raw monotonic clock, with a skew which can be injected at runtime:
+ *
+ *   /sys/module/clocksource_wdtest/parameters/skew_ppm: drift rate
+ *   /sys/module/clocksource_wdtest/parameters/jump_us: step applied once,
+ *							 on the next read
+ *
+ * The skews seen by the watchdog are shown in
+ * /sys/devices/system/clocksource/clocksource0/watchdog_skew.
+ */
+
+#include <linux/clocksource.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+
+/* Keep the clocksource monotonic */
+#define WDTEST_MAX_SKEW_PPM	500000
+
+static int skew_ppm;
+module_param(skew_ppm, int, 0644);
+MODULE_PARM_DESC(skew_ppm, "Drift rate of the test clocksource, in ppm");
+
+static unsigned int jump_us;
+module_param(jump_us, uint, 0644);
+MODULE_PARM_DESC(jump_us, "Step the test clocksource by this many us once");
+
+static DEFINE_RAW_SPINLOCK(wdtest_lock);
+static u64 wdtest_last_raw;
+static u64 wdtest_value;
+
+static u64 wdtest_read(struct clocksource *cs)
+{
+	unsigned long flags;
+	u64 now, delta, ret;
+	int ppm;
+
+	ppm = clamp(READ_ONCE(skew_ppm), -WDTEST_MAX_SKEW_PPM,
+		    WDTEST_MAX_SKEW_PPM);
+
+	raw_spin_lock_irqsave(&wdtest_lock, flags);
+	now = ktime_get_raw_fast_ns();
+	delta = now - wdtest_last_raw;
+	wdtest_last_raw = now;
+
+	wdtest_value += delta + div_s64((s64)delta * ppm, USEC_PER_SEC);
+	wdtest_value += (u64)xchg(&jump_us, 0) * NSEC_PER_USEC;
+	ret = wdtest_value;
+	raw_spin_unlock_irqrestore(&wdtest_lock, flags);
+
+	return ret;
+}
+
+/*
+ * wdtest_read() relies on the timekeeping clocksource, so refuse to become it:
+ * the watchdog does not enable the clocksources it reads.
+ */
+static int wdtest_enable(struct clocksource *cs)
+{
+	return -EBUSY;
+}
+
+static struct clocksource clocksource_wdtest = {
+	.name		= "wdtest",
+	.rating		= 10,
+	.read		= wdtest_read,
+	.enable		= wdtest_enable,
+	.mask		= CLOCKSOURCE_MASK(64),
+	.flags		= CLOCK_SOURCE_IS_CONTINUOUS |
+			  CLOCK_SOURCE_MUST_VERIFY,
+	.owner		= THIS_MODULE,
+};
+
+static int __init clocksource_wdtest_init(void)
+{
+	wdtest_last_raw = ktime_get_raw_fast_ns();
+	wdtest_value = wdtest_last_raw;
+
+	return clocksource_register_hz(&clocksource_wdtest, NSEC_PER_SEC);
+}
+module_init(clocksource_wdtest_init);
+
+static void __exit clocksource_wdtest_exit(void)
+{
+	clocksource_unregister(&clocksource_wdtest);
+}
+module_exit(clocksource_wdtest_exit);
+
+MODULE_DESCRIPTION("Test clocksource for the clocksource watchdog");
+MODULE_LICENSE("GPL v2");
@@ -115,6 +115,31 @@ static inline void clocksource_watchdog_unlock(unsigned long *flags)
 	spin_unlock_irqrestore(&watchdog_lock, *flags);
 }
 
+/* Record the skew of @cs to the watchdog, and return it in ppb */
+static s32 clocksource_watchdog_record(struct clocksource *cs,
+				       int64_t cs_nsec, int64_t wd_nsec)
+{
+	int64_t skew = cs_nsec - wd_nsec;
+	s32 ppb;
+
+	/* Long intervals would overflow skew * NSEC_PER_SEC */
+	if (wd_nsec <= 0 || abs(skew) >= wd_nsec)
+		ppb = NSEC_PER_SEC;
+	else
+		ppb = mul_u64_u64_div_u64(abs(skew), NSEC_PER_SEC, wd_nsec);
+	if (skew < 0)
+		ppb = -ppb;
+
+	if (!cs->wd_skew_nr || ppb < cs->wd_skew_min)
+		cs->wd_skew_min = ppb;
+	if (!cs->wd_skew_nr || ppb > cs->wd_skew_max)
+		cs->wd_skew_max = ppb;
+	cs->wd_skew[cs->wd_skew_nr % CLOCKSOURCE_SKEW_HISTORY] = ppb;
+	cs->wd_skew_nr++;
+
+	return ppb;
+}
+
 static int clocksource_watchdog_kthread(void *data);
 static void __clocksource_change_rating(struct clocksource *cs, int rating);
 
@@ -124,6 +149,71 @@ static void __clocksource_change_rating(struct clocksource *cs, int rating);
 #define WATCHDOG_INTERVAL (HZ >> 1)
 #define WATCHDOG_THRESHOLD (NSEC_PER_SEC >> 4)
 
+/*
+ * Skew below which all the watched clocksources are considered stable, so
+ * that the check interval can back off: 500 ppm.
+ */
+#define WATCHDOG_STABLE_PPB	500000
+
+/*
+ * The check interval is doubled after each pass which finds all the watched
+ * clocksources stable, up to 2^watchdog_max_backoff times the configured
+ * interval, and reset as soon as a larger skew is seen. The threshold scales
+ * with the interval.
+ */
+static unsigned int watchdog_interval_ms = 500;
+module_param(watchdog_interval_ms, uint, 0644);
+MODULE_PARM_DESC(watchdog_interval_ms, "Clocksource watchdog check interval, in ms");
+
+static unsigned int watchdog_max_backoff = 3;
+module_param(watchdog_max_backoff, uint, 0644);
+MODULE_PARM_DESC(watchdog_max_backoff, "Number of times the clocksource watchdog interval doubles while stable");
+
+static unsigned int watchdog_backoff;
+/* Interval the watchdog timer was last armed with, in jiffies */
+static unsigned long watchdog_cur_interval;
+/* Lowest max_idle_ns of the watchdog and of the watched clocksources */
+static u64 watchdog_max_idle_ns;
+
+static void clocksource_watchdog_update_max_idle(void)
+{
+	struct clocksource *cs;
+	u64 max_idle_ns = watchdog->max_idle_ns;
+
+	list_for_each_entry(cs, &watchdog_list, wd_list)
+		max_idle_ns = min(max_idle_ns, cs->max_idle_ns);
+
+	watchdog_max_idle_ns = max_idle_ns;
+}
+
+/*
+ * Backing off stops at half the time the counters can run unchecked, which
+ * leaves room for the timer to run late without the counters wrapping.
+ */
+static unsigned long clocksource_watchdog_backoff_limit(void)
+{
+	return max(nsecs_to_jiffies(watchdog_max_idle_ns >> 1), 1UL);
+}
+
+/*
+ * The interval never exceeds the time the counters can run unchecked, so that
+ * they cannot wrap between two checks, whatever watchdog_interval_ms is.
+ */
+static unsigned long clocksource_watchdog_interval(void)
+{
+	unsigned long interval = msecs_to_jiffies(READ_ONCE(watchdog_interval_ms));
+	unsigned long max_interval = max(nsecs_to_jiffies(watchdog_max_idle_ns), 1UL);
+	unsigned long limit = clocksource_watchdog_backoff_limit();
+
+	interval = clamp(interval, 1UL, max_interval);
+	if (!watchdog_backoff || interval >= limit)
+		return interval;
+	if (interval > limit >> watchdog_backoff)
+		return limit;
+
+	return interval << watchdog_backoff;
+}
+
 static void clocksource_watchdog_work(struct work_struct *work)
 {
 	/*
@@ -188,14 +278,18 @@ static void clocksource_watchdog(struct timer_list *unused)
 {
 	struct clocksource *cs;
 	u64 csnow, wdnow, cslast, wdlast, delta;
-	int64_t wd_nsec, cs_nsec;
+	int64_t wd_nsec, cs_nsec, threshold;
 	int next_cpu, reset_pending;
+	bool stable;
 
 	spin_lock(&watchdog_lock);
 	if (!watchdog_running)
 		goto out;
 
 	reset_pending = atomic_read(&watchdog_reset_pending);
+	stable = !reset_pending;
+	threshold = div_u64((u64)WATCHDOG_THRESHOLD * watchdog_cur_interval,
+			    WATCHDOG_INTERVAL);
 
 	list_for_each_entry(cs, &watchdog_list, wd_list) {
 
@@ -217,6 +311,7 @@ static void clocksource_watchdog(struct timer_list *unused)
 			cs->flags |= CLOCK_SOURCE_WATCHDOG;
 			cs->wd_last = wdnow;
 			cs->cs_last = csnow;
+			stable = false;
 			continue;
 		}
 
@@ -234,8 +329,12 @@ static void clocksource_watchdog(struct timer_list *unused)
 		if (atomic_read(&watchdog_reset_pending))
 			continue;
 
+		if (abs(clocksource_watchdog_record(cs, cs_nsec, wd_nsec)) >
+		    WATCHDOG_STABLE_PPB)
+			stable = false;
+
 		/* Check the deviation from the watchdog clocksource. */
-		if (abs(cs_nsec - wd_nsec) > WATCHDOG_THRESHOLD) {
+		if (abs(cs_nsec - wd_nsec) > threshold) {
 			pr_warn("timekeeping watchdog on CPU%d: Marking clocksource '%s' as unstable because the skew is too large:\n",
 				smp_processor_id(), cs->name);
 			pr_warn("                      '%s' wd_now: %llx wd_last: %llx mask: %llx\n",
@@ -286,6 +385,18 @@ static void clocksource_watchdog(struct timer_list *unused)
 	if (reset_pending)
 		atomic_dec(&watchdog_reset_pending);
 
+	/*
+	 * Back off while all the clocksources are stable, as long as the
+	 * interval stays below clocksource_watchdog_backoff_limit().
+	 */
+	clocksource_watchdog_update_max_idle();
+	if (!stable)
+		watchdog_backoff = 0;
+	else if (watchdog_backoff < min(READ_ONCE(watchdog_max_backoff), 16U) &&
+		 clocksource_watchdog_interval() <
+		 clocksource_watchdog_backoff_limit())
+		watchdog_backoff++;
+
 	/*
 	 * Cycle through CPUs to check if the CPUs stay synchronized
 	 * to each other.
@@ -299,7 +410,8 @@ static void clocksource_watchdog(struct timer_list *unused)
 	 * pair clocksource_stop_watchdog() clocksource_start_watchdog().
 	 */
 	if (!timer_pending(&watchdog_timer)) {
-		watchdog_timer.expires += WATCHDOG_INTERVAL;
+		watchdog_cur_interval = clocksource_watchdog_interval();
+		watchdog_timer.expires += watchdog_cur_interval;
 		add_timer_on(&watchdog_timer, next_cpu);
 	}
 out:
@@ -311,7 +423,10 @@ static inline void clocksource_start_watchdog(void)
 	if (watchdog_running || !watchdog || list_empty(&watchdog_list))
 		return;
 	timer_setup(&watchdog_timer, clocksource_watchdog, 0);
-	watchdog_timer.expires = jiffies + WATCHDOG_INTERVAL;
+	watchdog_backoff = 0;
+	clocksource_watchdog_update_max_idle();
+	watchdog_cur_interval = clocksource_watchdog_interval();
+	watchdog_timer.expires = jiffies + watchdog_cur_interval;
 	add_timer_on(&watchdog_timer, cpumask_first(cpu_online_mask));
 	watchdog_running = 1;
 }
@@ -345,6 +460,7 @@ static void clocksource_enqueue_watchdog(struct clocksource *cs)
 		/* cs is a clocksource to be watched. */
 		list_add(&cs->wd_list, &watchdog_list);
 		cs->flags &= ~CLOCK_SOURCE_WATCHDOG;
+		watchdog_backoff = 0;
 	} else {
 		/* cs is a watchdog. */
 		if (cs->flags & CLOCK_SOURCE_IS_CONTINUOUS)
@@ -1166,10 +1282,88 @@ static ssize_t available_clocksource_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(available_clocksource);
 
+#ifdef CONFIG_CLOCKSOURCE_WATCHDOG
+/* Least squares slope of @n skews, in ppb per check */
+static s64 watchdog_skew_trend(const s32 *skew, unsigned int n)
+{
+	s64 sx = 0, sy = 0, sxx = 0, sxy = 0, div;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		sx += i;
+		sy += skew[i];
+		sxx += i * i;
+		sxy += (s64)i * skew[i];
+	}
+
+	div = n * sxx - sx * sx;
+	if (!div)
+		return 0;
+
+	return div64_s64(n * sxy - sx * sy, div);
+}
+
+/**
+ * watchdog_skew_show - sysfs interface for the clocksource watchdog history
+ * @dev:	unused
+ * @attr:	unused
+ * @buf:	char buffer to be filled with the skew history
+ *
+ * Shows the current check interval, then one line per clocksource which has
+ * been checked against the watchdog: the last, lowest and highest skews, the
+ * trend of the last skews and the last skews themselves, oldest first. The
+ * skews are in parts per billion of the check interval.
+ */
+static ssize_t watchdog_skew_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	s32 skew[CLOCKSOURCE_SKEW_HISTORY], min, max;
+	unsigned int nr, n, i;
+	struct clocksource *cs;
+	unsigned long flags;
+	ssize_t count;
+
+	mutex_lock(&clocksource_mutex);
+	count = scnprintf(buf, PAGE_SIZE, "interval %u ms\n",
+			  jiffies_to_msecs(READ_ONCE(watchdog_cur_interval)));
+
+	list_for_each_entry(cs, &clocksource_list, list) {
+		spin_lock_irqsave(&watchdog_lock, flags);
+		nr = cs->wd_skew_nr;
+		n = min_t(unsigned int, nr, CLOCKSOURCE_SKEW_HISTORY);
+		for (i = 0; i < n; i++)
+			skew[i] = cs->wd_skew[(nr - n + i) %
+					      CLOCKSOURCE_SKEW_HISTORY];
+		min = cs->wd_skew_min;
+		max = cs->wd_skew_max;
+		spin_unlock_irqrestore(&watchdog_lock, flags);
+
+		if (!n)
+			continue;
+
+		count += scnprintf(buf + count, PAGE_SIZE - count,
+				   "%s: last %d min %d max %d trend %lld samples %u:",
+				   cs->name, skew[n - 1], min, max,
+				   watchdog_skew_trend(skew, n), nr);
+		for (i = 0; i < n; i++)
+			count += scnprintf(buf + count, PAGE_SIZE - count,
+					   " %d", skew[i]);
+		count += scnprintf(buf + count, PAGE_SIZE - count, "\n");
+	}
+	mutex_unlock(&clocksource_mutex);
+
+	return count;
+}
+static DEVICE_ATTR_RO(watchdog_skew);
+#endif /* CONFIG_CLOCKSOURCE_WATCHDOG */
+
 static struct attribute *clocksource_attrs[] = {
 	&dev_attr_current_clocksource.attr,
 	&dev_attr_unbind_clocksource.attr,
 	&dev_attr_available_clocksource.attr,
+#ifdef CONFIG_CLOCKSOURCE_WATCHDOG
+	&dev_attr_watchdog_skew.attr,
+#endif
 	NULL
 };
 ATTRIBUTE_GROUPS(clocksource);
@@ -1548,11 +1548,17 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	base->running = NULL;
 }
 
-static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
-				 unsigned long flags, unsigned int active_mask)
+/*
+ * Expire the timers of the bases in @active_mask which are due at @now.
+ * Returns the number of callbacks which were run.
+ */
+static unsigned int __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base,
+					 ktime_t now, unsigned long flags,
+					 unsigned int active_mask)
 {
 	struct hrtimer_clock_base *base;
 	unsigned int active = cpu_base->active_bases & active_mask;
+	unsigned int expired = 0;
 
 	for_each_active_base(base, cpu_base, active) {
 		struct timerqueue_node *node;
@@ -1583,8 +1589,11 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 			__run_hrtimer(cpu_base, base, timer, &basenow, flags);
 			if (active_mask == HRTIMER_ACTIVE_SOFT)
 				hrtimer_sync_wait_running(cpu_base, flags);
+			expired++;
 		}
 	}
+
+	return expired;
 }
 
 static __latent_entropy void hrtimer_run_softirq(struct softirq_action *h)
@@ -1608,6 +1617,21 @@ static __latent_entropy void hrtimer_run_softirq(struct softirq_action *h)
 
 #ifdef CONFIG_HIGH_RES_TIMERS
 
+/*
+ * Maximum number of passes over the queues in one hrtimer_interrupt()
+ * attempt, see below.
+ */
+#define HRTIMER_MAX_PASSES	4
+
+static void hrtimer_account_expiry(struct hrtimer_cpu_base *cpu_base,
+				   unsigned int expired, ktime_t time)
+{
+	cpu_base->nr_expired += expired;
+	cpu_base->expiry_time += time;
+	if ((unsigned int)time > cpu_base->max_expiry_time)
+		cpu_base->max_expiry_time = (unsigned int)time;
+}
+
 /*
  * High resolution timer interrupt
  * Called with interrupts disabled
@@ -1615,9 +1639,10 @@ static __latent_entropy void hrtimer_run_softirq(struct softirq_action *h)
 void hrtimer_interrupt(struct clock_event_device *dev)
 {
 	struct hrtimer_cpu_base *cpu_base = this_cpu_ptr(&hrtimer_bases);
-	ktime_t expires_next, now, entry_time, delta;
+	ktime_t expires_next, now, entry_time, pass_time, delta;
+	unsigned int expired, nr_expired = 0;
 	unsigned long flags;
-	int retries = 0;
+	int retries = 0, passes;
 
 	BUG_ON(!cpu_base->hres_active);
 	cpu_base->nr_events++;
@@ -1636,16 +1661,41 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 	 */
 	cpu_base->expires_next = KTIME_MAX;
 
-	if (!ktime_before(now, cpu_base->softirq_expires_next)) {
-		cpu_base->softirq_expires_next = KTIME_MAX;
-		cpu_base->softirq_activated = 1;
-		raise_softirq_irqoff(HRTIMER_SOFTIRQ);
-	}
+	/*
+	 * Timers which became due while the callbacks were running, such as
+	 * the other ones of a burst of timers expiring close together, are
+	 * expired right away by another pass over the queues. This avoids
+	 * dropping the lock and failing to program the clock event device in
+	 * the past for each of them, and does not count as a retry.
+	 */
+	for (passes = 1;; passes++) {
+		if (!ktime_before(now, cpu_base->softirq_expires_next)) {
+			cpu_base->softirq_expires_next = KTIME_MAX;
+			cpu_base->softirq_activated = 1;
+			raise_softirq_irqoff(HRTIMER_SOFTIRQ);
+		}
 
-	__hrtimer_run_queues(cpu_base, now, flags, HRTIMER_ACTIVE_HARD);
+		pass_time = now;
+		expired = __hrtimer_run_queues(cpu_base, now, flags,
+					       HRTIMER_ACTIVE_HARD);
+
+		/* Reevaluate the clock bases for the next expiry */
+		expires_next = __hrtimer_get_next_event(cpu_base,
+							HRTIMER_ACTIVE_ALL);
+		if (!expired)
+			break;
+
+		now = hrtimer_update_base(cpu_base);
+		hrtimer_account_expiry(cpu_base, expired,
+				       ktime_sub(now, pass_time));
+		nr_expired += expired;
+
+		if (ktime_before(now, expires_next) ||
+		    passes == HRTIMER_MAX_PASSES)
+			break;
+		cpu_base->nr_passes++;
+	}
 
-	/* Reevaluate the clock bases for the next expiry */
-	expires_next = __hrtimer_get_next_event(cpu_base, HRTIMER_ACTIVE_ALL);
 	/*
 	 * Store the new expiry value so the migration code can verify
 	 * against it.
@@ -1654,6 +1704,9 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 	cpu_base->in_hrtirq = 0;
 	raw_spin_unlock_irqrestore(&cpu_base->lock, flags);
 
+	if (nr_expired > cpu_base->max_expired)
+		cpu_base->max_expired = nr_expired;
+
 	/* Reprogramming necessary ? */
 	if (!tick_program_event(expires_next, 0)) {
 		cpu_base->hang_detected = 0;
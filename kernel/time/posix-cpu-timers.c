@@ -274,9 +274,25 @@ void thread_group_sample_cputime(struct task_struct *tsk, u64 *samples)
 	proc_sample_cputime_atomic(&cputimer->cputime_atomic, samples);
 }
 
+/*
+ * Whether the atomic accounting store of the thread group holds an uptodate
+ * value of the clock. The runtime is only accounted on behalf of process
+ * wide CPUCLOCK_SCHED timers: it is updated far more often than the tick
+ * based user and system times, from all the threads of the group.
+ */
+static inline bool group_cputime_active(struct posix_cputimers *pct,
+					const clockid_t clkid)
+{
+	if (!READ_ONCE(pct->timers_active))
+		return false;
+
+	return clkid != CPUCLOCK_SCHED || READ_ONCE(pct->sched_active);
+}
+
 /**
  * thread_group_start_cputime - Start cputime and return a sample
  * @tsk:	Task for which cputime needs to be started
+ * @clkid:	The clock a timer is going to be started on
  * @samples:	Storage for time samples
  *
  * The thread group cputime accouting is avoided when there are no posix
@@ -286,13 +302,14 @@ void thread_group_sample_cputime(struct task_struct *tsk, u64 *samples)
  *
  * Updates @times with an uptodate sample of the thread group cputimes.
  */
-static void thread_group_start_cputime(struct task_struct *tsk, u64 *samples)
+static void thread_group_start_cputime(struct task_struct *tsk,
+				       const clockid_t clkid, u64 *samples)
 {
 	struct thread_group_cputimer *cputimer = &tsk->signal->cputimer;
 	struct posix_cputimers *pct = &tsk->signal->posix_cputimers;
 
 	/* Check if cputimer isn't running. This is accessed without locking. */
-	if (!READ_ONCE(pct->timers_active)) {
+	if (!group_cputime_active(pct, clkid)) {
 		struct task_cputime sum;
 
 		/*
@@ -310,6 +327,8 @@ static void thread_group_start_cputime(struct task_struct *tsk, u64 *samples)
 		 * barriers are not required because update_gt_cputime()
 		 * can handle concurrent updates.
 		 */
+		if (clkid == CPUCLOCK_SCHED)
+			WRITE_ONCE(pct->sched_active, true);
 		WRITE_ONCE(pct->timers_active, true);
 	}
 	proc_sample_cputime_atomic(&cputimer->cputime_atomic, samples);
@@ -335,9 +354,9 @@ static u64 cpu_clock_sample_group(const clockid_t clkid, struct task_struct *p,
 	struct posix_cputimers *pct = &p->signal->posix_cputimers;
 	u64 samples[CPUCLOCK_MAX];
 
-	if (!READ_ONCE(pct->timers_active)) {
+	if (!group_cputime_active(pct, clkid)) {
 		if (start)
-			thread_group_start_cputime(p, samples);
+			thread_group_start_cputime(p, clkid, samples);
 		else
 			__thread_group_cputime(p, samples);
 	} else {
@@ -873,8 +892,9 @@ static inline void stop_process_timers(struct signal_struct *sig)
 {
 	struct posix_cputimers *pct = &sig->posix_cputimers;
 
-	/* Turn off the active flag. This is done without locking. */
+	/* Turn off the active flags. This is done without locking. */
 	WRITE_ONCE(pct->timers_active, false);
+	WRITE_ONCE(pct->sched_active, false);
 	tick_dep_clear_signal(sig, TICK_DEP_BIT_POSIX_TIMER);
 }
 
@@ -26,6 +26,8 @@
 #include <linux/posix-timers.h>
 #include <linux/context_tracking.h>
 #include <linux/mm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/irq_regs.h>
 
@@ -755,10 +757,20 @@ static ktime_t tick_nohz_next_event(struct tick_sched *ts, int cpu)
 	 * minimal delta which brings us back to this place
 	 * immediately. Lather, rinse and repeat...
 	 */
-	if (rcu_needs_cpu(basemono, &next_rcu) || arch_needs_cpu() ||
-	    irq_work_needs_cpu() || local_timer_softirq_pending()) {
+	if (rcu_needs_cpu(basemono, &next_rcu)) {
+		ts->idle_reason = TICK_IDLE_RCU;
+		next_tick = basemono + TICK_NSEC;
+	} else if (arch_needs_cpu()) {
+		ts->idle_reason = TICK_IDLE_ARCH;
+		next_tick = basemono + TICK_NSEC;
+	} else if (irq_work_needs_cpu()) {
+		ts->idle_reason = TICK_IDLE_IRQ_WORK;
+		next_tick = basemono + TICK_NSEC;
+	} else if (local_timer_softirq_pending()) {
+		ts->idle_reason = TICK_IDLE_TIMER_SOFTIRQ;
 		next_tick = basemono + TICK_NSEC;
 	} else {
+		ts->idle_reason = TICK_IDLE_NEXT_EVENT;
 		/*
 		 * Get the next pending timer. If high resolution
 		 * timers are enabled this only takes the timer wheel
@@ -904,8 +916,23 @@ static void tick_nohz_stop_sched_tick(struct tick_sched *ts, int cpu)
 }
 #endif /* CONFIG_NO_HZ_FULL */
 
+static void tick_nohz_idle_stopped_end(struct tick_sched *ts, ktime_t now)
+{
+	u64 us;
+
+	if (!ts->idle_stopped_since)
+		return;
+
+	us = ktime_to_us(ktime_sub(now, ts->idle_stopped_since));
+	ts->idle_stopped_hist[min_t(int, us ? ilog2(us) : 0,
+				    TICK_STOPPED_HIST_SLOTS - 1)]++;
+	ts->idle_stopped_since = 0;
+}
+
 static void tick_nohz_restart_sched_tick(struct tick_sched *ts, ktime_t now)
 {
+	tick_nohz_idle_stopped_end(ts, now);
+
 	/* Update jiffies first */
 	tick_do_update_jiffies64(now);
 
@@ -961,14 +988,19 @@ static bool can_stop_idle_tick(int cpu, struct tick_sched *ts)
 		 * deadline if it comes back online later.
 		 */
 		ts->next_tick = 0;
+		ts->idle_reason = TICK_IDLE_OFFLINE;
 		return false;
 	}
 
-	if (unlikely(ts->nohz_mode == NOHZ_MODE_INACTIVE))
+	if (unlikely(ts->nohz_mode == NOHZ_MODE_INACTIVE)) {
+		ts->idle_reason = TICK_IDLE_NOHZ_INACTIVE;
 		return false;
+	}
 
-	if (need_resched())
+	if (need_resched()) {
+		ts->idle_reason = TICK_IDLE_NEED_RESCHED;
 		return false;
+	}
 
 	if (unlikely(local_softirq_pending())) {
 		static int ratelimit;
@@ -979,10 +1011,12 @@ static bool can_stop_idle_tick(int cpu, struct tick_sched *ts)
 				(unsigned int) local_softirq_pending());
 			ratelimit++;
 		}
+		ts->idle_reason = TICK_IDLE_SOFTIRQ;
 		return false;
 	}
 
 	if (tick_nohz_full_enabled()) {
+		ts->idle_reason = TICK_IDLE_TIMEKEEPING;
 		/*
 		 * Keep the tick alive to guarantee timekeeping progression
 		 * if there are full dynticks CPUs around
@@ -1007,12 +1041,14 @@ static void __tick_nohz_idle_stop_tick(struct tick_sched *ts)
 	 * If tick_nohz_get_sleep_length() ran tick_nohz_next_event(), the
 	 * tick timer expiration time is known already.
 	 */
-	if (ts->timer_expires_base)
+	if (ts->timer_expires_base) {
 		expires = ts->timer_expires;
-	else if (can_stop_idle_tick(cpu, ts))
+	} else if (can_stop_idle_tick(cpu, ts)) {
 		expires = tick_nohz_next_event(ts, cpu);
-	else
+	} else {
+		ts->idle_stats[ts->idle_reason]++;
 		return;
+	}
 
 	ts->idle_calls++;
 
@@ -1023,12 +1059,15 @@ static void __tick_nohz_idle_stop_tick(struct tick_sched *ts)
 
 		ts->idle_sleeps++;
 		ts->idle_expires = expires;
+		ts->idle_stats[TICK_IDLE_STOPPED]++;
 
 		if (!was_stopped && ts->tick_stopped) {
 			ts->idle_jiffies = ts->last_jiffies;
+			ts->idle_stopped_since = ts->idle_entrytime;
 			nohz_balance_enter_idle(cpu);
 		}
 	} else {
+		ts->idle_stats[ts->idle_reason]++;
 		tick_nohz_retain_tick(ts);
 	}
 }
@@ -1045,7 +1084,18 @@ void tick_nohz_idle_stop_tick(void)
 
 void tick_nohz_idle_retain_tick(void)
 {
-	tick_nohz_retain_tick(this_cpu_ptr(&tick_cpu_sched));
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+
+	/*
+	 * If tick_nohz_get_sleep_length() found that the tick could be
+	 * stopped, the cpuidle governor decided otherwise.
+	 */
+	if (ts->timer_expires_base && ts->timer_expires > 0)
+		ts->idle_stats[TICK_IDLE_GOVERNOR]++;
+	else
+		ts->idle_stats[ts->idle_reason]++;
+
+	tick_nohz_retain_tick(ts);
 	/*
 	 * Undo the effect of get_next_timer_interrupt() called from
 	 * tick_nohz_next_event().
@@ -1327,6 +1377,65 @@ static inline void tick_nohz_irq_enter(void)
 		tick_nohz_update_jiffies(now);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const tick_idle_stat_names[TICK_IDLE_NR_STATS] = {
+	[TICK_IDLE_STOPPED]		= "stopped",
+	[TICK_IDLE_OFFLINE]		= "offline",
+	[TICK_IDLE_NOHZ_INACTIVE]	= "inactive",
+	[TICK_IDLE_NEED_RESCHED]	= "resched",
+	[TICK_IDLE_SOFTIRQ]		= "softirq",
+	[TICK_IDLE_TIMEKEEPING]		= "timekeeping",
+	[TICK_IDLE_RCU]			= "rcu",
+	[TICK_IDLE_ARCH]		= "arch",
+	[TICK_IDLE_IRQ_WORK]		= "irq_work",
+	[TICK_IDLE_TIMER_SOFTIRQ]	= "timer_softirq",
+	[TICK_IDLE_NEXT_EVENT]		= "next_event",
+	[TICK_IDLE_GOVERNOR]		= "governor",
+};
+
+static int tick_nohz_idle_stats_show(struct seq_file *m, void *v)
+{
+	struct tick_sched *ts;
+	int cpu, i;
+
+	seq_printf(m, "%-14s", "cpu");
+	for_each_online_cpu(cpu)
+		seq_printf(m, " %10d", cpu);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < TICK_IDLE_NR_STATS; i++) {
+		seq_printf(m, "%-14s", tick_idle_stat_names[i]);
+		for_each_online_cpu(cpu) {
+			ts = tick_get_tick_sched(cpu);
+			seq_printf(m, " %10lu", READ_ONCE(ts->idle_stats[i]));
+		}
+		seq_putc(m, '\n');
+	}
+
+	seq_puts(m, "\nstopped for (us)\n");
+	for (i = 0; i < TICK_STOPPED_HIST_SLOTS; i++) {
+		seq_printf(m, "%-14lu", i ? 1UL << i : 0);
+		for_each_online_cpu(cpu) {
+			ts = tick_get_tick_sched(cpu);
+			seq_printf(m, " %10lu",
+				   READ_ONCE(ts->idle_stopped_hist[i]));
+		}
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tick_nohz_idle_stats);
+
+static int __init tick_nohz_idle_stats_init(void)
+{
+	debugfs_create_file("tick_nohz_idle", 0444, NULL, NULL,
+			    &tick_nohz_idle_stats_fops);
+	return 0;
+}
+late_initcall(tick_nohz_idle_stats_init);
+#endif /* CONFIG_DEBUG_FS */
+
 #else
 
 static inline void tick_nohz_switch_to_nohz(void) { }
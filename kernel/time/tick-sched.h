@@ -20,6 +20,29 @@ enum tick_nohz_mode {
 	NOHZ_MODE_HIGHRES,
 };
 
+/*
+ * Outcome of the decisions to stop the tick, or to keep it, when a CPU goes
+ * idle: the tick was stopped, or the reason why it was kept.
+ */
+enum tick_idle_stat {
+	TICK_IDLE_STOPPED,
+	TICK_IDLE_OFFLINE,		/* CPU going offline */
+	TICK_IDLE_NOHZ_INACTIVE,	/* nohz mode not enabled yet */
+	TICK_IDLE_NEED_RESCHED,
+	TICK_IDLE_SOFTIRQ,		/* softirq pending */
+	TICK_IDLE_TIMEKEEPING,		/* timekeeper with nohz_full CPUs */
+	TICK_IDLE_RCU,			/* rcu_needs_cpu() */
+	TICK_IDLE_ARCH,			/* arch_needs_cpu() */
+	TICK_IDLE_IRQ_WORK,		/* irq_work_needs_cpu() */
+	TICK_IDLE_TIMER_SOFTIRQ,	/* timer softirq pending */
+	TICK_IDLE_NEXT_EVENT,		/* next event within a tick */
+	TICK_IDLE_GOVERNOR,		/* cpuidle governor kept the tick */
+	TICK_IDLE_NR_STATS,
+};
+
+/* Tick stopped periods are counted by power of two slots of microseconds */
+#define TICK_STOPPED_HIST_SLOTS	24
+
 /**
  * struct tick_sched - sched tick emulation and no idle tick control/stats
  * @sched_timer:	hrtimer to schedule the periodic tick in high
@@ -49,6 +72,10 @@ enum tick_nohz_mode {
  * @timer_expires_base:	Base time clock monotonic for @timer_expires
  * @next_timer:		Expiry time of next expiring timer for debugging purpose only
  * @tick_dep_mask:	Tick dependency mask - is set, if someone needs the tick
+ * @idle_reason:	Why the tick can't be stopped, as found by the last check
+ * @idle_stopped_since:	Time the idle tick was stopped at, 0 if it is not
+ * @idle_stats:		Number of idle tick stop decisions, by outcome
+ * @idle_stopped_hist:	Durations of the idle tick stopped periods
  */
 struct tick_sched {
 	struct hrtimer			sched_timer;
@@ -77,6 +104,10 @@ struct tick_sched {
 	u64				next_timer;
 	ktime_t				idle_expires;
 	atomic_t			tick_dep_mask;
+	enum tick_idle_stat		idle_reason;
+	ktime_t				idle_stopped_since;
+	unsigned long			idle_stats[TICK_IDLE_NR_STATS];
+	unsigned long			idle_stopped_hist[TICK_STOPPED_HIST_SLOTS];
 };
 
 extern struct tick_sched *tick_get_tick_sched(int cpu);
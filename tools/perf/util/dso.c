@@ -1320,6 +1320,7 @@ void dso__delete(struct dso *dso)
 	auxtrace_cache__free(dso->auxtrace_cache);
 	dso_cache__free(dso);
 	dso__free_a2l(dso);
+	dso__free_srcline_index(dso);
 	zfree(&dso->symsrc_filename);
 	nsinfo__zput(dso->nsinfo);
 	pthread_mutex_destroy(&dso->lock);
@@ -158,6 +158,7 @@ struct dso {
 		struct symbol	*symbol;
 	} last_find_result;
 	void		 *a2l;
+	void		 *srcline_index;
 	char		 *symsrc_filename;
 	unsigned int	 a2l_fails;
 	enum dso_space_type	kernel;
@@ -168,6 +169,7 @@ struct dso {
 	u8		 adjust_symbols:1;
 	u8		 has_build_id:1;
 	u8		 has_srcline:1;
+	u8		 srcline_index_failed:1;
 	u8		 hit:1;
 	u8		 annotate_warned:1;
 	u8		 short_name_allocated:1;
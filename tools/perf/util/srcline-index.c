@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * In-process DWARF line table index for srcline resolution.
+ *
+ * Instead of asking addr2line (or libbfd) about one address at a time, the
+ * .debug_line tables of a DSO are decoded once into an array of address
+ * ranges sorted by start address, so that address to file:line lookups become
+ * a binary search.  The decoded index is stored next to the binary in the
+ * build-id cache, so later sessions on the same build-id skip the decoding.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dwarf.h>
+#include <elfutils/libdw.h>
+
+#include <linux/err.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/zalloc.h>
+
+#include "build-id.h"
+#include "debug.h"
+#include "dso.h"
+#include "hashmap.h"
+#include "srcline.h"
+
+#define SRCLINE_INDEX_MAGIC	"PERFSLX1"
+#define SRCLINE_INDEX_FILE	"srclines"
+
+/* File index of a row terminating a sequence, i.e. a gap in the table */
+#define SRCLINE_INDEX_END	((u32)-1)
+
+struct srcline_index_entry {
+	u64	addr;
+	u32	file;
+	u32	line;
+};
+
+struct srcline_index {
+	struct srcline_index_entry	*entries;
+	size_t				nr_entries;
+	char				**files;
+	u32				nr_files;
+};
+
+struct srcline_index_header {
+	char	magic[8];
+	u32	nr_files;
+	u32	reserved;
+	u64	nr_entries;
+	u64	files_size;
+};
+
+static void srcline_index__delete(struct srcline_index *idx)
+{
+	u32 i;
+
+	if (!idx)
+		return;
+
+	for (i = 0; i < idx->nr_files; i++)
+		free(idx->files[i]);
+	free(idx->files);
+	free(idx->entries);
+	free(idx);
+}
+
+static size_t str_hash_fn(const void *key, void *ctx __maybe_unused)
+{
+	return str_hash(key);
+}
+
+static bool str_equal_fn(const void *key1, const void *key2,
+			 void *ctx __maybe_unused)
+{
+	return strcmp(key1, key2) == 0;
+}
+
+struct srcline_index_builder {
+	struct srcline_index	*idx;
+	struct hashmap		*file_map;
+	size_t			alloc_entries;
+	u32			alloc_files;
+};
+
+static int builder__file_id(struct srcline_index_builder *b, const char *name,
+			    u32 *id)
+{
+	struct srcline_index *idx = b->idx;
+	void *val;
+	char *copy;
+
+	if (hashmap__find(b->file_map, name, &val)) {
+		*id = (u32)(uintptr_t)val;
+		return 0;
+	}
+
+	if (idx->nr_files == b->alloc_files) {
+		u32 nr = b->alloc_files ? b->alloc_files * 2 : 64;
+		char **files = realloc(idx->files, nr * sizeof(*files));
+
+		if (!files)
+			return -ENOMEM;
+		idx->files = files;
+		b->alloc_files = nr;
+	}
+
+	copy = strdup(name);
+	if (!copy)
+		return -ENOMEM;
+
+	if (hashmap__add(b->file_map, copy, (void *)(uintptr_t)idx->nr_files)) {
+		free(copy);
+		return -ENOMEM;
+	}
+
+	*id = idx->nr_files;
+	idx->files[idx->nr_files++] = copy;
+	return 0;
+}
+
+static int builder__add(struct srcline_index_builder *b, u64 addr, u32 file,
+			u32 line)
+{
+	struct srcline_index *idx = b->idx;
+	struct srcline_index_entry *e;
+
+	/*
+	 * Several rows of a sequence may share an address, only the last one
+	 * is reported by addr2line, so let it replace the previous ones.
+	 */
+	if (idx->nr_entries && file != SRCLINE_INDEX_END) {
+		e = &idx->entries[idx->nr_entries - 1];
+		if (e->addr == addr && e->file != SRCLINE_INDEX_END) {
+			e->file = file;
+			e->line = line;
+			return 0;
+		}
+	}
+
+	if (idx->nr_entries == b->alloc_entries) {
+		size_t nr = b->alloc_entries ? b->alloc_entries * 2 : 4096;
+
+		e = realloc(idx->entries, nr * sizeof(*e));
+		if (!e)
+			return -ENOMEM;
+		idx->entries = e;
+		b->alloc_entries = nr;
+	}
+
+	e = &idx->entries[idx->nr_entries++];
+	e->addr = addr;
+	e->file = file;
+	e->line = line;
+	return 0;
+}
+
+static int builder__add_cu(struct srcline_index_builder *b, Dwarf_Die *cu_die)
+{
+	Dwarf_Lines *lines;
+	size_t nr_lines, i;
+	int ret;
+
+	if (dwarf_getsrclines(cu_die, &lines, &nr_lines) != 0)
+		return 0;	/* No line table for this CU */
+
+	for (i = 0; i < nr_lines; i++) {
+		Dwarf_Line *line = dwarf_onesrcline(lines, i);
+		Dwarf_Addr addr;
+		bool end_sequence;
+		const char *src;
+		int lineno;
+		u32 file;
+
+		if (!line || dwarf_lineaddr(line, &addr) != 0)
+			continue;
+
+		if (dwarf_lineendsequence(line, &end_sequence) == 0 &&
+		    end_sequence) {
+			ret = builder__add(b, addr, SRCLINE_INDEX_END, 0);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		src = dwarf_linesrc(line, NULL, NULL);
+		if (!src || dwarf_lineno(line, &lineno) != 0 || lineno <= 0)
+			continue;
+
+		ret = builder__file_id(b, src, &file);
+		if (!ret)
+			ret = builder__add(b, addr, file, lineno);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int srcline_index_entry__cmp(const void *a, const void *b)
+{
+	const struct srcline_index_entry *ea = a, *eb = b;
+
+	if (ea->addr != eb->addr)
+		return ea->addr < eb->addr ? -1 : 1;
+	/*
+	 * A sequence may end at the very address where the next one starts;
+	 * sort the terminator first so that the start row wins the lookup.
+	 */
+	if ((ea->file == SRCLINE_INDEX_END) != (eb->file == SRCLINE_INDEX_END))
+		return ea->file == SRCLINE_INDEX_END ? -1 : 1;
+	return 0;
+}
+
+static struct srcline_index *srcline_index__build(const char *path)
+{
+	struct srcline_index_builder b = { .idx = NULL, };
+	Dwarf_Off off = 0, noff;
+	size_t hsize;
+	Dwarf *dbg;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	dbg = dwarf_begin(fd, DWARF_C_READ);
+	if (!dbg)
+		goto out_close;
+
+	b.idx = zalloc(sizeof(*b.idx));
+	b.file_map = hashmap__new(str_hash_fn, str_equal_fn, NULL);
+	if (!b.idx || IS_ERR(b.file_map))
+		goto out_err;
+
+	while (dwarf_nextcu(dbg, off, &noff, &hsize, NULL, NULL, NULL) == 0) {
+		Dwarf_Die cu_die;
+
+		if (dwarf_offdie(dbg, off + hsize, &cu_die) &&
+		    builder__add_cu(&b, &cu_die))
+			goto out_err;
+		off = noff;
+	}
+
+	if (!b.idx->nr_entries)
+		goto out_err;
+
+	qsort(b.idx->entries, b.idx->nr_entries, sizeof(*b.idx->entries),
+	      srcline_index_entry__cmp);
+	goto out;
+
+out_err:
+	srcline_index__delete(b.idx);
+	b.idx = NULL;
+out:
+	if (!IS_ERR_OR_NULL(b.file_map))
+		hashmap__free(b.file_map);
+	if (dbg)
+		dwarf_end(dbg);
+out_close:
+	close(fd);
+	return b.idx;
+}
+
+/* Return the row covering @addr, i.e. the last one at or below it */
+static struct srcline_index_entry *
+srcline_index__find_entry(struct srcline_index *idx, u64 addr)
+{
+	size_t lo = 0, hi = idx->nr_entries;
+	struct srcline_index_entry *e;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (idx->entries[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return NULL;
+
+	e = &idx->entries[lo - 1];
+	if (e->file == SRCLINE_INDEX_END)
+		return NULL;
+	return e;
+}
+
+static char *srcline_index__cache_path(struct dso *dso)
+{
+	char sbuild_id[SBUILD_ID_SIZE];
+	char *linkname, *path = NULL;
+
+	if (!dso->has_build_id)
+		return NULL;
+
+	build_id__sprintf(&dso->bid, sbuild_id);
+	if (!build_id_cache__cached(sbuild_id))
+		return NULL;
+
+	linkname = build_id_cache__linkname(sbuild_id, NULL, 0);
+	if (!linkname)
+		return NULL;
+
+	if (asprintf(&path, "%s/" SRCLINE_INDEX_FILE, linkname) < 0)
+		path = NULL;
+	free(linkname);
+	return path;
+}
+
+static struct srcline_index *srcline_index__load(const char *path)
+{
+	struct srcline_index_header hdr;
+	struct srcline_index *idx;
+	char *strtab = NULL, *p, *end;
+	FILE *fp;
+	u32 i;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return NULL;
+
+	idx = zalloc(sizeof(*idx));
+	if (!idx)
+		goto out_close;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, SRCLINE_INDEX_MAGIC, sizeof(hdr.magic)) ||
+	    !hdr.nr_entries || !hdr.nr_files || !hdr.files_size)
+		goto out_err;
+
+	idx->entries = calloc(hdr.nr_entries, sizeof(*idx->entries));
+	idx->files = calloc(hdr.nr_files, sizeof(*idx->files));
+	strtab = malloc(hdr.files_size);
+	if (!idx->entries || !idx->files || !strtab)
+		goto out_err;
+
+	if (fread(idx->entries, sizeof(*idx->entries), hdr.nr_entries, fp) !=
+	    hdr.nr_entries || fread(strtab, hdr.files_size, 1, fp) != 1 ||
+	    strtab[hdr.files_size - 1] != '\0')
+		goto out_err;
+	idx->nr_entries = hdr.nr_entries;
+
+	p = strtab;
+	end = strtab + hdr.files_size;
+	for (i = 0; i < hdr.nr_files; i++) {
+		if (p >= end)
+			goto out_err;
+		idx->files[i] = strdup(p);
+		if (!idx->files[i])
+			goto out_err;
+		idx->nr_files++;
+		p += strlen(p) + 1;
+	}
+
+	/* Reject stale or corrupted files rather than returning junk */
+	for (i = 0; i < idx->nr_entries; i++) {
+		u32 file = idx->entries[i].file;
+
+		if (file != SRCLINE_INDEX_END && file >= idx->nr_files)
+			goto out_err;
+	}
+
+	free(strtab);
+	fclose(fp);
+	return idx;
+
+out_err:
+	pr_debug("srcline index %s is corrupted, ignoring it\n", path);
+	free(strtab);
+	srcline_index__delete(idx);
+	idx = NULL;
+out_close:
+	fclose(fp);
+	return idx;
+}
+
+static int srcline_index__save(struct srcline_index *idx, const char *path)
+{
+	struct srcline_index_header hdr = {
+		.nr_files	= idx->nr_files,
+		.nr_entries	= idx->nr_entries,
+	};
+	char *tmp;
+	FILE *fp;
+	u32 i;
+	int fd, ret = -1;
+
+	memcpy(hdr.magic, SRCLINE_INDEX_MAGIC, sizeof(hdr.magic));
+	for (i = 0; i < idx->nr_files; i++)
+		hdr.files_size += strlen(idx->files[i]) + 1;
+
+	if (asprintf(&tmp, "%s.XXXXXX", path) < 0)
+		return -1;
+
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto out_free;
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		goto out_unlink;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    fwrite(idx->entries, sizeof(*idx->entries), idx->nr_entries, fp) !=
+	    idx->nr_entries)
+		goto out_fclose;
+
+	for (i = 0; i < idx->nr_files; i++) {
+		if (fwrite(idx->files[i], strlen(idx->files[i]) + 1, 1, fp) != 1)
+			goto out_fclose;
+	}
+
+	if (fclose(fp) == 0 && !chmod(tmp, 0644) && !rename(tmp, path))
+		ret = 0;
+	goto out_unlink;
+
+out_fclose:
+	fclose(fp);
+out_unlink:
+	if (ret)
+		unlink(tmp);
+out_free:
+	free(tmp);
+	return ret;
+}
+
+static struct srcline_index *dso__srcline_index(struct dso *dso,
+						const char *dso_name)
+{
+	struct srcline_index *idx;
+	char *cache_path;
+
+	if (dso->srcline_index || dso->srcline_index_failed)
+		return dso->srcline_index;
+
+	cache_path = srcline_index__cache_path(dso);
+	idx = cache_path ? srcline_index__load(cache_path) : NULL;
+	if (!idx) {
+		idx = srcline_index__build(dso_name);
+		if (idx && cache_path && srcline_index__save(idx, cache_path))
+			pr_debug("Failed to save srcline index to %s\n",
+				 cache_path);
+	}
+	free(cache_path);
+
+	if (!idx) {
+		pr_debug("No DWARF line table index for %s\n", dso_name);
+		dso->srcline_index_failed = 1;
+		return NULL;
+	}
+
+	pr_debug("DWARF line table index for %s: %zu rows, %u files\n",
+		 dso_name, idx->nr_entries, idx->nr_files);
+	dso->srcline_index = idx;
+	return idx;
+}
+
+/*
+ * Look up @addr in the DWARF line table index of @dso, building or loading the
+ * index on first use.  On success, *file is a string owned by the index.
+ */
+int dso__srcline_index_find(struct dso *dso, const char *dso_name, u64 addr,
+			    const char **file, unsigned int *line)
+{
+	struct srcline_index_entry *e;
+	struct srcline_index *idx;
+
+	idx = dso__srcline_index(dso, dso_name);
+	if (!idx)
+		return 0;
+
+	e = srcline_index__find_entry(idx, addr);
+	if (!e)
+		return 0;
+
+	*file = idx->files[e->file];
+	*line = e->line;
+	return 1;
+}
+
+void dso__free_srcline_index(struct dso *dso)
+{
+	srcline_index__delete(dso->srcline_index);
+	dso->srcline_index = NULL;
+	dso->srcline_index_failed = 0;
+}
@@ -516,6 +516,27 @@ static struct inline_node *addr2inlines(const char *dso_name, u64 addr,
  */
 #define A2L_FAIL_LIMIT 123
 
+/*
+ * Resolve the innermost file:line of addr, trying the DWARF line table index
+ * of the dso before falling back to addr2line.  Inlined frames are not part of
+ * the line table, so callers that need them go to addr2line directly.
+ */
+static int dso__addr2line(struct dso *dso, const char *dso_name, u64 addr,
+			  char **file, unsigned int *line, bool unwind_inlines,
+			  struct symbol *sym)
+{
+	const char *index_file;
+
+	if (!unwind_inlines &&
+	    dso__srcline_index_find(dso, dso_name, addr, &index_file, line)) {
+		*file = strdup(index_file);
+		return *file ? 1 : 0;
+	}
+
+	return addr2line(dso_name, addr, file, line, dso, unwind_inlines,
+			 NULL, sym);
+}
+
 char *__get_srcline(struct dso *dso, u64 addr, struct symbol *sym,
 		  bool show_sym, bool show_addr, bool unwind_inlines,
 		  u64 ip)
@@ -532,8 +553,8 @@ char *__get_srcline(struct dso *dso, u64 addr, struct symbol *sym,
 	if (dso_name == NULL)
 		goto out;
 
-	if (!addr2line(dso_name, addr, &file, &line, dso,
-		       unwind_inlines, NULL, sym))
+	if (!dso__addr2line(dso, dso_name, addr, &file, &line,
+			    unwind_inlines, sym))
 		goto out;
 
 	srcline = srcline_from_fileline(file, line);
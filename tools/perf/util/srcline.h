@@ -2,6 +2,7 @@
 #ifndef PERF_SRCLINE_H
 #define PERF_SRCLINE_H
 
+#include <linux/compiler.h>
 #include <linux/list.h>
 #include <linux/rbtree.h>
 #include <linux/types.h>
@@ -27,6 +28,27 @@ void srcline__tree_delete(struct rb_root_cached *tree);
 
 #define SRCLINE_UNKNOWN  ((char *) "??:0")
 
+#ifdef HAVE_DWARF_SUPPORT
+/* look up addr in the DWARF line table index of the DSO */
+int dso__srcline_index_find(struct dso *dso, const char *dso_name, u64 addr,
+			    const char **file, unsigned int *line);
+/* free the DWARF line table index of the DSO */
+void dso__free_srcline_index(struct dso *dso);
+#else
+static inline int dso__srcline_index_find(struct dso *dso __maybe_unused,
+					  const char *dso_name __maybe_unused,
+					  u64 addr __maybe_unused,
+					  const char **file __maybe_unused,
+					  unsigned int *line __maybe_unused)
+{
+	return 0;
+}
+
+static inline void dso__free_srcline_index(struct dso *dso __maybe_unused)
+{
+}
+#endif
+
 struct inline_list {
 	struct symbol		*symbol;
 	char			*srcline;
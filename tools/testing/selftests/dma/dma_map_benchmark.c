@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -14,17 +15,43 @@
 #define DMA_MAP_BENCHMARK	_IOWR('d', 1, struct map_benchmark)
 #define DMA_MAP_MAX_THREADS	1024
 #define DMA_MAP_MAX_SECONDS     300
+#define DMA_MAP_MAX_GRANULE	1024
+#define DMA_MAP_MAX_NENTS	128
 
 #define DMA_MAP_BIDIRECTIONAL	0
 #define DMA_MAP_TO_DEVICE	1
 #define DMA_MAP_FROM_DEVICE	2
 
+#define DMA_MAP_MODE_SINGLE	0
+#define DMA_MAP_MODE_SWIOTLB	1
+#define DMA_MAP_MODE_SG		2
+#define DMA_MAP_MODE_COHERENT	3
+#define DMA_MAP_MODE_POOL	4
+#define DMA_MAP_MODE_SYNC	5
+#define DMA_MAP_NR_MODES	6
+
+#define DMA_MAP_NR_PCT		4
+
 static char *directions[] = {
 	"BIDIRECTIONAL",
 	"TO_DEVICE",
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"SINGLE",
+	"SWIOTLB",
+	"SG",
+	"COHERENT",
+	"POOL",
+	"SYNC",
+};
+
+/* the percentiles reported by the kernel, in order */
+static const char *percentiles[DMA_MAP_NR_PCT] = {
+	"p50", "p90", "p99", "p99.9",
+};
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -35,9 +62,28 @@ struct map_benchmark {
 	__s32 node; /* which numa node this benchmark will run on */
 	__u32 dma_bits; /* DMA addressing capability */
 	__u32 dma_dir; /* DMA data direction */
-	__u64 expansion[10];	/* For future use */
+	__u32 mode; /* what is mapped and how */
+	__u32 granule; /* how many pages each mapping is made of */
+	__u32 nents; /* segments of a scatterlist, or pool blocks per loop */
+	__u32 pool_size; /* size of the DMA pool blocks */
+	__u32 pool_align; /* alignment of the DMA pool blocks */
+	/* keep an even number of __u32 above, the layout has no holes */
+	__u64 loops; /* number of map/unmap done by all threads */
+	__u64 map_pct_ns[DMA_MAP_NR_PCT]; /* map latency percentiles in ns */
+	__u64 unmap_pct_ns[DMA_MAP_NR_PCT]; /* as above */
+	__u64 expansion[8];	/* For future use */
 };
 
+static void print_percentiles(const char *name, const __u64 *pct_ns)
+{
+	int i;
+
+	printf("%s latency percentiles(us):", name);
+	for (i = 0; i < DMA_MAP_NR_PCT; i++)
+		printf(" %s:%.3f", percentiles[i], pct_ns[i] / 1000.0);
+	printf("\n");
+}
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -46,11 +92,16 @@ int main(int argc, char **argv)
 	int threads = 1, seconds = 20, node = -1;
 	/* default dma mask 32bit, bidirectional DMA */
 	int bits = 32, dir = DMA_MAP_BIDIRECTIONAL;
+	/* default dma_map_single() of a single page */
+	int mode = DMA_MAP_MODE_SINGLE, granule = 1;
+	/* default one segment, or one 64 byte pool block per loop */
+	int nents = 1, pool_size = 64, pool_align = 0;
+	double mbytes;
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:m:g:c:p:a:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -67,6 +118,21 @@ int main(int argc, char **argv)
 		case 'd':
 			dir = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'g':
+			granule = atoi(optarg);
+			break;
+		case 'c':
+			nents = atoi(optarg);
+			break;
+		case 'p':
+			pool_size = atoi(optarg);
+			break;
+		case 'a':
+			pool_align = atoi(optarg);
+			break;
 		default:
 			return -1;
 		}
@@ -96,28 +162,65 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode < 0 || mode >= DMA_MAP_NR_MODES) {
+		fprintf(stderr, "invalid mode, must be in 0-%d\n",
+			DMA_MAP_NR_MODES - 1);
+		exit(1);
+	}
+
+	if (nents <= 0 || nents > DMA_MAP_MAX_NENTS) {
+		fprintf(stderr, "invalid number of segments, must be in 1-%d\n",
+			DMA_MAP_MAX_NENTS);
+		exit(1);
+	}
+
+	if (granule < 1 || granule > DMA_MAP_MAX_GRANULE) {
+		fprintf(stderr, "invalid granule size, must be in 1-%d\n",
+			DMA_MAP_MAX_GRANULE);
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
 		exit(1);
 	}
 
+	memset(&map, 0, sizeof(map));
 	map.seconds = seconds;
 	map.threads = threads;
 	map.node = node;
 	map.dma_bits = bits;
 	map.dma_dir = dir;
+	map.mode = mode;
+	map.granule = granule;
+	map.nents = nents;
+	map.pool_size = pool_size;
+	map.pool_align = pool_align;
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
 		exit(1);
 	}
 
-	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s\n",
-			threads, seconds, node, dir[directions]);
+	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s mode:%s granule:%d\n",
+			threads, seconds, node, dir[directions], modes[mode],
+			granule);
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	print_percentiles("map", map.map_pct_ns);
+	print_percentiles("unmap", map.unmap_pct_ns);
+
+	if (mode == DMA_MAP_MODE_POOL)
+		mbytes = (double)map.loops * nents * pool_size;
+	else if (mode == DMA_MAP_MODE_SG)
+		mbytes = (double)map.loops * nents * granule * getpagesize();
+	else
+		mbytes = (double)map.loops * granule * getpagesize();
+	mbytes /= 1 << 20;
+	printf("throughput: %.1f maps/s %.1f MB/s\n",
+			(double)map.loops / seconds, mbytes / seconds);
 
 	return 0;
 }
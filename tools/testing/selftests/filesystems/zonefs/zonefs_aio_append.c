@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Write a zonefs sequential zone file with asynchronous direct IOs, keeping
+ * up to a given number of writes in flight, and check that each of them
+ * completes whole and that the file offsets reported on completion cover the
+ * file without holes nor overlaps. The file is opened with O_APPEND, so that
+ * zonefs issues the writes as zone appends.
+ *
+ * Writes too large for a single zone append are issued as regular writes,
+ * which do not report where they landed: use -n to not check the offsets.
+ *
+ * Usage: zonefs_aio_append [-n] <file> <block size> <nr blocks> <queue depth>
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+
+#include "../../kselftest.h"
+
+static int io_setup(unsigned int nr, aio_context_t *ctx)
+{
+	return syscall(__NR_io_setup, nr, ctx);
+}
+
+static int io_destroy(aio_context_t ctx)
+{
+	return syscall(__NR_io_destroy, ctx);
+}
+
+static int io_submit(aio_context_t ctx, long nr, struct iocb **iocbs)
+{
+	return syscall(__NR_io_submit, ctx, nr, iocbs);
+}
+
+static int io_getevents(aio_context_t ctx, long min_nr, long nr,
+			struct io_event *events)
+{
+	return syscall(__NR_io_getevents, ctx, min_nr, nr, events, NULL);
+}
+
+static int cmp_offsets(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	struct iocb *iocbs, **free_iocbs;
+	struct io_event *events;
+	long long *offsets;
+	unsigned long bs, qd, nr_blocks, submitted = 0, done = 0, nr_free;
+	struct timespec start, end;
+	aio_context_t ctx = 0;
+	struct stat st;
+	bool check_offsets = true;
+	const char *path;
+	double secs;
+	void *buf;
+	int fd, i, n, opt;
+
+	while ((opt = getopt(argc, argv, "n")) != -1) {
+		switch (opt) {
+		case 'n':
+			check_offsets = false;
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-n] <file> <block size> <nr blocks> <queue depth>\n",
+					   argv[0]);
+		}
+	}
+
+	if (argc - optind != 4)
+		ksft_exit_fail_msg("usage: %s [-n] <file> <block size> <nr blocks> <queue depth>\n",
+				   argv[0]);
+
+	path = argv[optind];
+	bs = strtoul(argv[optind + 1], NULL, 0);
+	nr_blocks = strtoul(argv[optind + 2], NULL, 0);
+	qd = strtoul(argv[optind + 3], NULL, 0);
+	if (!bs || !nr_blocks || !qd)
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	fd = open(path, O_WRONLY | O_DIRECT | O_APPEND);
+	if (fd < 0)
+		ksft_exit_fail_msg("open %s: %s\n", path, strerror(errno));
+
+	if (fstat(fd, &st) || st.st_size)
+		ksft_exit_fail_msg("%s is not an empty zone file\n", path);
+
+	if (posix_memalign(&buf, 4096, bs))
+		ksft_exit_fail_msg("out of memory\n");
+	memset(buf, 0x5a, bs);
+
+	iocbs = calloc(qd, sizeof(*iocbs));
+	free_iocbs = calloc(qd, sizeof(*free_iocbs));
+	events = calloc(qd, sizeof(*events));
+	offsets = calloc(nr_blocks, sizeof(*offsets));
+	if (!iocbs || !free_iocbs || !events || !offsets)
+		ksft_exit_fail_msg("out of memory\n");
+
+	if (io_setup(qd, &ctx))
+		ksft_exit_fail_msg("io_setup: %s\n", strerror(errno));
+
+	for (i = 0; i < qd; i++)
+		free_iocbs[i] = &iocbs[i];
+	nr_free = qd;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (done < nr_blocks) {
+		/* Writes are appended, the offset given is ignored */
+		while (nr_free && submitted < nr_blocks) {
+			struct iocb *cb = free_iocbs[--nr_free];
+
+			memset(cb, 0, sizeof(*cb));
+			cb->aio_lio_opcode = IOCB_CMD_PWRITE;
+			cb->aio_fildes = fd;
+			cb->aio_buf = (unsigned long)buf;
+			cb->aio_nbytes = bs;
+			cb->aio_offset = submitted * bs;
+			if (io_submit(ctx, 1, &cb) != 1)
+				ksft_exit_fail_msg("io_submit: %s\n",
+						   strerror(errno));
+			submitted++;
+		}
+
+		n = io_getevents(ctx, 1, qd, events);
+		if (n < 0)
+			ksft_exit_fail_msg("io_getevents: %s\n",
+					   strerror(errno));
+
+		for (i = 0; i < n; i++) {
+			if ((long long)events[i].res != bs)
+				ksft_exit_fail_msg("write failed: %lld\n",
+						   (long long)events[i].res);
+			offsets[done++] = events[i].res2;
+			free_iocbs[nr_free++] = (struct iocb *)events[i].obj;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	io_destroy(ctx);
+
+	secs = (end.tv_sec - start.tv_sec) +
+	       (end.tv_nsec - start.tv_nsec) / 1e9;
+	ksft_print_msg("qd %lu: %lu x %lu B in %.3f s, %.1f MB/s\n",
+		       qd, nr_blocks, bs, secs, nr_blocks * bs / secs / 1e6);
+
+	qsort(offsets, nr_blocks, sizeof(*offsets), cmp_offsets);
+	for (i = 0; check_offsets && i < nr_blocks; i++) {
+		if (offsets[i] != (long long)i * bs)
+			ksft_exit_fail_msg("write %d landed at %lld, expected %lld\n",
+					   i, offsets[i], (long long)i * bs);
+	}
+
+	if (fstat(fd, &st))
+		ksft_exit_fail_msg("fstat: %s\n", strerror(errno));
+	if (st.st_size != nr_blocks * bs)
+		ksft_exit_fail_msg("file size %lld, expected %lld\n",
+				   (long long)st.st_size,
+				   (long long)(nr_blocks * bs));
+
+	close(fd);
+	ksft_exit_pass();
+}
@@ -0,0 +1,74 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Write a zonefs sequential zone file of a zoned null_blk device with
+# asynchronous direct IOs at queue depth 1 and at a higher queue depth,
+# checking the write locations reported by each completion. Do it again
+# with writes larger than a single BIO, which cannot be zone appends.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+ZONE_SIZE_MB=64
+NR_ZONES=8
+BS=$((64 * 1024))
+# Above the 1 MiB of data a BIO holds with 4 KiB pages
+LARGE_BS=$((4 * 1024 * 1024))
+QD=${QD:-32}
+
+nullb=""
+mnt=""
+
+cleanup()
+{
+	[ -n "$mnt" ] && umount "$mnt" 2>/dev/null && rmdir "$mnt"
+	if [ -n "$nullb" ]; then
+		echo 0 > "$nullb/power"
+		rmdir "$nullb"
+	fi
+}
+trap cleanup EXIT
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "SKIP: must be run as root"
+	exit $ksft_skip
+fi
+
+if ! command -v mkzonefs > /dev/null; then
+	echo "SKIP: mkzonefs not found"
+	exit $ksft_skip
+fi
+
+modprobe null_blk nr_devices=0 2>/dev/null
+modprobe zonefs 2>/dev/null
+
+cfs=/sys/kernel/config/nullb
+if [ ! -d "$cfs" ]; then
+	echo "SKIP: null_blk configfs interface not available"
+	exit $ksft_skip
+fi
+
+nullb="$cfs/zonefs-aio"
+mkdir "$nullb" || exit 1
+echo 1 > "$nullb/memory_backed"
+echo 1 > "$nullb/zoned"
+echo $ZONE_SIZE_MB > "$nullb/zone_size"
+echo $((ZONE_SIZE_MB * NR_ZONES)) > "$nullb/size"
+echo 2 > "$nullb/queue_mode"
+echo 1 > "$nullb/power" || exit 1
+dev=/dev/nullb$(cat "$nullb/index")
+
+mkzonefs -f "$dev" > /dev/null || exit 1
+mnt=$(mktemp -d)
+mount -t zonefs "$dev" "$mnt" || exit 1
+
+nr_blocks=$((ZONE_SIZE_MB * 1024 * 1024 / BS))
+ret=0
+./zonefs_aio_append "$mnt/seq/0" $BS $nr_blocks 1 || ret=1
+./zonefs_aio_append "$mnt/seq/1" $BS $nr_blocks $QD || ret=1
+
+nr_blocks=$((ZONE_SIZE_MB * 1024 * 1024 / LARGE_BS))
+./zonefs_aio_append -n "$mnt/seq/2" $LARGE_BS $nr_blocks 1 || ret=1
+./zonefs_aio_append -n "$mnt/seq/3" $LARGE_BS $nr_blocks $QD || ret=1
+
+exit $ret
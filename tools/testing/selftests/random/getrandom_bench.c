@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * getrandom() throughput for an increasing number of threads, each reading
+ * fixed size buffers in a loop for a while. Reads /dev/urandom instead when
+ * given -u.
+ *
+ * Usage: getrandom_bench [-u] [-s <buffer size>] [-t <seconds>] [-n <max threads>]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "../kselftest.h"
+
+static size_t buf_size = 64;
+static unsigned int seconds = 1;
+static bool use_urandom;
+static volatile bool stop;
+static int urandom_fd = -1;
+
+struct worker {
+	pthread_t thread;
+	unsigned long long calls;
+	int error;
+};
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	char *buf = malloc(buf_size);
+	ssize_t ret;
+
+	if (!buf) {
+		w->error = ENOMEM;
+		return NULL;
+	}
+
+	while (!stop) {
+		if (use_urandom)
+			ret = read(urandom_fd, buf, buf_size);
+		else
+			ret = syscall(__NR_getrandom, buf, buf_size, 0);
+		if (ret != buf_size) {
+			w->error = ret < 0 ? errno : EIO;
+			break;
+		}
+		w->calls++;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static int run(unsigned int nr_threads)
+{
+	struct worker *workers = calloc(nr_threads, sizeof(*workers));
+	unsigned long long calls = 0;
+	struct timespec start, end;
+	unsigned int i;
+	double secs;
+	int error = 0;
+
+	if (!workers)
+		ksft_exit_fail_msg("out of memory\n");
+
+	stop = false;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, worker_fn,
+				   &workers[i]))
+			ksft_exit_fail_msg("pthread_create failed\n");
+	}
+
+	sleep(seconds);
+	stop = true;
+
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		calls += workers[i].calls;
+		if (workers[i].error)
+			error = workers[i].error;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	free(workers);
+
+	secs = (end.tv_sec - start.tv_sec) +
+	       (end.tv_nsec - start.tv_nsec) / 1e9;
+	ksft_print_msg("%3u threads: %12.0f calls/s %10.1f MB/s\n",
+		       nr_threads, calls / secs, calls * buf_size / secs / 1e6);
+
+	return error;
+}
+
+int main(int argc, char **argv)
+{
+	long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int max_threads = nr_cpus > 0 ? nr_cpus : 1;
+	unsigned int n;
+	int opt, error;
+
+	while ((opt = getopt(argc, argv, "us:t:n:")) != -1) {
+		switch (opt) {
+		case 'u':
+			use_urandom = true;
+			break;
+		case 's':
+			buf_size = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-u] [-s <buffer size>] [-t <seconds>] [-n <max threads>]\n",
+					   argv[0]);
+		}
+	}
+
+	/* getrandom() returns at most 32MB at once */
+	if (!buf_size || buf_size > (1 << 25) || !seconds || !max_threads)
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	if (use_urandom) {
+		urandom_fd = open("/dev/urandom", O_RDONLY);
+		if (urandom_fd < 0)
+			ksft_exit_fail_msg("open /dev/urandom: %s\n",
+					   strerror(errno));
+	}
+
+	ksft_print_msg("%s, %zu bytes per call\n",
+		       use_urandom ? "/dev/urandom" : "getrandom()", buf_size);
+
+	for (n = 1; ; n = n * 2 < max_threads ? n * 2 : max_threads) {
+		error = run(n);
+		if (error == ENOSYS)
+			ksft_exit_skip("getrandom() not supported\n");
+		if (error)
+			ksft_exit_fail_msg("read failed: %s\n", strerror(error));
+		if (n == max_threads)
+			break;
+	}
+
+	ksft_exit_pass();
+}
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure the cost of process wide CPU timers on the threads of a process:
+ * many threads spin first without any timer, then with an ITIMER_PROF
+ * itimer and a number of periodic CLOCK_PROCESS_CPUTIME_ID timers armed.
+ * The loss of spinning rate between both runs is the overhead of the
+ * timers, mostly paid from the tick of each thread.
+ *
+ * Usage: cpu-timers-bench [-t threads] [-n timers] [-p period_us]
+ *			   [-d seconds] [-z hz]
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "../kselftest.h"
+
+#define NSEC_PER_SEC		1000000000ULL
+#define USEC_PER_SEC		1000000ULL
+
+static int nr_threads = 256;
+static int nr_timers = 32;
+static unsigned long long period_us = 10000;
+static int duration = 2;
+static int hz = 100;
+
+static volatile int running;
+static volatile sig_atomic_t nr_signals;
+
+struct thread_data {
+	pthread_t		thread;
+	unsigned long long	loops;
+	/* Keep the counters of the threads apart */
+	char			pad[64];
+};
+
+static unsigned long long clock_ns(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void signal_handler(int sig)
+{
+	nr_signals++;
+}
+
+static void *spinner(void *arg)
+{
+	struct thread_data *td = arg;
+	unsigned long long loops = 0;
+
+	while (!running)
+		;
+	while (running == 1)
+		loops++;
+
+	td->loops = loops;
+	return NULL;
+}
+
+/* Spin for a while, and store the number of loops per ms of CPU time */
+static int run(struct thread_data *td, double *rate)
+{
+	unsigned long long loops = 0, cpu;
+	struct timespec end;
+	int i;
+
+	running = 0;
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&td[i].thread, NULL, spinner, &td[i])) {
+			printf("Failed to create thread %d\n", i);
+			return -1;
+		}
+	}
+
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += duration;
+	running = 1;
+	/* The timer signals may interrupt the sleep */
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, NULL))
+		;
+	running = 2;
+
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(td[i].thread, NULL);
+		loops += td[i].loops;
+	}
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	*rate = (double)loops * 1000000 / cpu;
+	return 0;
+}
+
+static int arm_timers(timer_t *timers)
+{
+	struct itimerspec its = {
+		.it_value.tv_sec	= period_us / USEC_PER_SEC,
+		.it_value.tv_nsec	= (period_us % USEC_PER_SEC) * 1000,
+	};
+	struct itimerval itv = {
+		.it_value.tv_sec	= period_us / USEC_PER_SEC,
+		.it_value.tv_usec	= period_us % USEC_PER_SEC,
+	};
+	struct sigevent sev = {
+		.sigev_notify		= SIGEV_SIGNAL,
+		.sigev_signo		= SIGUSR1,
+	};
+	int i;
+
+	its.it_interval = its.it_value;
+	itv.it_interval = itv.it_value;
+
+	for (i = 0; i < nr_timers; i++) {
+		if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &timers[i]) ||
+		    timer_settime(timers[i], 0, &its, NULL)) {
+			printf("Failed to arm timer %d: %s\n", i, strerror(errno));
+			return -1;
+		}
+	}
+
+	if (setitimer(ITIMER_PROF, &itv, NULL)) {
+		printf("Failed to arm ITIMER_PROF: %s\n", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	double base, loaded, lost;
+	struct thread_data *td;
+	timer_t *timers;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:n:p:d:z:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'n':
+			nr_timers = atoi(optarg);
+			break;
+		case 'p':
+			period_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'z':
+			hz = atoi(optarg);
+			break;
+		default:
+			printf("Usage: %s [-t threads] [-n timers] [-p period_us] [-d seconds] [-z hz]\n",
+			       argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_threads <= 0 || nr_timers < 0 || !period_us || duration <= 0 ||
+	    hz <= 0) {
+		printf("Invalid parameters\n");
+		return KSFT_FAIL;
+	}
+
+	td = calloc(nr_threads, sizeof(*td));
+	timers = calloc(nr_timers, sizeof(*timers));
+	if (!td || (!timers && nr_timers)) {
+		printf("Out of memory\n");
+		return KSFT_FAIL;
+	}
+
+	signal(SIGUSR1, signal_handler);
+	signal(SIGPROF, signal_handler);
+
+	printf("%d threads, %d process CPU timers and ITIMER_PROF every %llu us\n",
+	       nr_threads, nr_timers, period_us);
+
+	if (run(td, &base))
+		return ksft_exit_fail();
+	printf("without timers: %.0f loops per ms of CPU time\n", base);
+
+	if (arm_timers(timers))
+		return ksft_exit_fail();
+	if (run(td, &loaded))
+		return ksft_exit_fail();
+	printf("with timers:    %.0f loops per ms of CPU time, %d signals\n",
+	       loaded, nr_signals);
+
+	/*
+	 * The CPU time lost to the timers, assuming the spinning rate does not
+	 * change otherwise. Each thread gets HZ ticks per second of CPU time.
+	 */
+	lost = base > loaded ? (1.0 - loaded / base) * NSEC_PER_SEC : 0.0;
+	printf("overhead: %.2f%%, %.0f ns per CPU second, %.0f ns per tick at HZ=%d\n",
+	       lost * 100 / NSEC_PER_SEC, lost, lost / hz, hz);
+
+	printf("[OK]\n");
+	return ksft_exit_pass();
+}
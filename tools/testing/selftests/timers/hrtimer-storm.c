@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Make many threads sleep until the same absolute deadlines, so that bursts
+ * of hrtimers expire together, and report their wakeup latency along with
+ * the expiry statistics of the hrtimer interrupt when /proc/timer_list is
+ * readable.
+ *
+ * Usage: hrtimer-storm [-t threads] [-l loops] [-p period_us]
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../kselftest.h"
+
+#define NSEC_PER_SEC		1000000000ULL
+#define NSEC_PER_USEC		1000ULL
+
+/* Average wakeup latency above which the test fails, in ns */
+#define UNREASONABLE_LATENCY	(40 * 1000 * 1000ULL)
+
+static int nr_threads = 256;
+static int nr_loops = 1000;
+static unsigned long long period_ns = 1000 * NSEC_PER_USEC;
+static unsigned long long start_ns;
+
+struct thread_result {
+	unsigned long long	total_ns;
+	unsigned long long	max_ns;
+	int			err;
+};
+
+struct timer_stats {
+	unsigned long long	events;
+	unsigned long long	expired;
+	unsigned long long	passes;
+	unsigned long long	retries;
+	unsigned long long	expiry_time;
+	int			valid;
+};
+
+static unsigned long long timespec_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec ns_to_timespec(unsigned long long ns)
+{
+	struct timespec ts = {
+		.tv_sec		= ns / NSEC_PER_SEC,
+		.tv_nsec	= ns % NSEC_PER_SEC,
+	};
+
+	return ts;
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return timespec_to_ns(&ts);
+}
+
+/* Sum the hrtimer interrupt counters of all CPUs */
+static void read_timer_stats(struct timer_stats *st)
+{
+	char line[256], name[64];
+	unsigned long long val;
+	FILE *f;
+
+	memset(st, 0, sizeof(*st));
+
+	f = fopen("/proc/timer_list", "r");
+	if (!f)
+		return;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, " .%63s : %llu", name, &val) != 2)
+			continue;
+		if (!strcmp(name, "nr_events"))
+			st->events += val;
+		else if (!strcmp(name, "nr_expired"))
+			st->expired += val, st->valid = 1;
+		else if (!strcmp(name, "nr_passes"))
+			st->passes += val;
+		else if (!strcmp(name, "nr_retries"))
+			st->retries += val;
+		else if (!strcmp(name, "expiry_time"))
+			st->expiry_time += val;
+	}
+	fclose(f);
+}
+
+static void *sleeper(void *arg)
+{
+	struct thread_result *res = arg;
+	unsigned long long deadline, lat;
+	struct timespec ts;
+	int i, ret;
+
+	for (i = 1; i <= nr_loops; i++) {
+		deadline = start_ns + i * period_ns;
+		ts = ns_to_timespec(deadline);
+
+		do {
+			ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					      &ts, NULL);
+		} while (ret == EINTR);
+		if (ret) {
+			res->err = ret;
+			break;
+		}
+
+		lat = now_ns() - deadline;
+		res->total_ns += lat;
+		if (lat > res->max_ns)
+			res->max_ns = lat;
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long total = 0, max = 0, avg, wakeups;
+	struct timer_stats before, after;
+	struct thread_result *res;
+	pthread_t *threads;
+	int opt, i, err = 0;
+
+	while ((opt = getopt(argc, argv, "t:l:p:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'l':
+			nr_loops = atoi(optarg);
+			break;
+		case 'p':
+			period_ns = strtoull(optarg, NULL, 0) * NSEC_PER_USEC;
+			break;
+		default:
+			printf("Usage: %s [-t threads] [-l loops] [-p period_us]\n",
+			       argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_threads <= 0 || nr_loops <= 0 || !period_ns) {
+		printf("Invalid parameters\n");
+		return KSFT_FAIL;
+	}
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	res = calloc(nr_threads, sizeof(*res));
+	if (!threads || !res) {
+		printf("Out of memory\n");
+		return KSFT_FAIL;
+	}
+
+	printf("%d threads, %d wakeups each, every %llu us\n", nr_threads,
+	       nr_loops, period_ns / NSEC_PER_USEC);
+
+	/* Leave the threads some time to start before the first deadline */
+	start_ns = now_ns() + 100 * 1000 * NSEC_PER_USEC;
+
+	read_timer_stats(&before);
+
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&threads[i], NULL, sleeper, &res[i])) {
+			printf("Failed to create thread %d\n", i);
+			return KSFT_FAIL;
+		}
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(threads[i], NULL);
+		if (res[i].err)
+			err = res[i].err;
+		total += res[i].total_ns;
+		if (res[i].max_ns > max)
+			max = res[i].max_ns;
+	}
+
+	read_timer_stats(&after);
+
+	if (err) {
+		printf("clock_nanosleep failed: %s\n", strerror(err));
+		return ksft_exit_fail();
+	}
+
+	wakeups = (unsigned long long)nr_threads * nr_loops;
+	avg = total / wakeups;
+	printf("wakeup latency: avg %llu ns, max %llu ns\n", avg, max);
+
+	if (after.valid) {
+		unsigned long long events = after.events - before.events;
+		unsigned long long expired = after.expired - before.expired;
+
+		printf("hrtimer interrupts: %llu, timers expired: %llu (%.1f per interrupt)\n",
+		       events, expired, events ? (double)expired / events : 0.0);
+		printf("extra passes: %llu, retries: %llu, expiry time: %llu ns (%llu ns per timer)\n",
+		       after.passes - before.passes,
+		       after.retries - before.retries,
+		       after.expiry_time - before.expiry_time,
+		       expired ? (after.expiry_time - before.expiry_time) / expired : 0);
+	} else {
+		printf("hrtimer expiry statistics not available\n");
+	}
+
+	if (avg > UNREASONABLE_LATENCY) {
+		printf("[FAILED]\n");
+		return ksft_exit_fail();
+	}
+
+	printf("[OK]\n");
+	return ksft_exit_pass();
+}
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * vdso_bench_coarse.c: Estimate how often the vDSO coarse clocks and time()
+ * retry their read because the timekeeping code updated the vDSO data page
+ * in the meantime.
+ *
+ * Each thread calls the clock in a tight loop and times each call with
+ * CLOCK_MONOTONIC. A call returning a new value saw an update of the data
+ * page; when it also took much longer than the typical call, it most likely
+ * waited for the update to complete, or retried. The tick interrupting the
+ * call on its own CPU shows up the same way, so this is an upper bound.
+ *
+ * Usage: vdso_bench_coarse [-t threads] [-d seconds] [-s slow_ns]
+ */
+
+#include <stdint.h>
+#include <elf.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/auxv.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+#include "vdso_config.h"
+
+extern void *vdso_sym(const char *version, const char *name);
+extern void vdso_init_from_sysinfo_ehdr(uintptr_t base);
+
+typedef long (*vdso_clock_gettime_t)(clockid_t clk_id, struct timespec *ts);
+typedef time_t (*vdso_time_t)(time_t *t);
+
+#define NSEC_PER_SEC		1000000000ULL
+#define CALIBRATION_CALLS	10000
+
+static vdso_clock_gettime_t vdso_clock_gettime;
+static vdso_time_t vdso_time;
+
+static int nr_threads;
+static int duration = 2;
+static unsigned long long slow_ns;
+static volatile int running;
+
+struct bench_result {
+	unsigned long long	calls;
+	unsigned long long	slow;
+	unsigned long long	updates;
+	unsigned long long	slow_updates;
+	unsigned long long	elapsed_ns;
+};
+
+struct bench_thread {
+	pthread_t		thread;
+	clockid_t		clk;	/* -1 for time() */
+	struct bench_result	res;
+};
+
+static inline unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	vdso_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static inline unsigned long long read_clock(clockid_t clk)
+{
+	struct timespec ts;
+
+	if (clk < 0)
+		return vdso_time(NULL);
+
+	vdso_clock_gettime(clk, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void *bench_thread(void *arg)
+{
+	struct bench_thread *bt = arg;
+	struct bench_result *res = &bt->res;
+	unsigned long long t0, t1, start, val, prev;
+
+	while (!running)
+		;
+
+	prev = read_clock(bt->clk);
+	start = t1 = now_ns();
+	while (running == 1) {
+		t0 = t1;
+		val = read_clock(bt->clk);
+		t1 = now_ns();
+
+		res->calls++;
+		if (t1 - t0 > slow_ns)
+			res->slow++;
+		if (val != prev) {
+			res->updates++;
+			if (t1 - t0 > slow_ns)
+				res->slow_updates++;
+			prev = val;
+		}
+	}
+	res->elapsed_ns = t1 - start;
+
+	return NULL;
+}
+
+static int compare_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* A call is slow when it takes 4 times longer than the median call */
+static unsigned long long calibrate(clockid_t clk)
+{
+	static unsigned long long lat[CALIBRATION_CALLS];
+	unsigned long long t0, t1;
+	int i;
+
+	t1 = now_ns();
+	for (i = 0; i < CALIBRATION_CALLS; i++) {
+		t0 = t1;
+		read_clock(clk);
+		t1 = now_ns();
+		lat[i] = t1 - t0;
+	}
+	qsort(lat, CALIBRATION_CALLS, sizeof(lat[0]), compare_ull);
+
+	return lat[CALIBRATION_CALLS / 2] * 4;
+}
+
+static int bench(const char *name, clockid_t clk, unsigned long long slow)
+{
+	struct bench_result total = { };
+	struct bench_thread *bt;
+	int i;
+
+	bt = calloc(nr_threads, sizeof(*bt));
+	if (!bt) {
+		printf("Out of memory\n");
+		return KSFT_FAIL;
+	}
+
+	slow_ns = slow ? slow : calibrate(clk);
+	running = 0;
+	for (i = 0; i < nr_threads; i++) {
+		bt[i].clk = clk;
+		if (pthread_create(&bt[i].thread, NULL, bench_thread, &bt[i])) {
+			printf("Failed to create thread %d\n", i);
+			free(bt);
+			return KSFT_FAIL;
+		}
+	}
+
+	running = 1;
+	sleep(duration);
+	running = 2;
+
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(bt[i].thread, NULL);
+		total.calls += bt[i].res.calls;
+		total.slow += bt[i].res.slow;
+		total.updates += bt[i].res.updates;
+		total.slow_updates += bt[i].res.slow_updates;
+		total.elapsed_ns += bt[i].res.elapsed_ns;
+	}
+	free(bt);
+
+	printf("%s: %llu calls, %.1f ns per call (timing included), slow above %llu ns\n",
+	       name, total.calls,
+	       total.calls ? (double)total.elapsed_ns / total.calls : 0.0,
+	       slow_ns);
+	printf("%s: %llu updates seen, %llu slow (%.3f%%), %llu slow calls overall (%.6f%%)\n",
+	       name, total.updates, total.slow_updates,
+	       total.updates ? 100.0 * total.slow_updates / total.updates : 0.0,
+	       total.slow,
+	       total.calls ? 100.0 * total.slow / total.calls : 0.0);
+
+	return KSFT_PASS;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sysinfo_ehdr = getauxval(AT_SYSINFO_EHDR);
+	unsigned long long slow = 0;
+	const char *version;
+	const char **name;
+	int opt, ret;
+
+	nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt(argc, argv, "t:d:s:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 's':
+			slow = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			printf("Usage: %s [-t threads] [-d seconds] [-s slow_ns]\n",
+			       argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_threads <= 0 || duration <= 0) {
+		printf("Invalid parameters\n");
+		return KSFT_FAIL;
+	}
+
+	if (!sysinfo_ehdr) {
+		printf("AT_SYSINFO_EHDR is not present!\n");
+		return KSFT_SKIP;
+	}
+
+	version = versions[VDSO_VERSION];
+	name = (const char **)&names[VDSO_NAMES];
+
+	vdso_init_from_sysinfo_ehdr(sysinfo_ehdr);
+
+	vdso_clock_gettime = (vdso_clock_gettime_t)vdso_sym(version, name[1]);
+	if (!vdso_clock_gettime) {
+		printf("Could not find %s\n", name[1]);
+		return KSFT_SKIP;
+	}
+	vdso_time = (vdso_time_t)vdso_sym(version, name[2]);
+
+	printf("%d threads, %d seconds per clock\n", nr_threads, duration);
+
+	ret = bench("CLOCK_REALTIME_COARSE", CLOCK_REALTIME_COARSE, slow);
+	if (ret == KSFT_PASS)
+		ret = bench("CLOCK_MONOTONIC_COARSE", CLOCK_MONOTONIC_COARSE,
+			    slow);
+	if (ret == KSFT_PASS) {
+		if (vdso_time)
+			ret = bench("time()", -1, slow);
+		else
+			printf("Could not find %s, skipping time()\n", name[2]);
+	}
+
+	return ret;
+}